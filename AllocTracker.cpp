@@ -0,0 +1,223 @@
+#include "AllocTracker.hpp"
+
+#ifdef ENABLE_ALLOC_TRACKING
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+constexpr uint32_t AllocTracker::MaxTags;
+
+namespace {
+	//every block is preceded by a header recording its size and tag (so frees can be attributed);
+	// the header is padded to keep the block itself maximally aligned:
+	struct Header {
+		uint64_t size;
+		uint32_t tag;
+		uint32_t magic;
+	};
+	constexpr size_t HeaderSize = (alignof(std::max_align_t) > sizeof(Header) ? alignof(std::max_align_t) : sizeof(Header));
+	constexpr uint32_t Magic = 0xa110c8ed;
+
+	//counters are plain atomics in static storage, so they work before main() and after it returns:
+	struct Counters {
+		std::atomic< uint64_t > allocations;
+		std::atomic< uint64_t > frees;
+		std::atomic< uint64_t > allocated_bytes;
+		std::atomic< uint64_t > freed_bytes;
+	};
+	Counters counters[AllocTracker::MaxTags];
+	std::atomic< char const * > tag_names[AllocTracker::MaxTags];
+	std::atomic< uint32_t > tag_count(1); //tag 0 is "untagged"
+
+	thread_local uint32_t current_tag = 0;
+
+	//totals at the end of the previous frame, and the difference over the last frame:
+	AllocTracker::Stats frame_start;
+	AllocTracker::Stats frame;
+
+	std::mutex &tag_mutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	AllocTracker::Stats stats_for(uint32_t tag) {
+		AllocTracker::Stats stats;
+		char const *name = tag_names[tag].load(std::memory_order_acquire);
+		stats.tag = (name ? name : "untagged");
+		stats.allocations = counters[tag].allocations.load(std::memory_order_relaxed);
+		stats.frees = counters[tag].frees.load(std::memory_order_relaxed);
+		stats.allocated_bytes = counters[tag].allocated_bytes.load(std::memory_order_relaxed);
+		stats.freed_bytes = counters[tag].freed_bytes.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	void *tracked_alloc(size_t size) noexcept {
+		void *block = std::malloc(HeaderSize + size);
+		if (!block) return nullptr;
+		Header *header = reinterpret_cast< Header * >(block);
+		header->size = size;
+		header->tag = current_tag;
+		header->magic = Magic;
+		Counters &c = counters[header->tag];
+		c.allocations.fetch_add(1, std::memory_order_relaxed);
+		c.allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+		return reinterpret_cast< char * >(block) + HeaderSize;
+	}
+
+	void tracked_free(void *ptr) noexcept {
+		if (!ptr) return;
+		Header *header = reinterpret_cast< Header * >(reinterpret_cast< char * >(ptr) - HeaderSize);
+		if (header->magic != Magic) {
+			//not one of ours (or already freed) -- freeing it would corrupt the heap:
+			std::abort();
+		}
+		header->magic = 0;
+		Counters &c = counters[header->tag];
+		c.frees.fetch_add(1, std::memory_order_relaxed);
+		c.freed_bytes.fetch_add(header->size, std::memory_order_relaxed);
+		std::free(header);
+	}
+
+	void *tracked_new(size_t size) {
+		void *ptr = tracked_alloc(size);
+		if (!ptr) throw std::bad_alloc();
+		return ptr;
+	}
+}
+
+//----- global allocator replacement -----
+
+void *operator new(size_t size) { return tracked_new(size); }
+void *operator new[](size_t size) { return tracked_new(size); }
+void *operator new(size_t size, std::nothrow_t const &) noexcept { return tracked_alloc(size); }
+void *operator new[](size_t size, std::nothrow_t const &) noexcept { return tracked_alloc(size); }
+void operator delete(void *ptr) noexcept { tracked_free(ptr); }
+void operator delete[](void *ptr) noexcept { tracked_free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { tracked_free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { tracked_free(ptr); }
+void operator delete(void *ptr, std::nothrow_t const &) noexcept { tracked_free(ptr); }
+void operator delete[](void *ptr, std::nothrow_t const &) noexcept { tracked_free(ptr); }
+
+//----- AllocTracker -----
+
+uint32_t AllocTracker::tag(char const *name) {
+	std::unique_lock< std::mutex > lock(tag_mutex());
+	uint32_t count = tag_count.load(std::memory_order_relaxed);
+	for (uint32_t i = 1; i < count; ++i) {
+		if (std::strcmp(tag_names[i].load(std::memory_order_relaxed), name) == 0) return i;
+	}
+	if (count == MaxTags) {
+		//out of room; these allocations stay untagged:
+		return 0;
+	}
+	tag_names[count].store(name, std::memory_order_release);
+	tag_count.store(count + 1, std::memory_order_release);
+	return count;
+}
+
+AllocTracker::Scope::Scope(uint32_t tag) : previous(current_tag) {
+	current_tag = tag;
+}
+
+AllocTracker::Scope::~Scope() {
+	current_tag = previous;
+}
+
+AllocTracker::Stats AllocTracker::total() {
+	Stats sum;
+	sum.tag = "total";
+	uint32_t count = tag_count.load(std::memory_order_acquire);
+	for (uint32_t i = 0; i < count; ++i) {
+		Stats stats = stats_for(i);
+		sum.allocations += stats.allocations;
+		sum.frees += stats.frees;
+		sum.allocated_bytes += stats.allocated_bytes;
+		sum.freed_bytes += stats.freed_bytes;
+	}
+	return sum;
+}
+
+std::vector< AllocTracker::Stats > AllocTracker::by_tag() {
+	std::vector< Stats > ret;
+	uint32_t count = tag_count.load(std::memory_order_acquire);
+	for (uint32_t i = 0; i < count; ++i) {
+		ret.emplace_back(stats_for(i));
+	}
+	return ret;
+}
+
+void AllocTracker::end_frame() {
+	Stats now = total();
+	frame.tag = "frame";
+	frame.allocations = now.allocations - frame_start.allocations;
+	frame.frees = now.frees - frame_start.frees;
+	frame.allocated_bytes = now.allocated_bytes - frame_start.allocated_bytes;
+	frame.freed_bytes = now.freed_bytes - frame_start.freed_bytes;
+	frame_start = now;
+}
+
+AllocTracker::Stats const &AllocTracker::last_frame() {
+	return frame;
+}
+
+uint64_t AllocTracker::peak_rss() {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS info;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info))) return 0;
+	return uint64_t(info.PeakWorkingSetSize);
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+	#if defined(__APPLE__)
+	return uint64_t(usage.ru_maxrss); //bytes on macOS
+	#else
+	return uint64_t(usage.ru_maxrss) * 1024; //kilobytes on Linux
+	#endif
+#endif
+}
+
+void AllocTracker::report(std::ostream &out) {
+	out << "Heap allocations by tag:\n";
+	out << "  " << std::left << std::setw(16) << "tag" << std::right
+	    << std::setw(12) << "allocs" << std::setw(14) << "bytes" << std::setw(10) << "live" << std::setw(14) << "live bytes" << "\n";
+	auto row = [&out](Stats const &stats) {
+		out << "  " << std::left << std::setw(16) << stats.tag << std::right
+		    << std::setw(12) << stats.allocations << std::setw(14) << stats.allocated_bytes
+		    << std::setw(10) << stats.live_blocks() << std::setw(14) << stats.live_bytes() << "\n";
+	};
+	for (auto const &stats : by_tag()) {
+		row(stats);
+	}
+	row(total());
+	out << "  peak RSS: " << peak_rss() / 1024 << " KiB\n";
+}
+
+void AllocTracker::report_leaks(std::ostream &out) {
+	bool any = false;
+	for (auto const &stats : by_tag()) {
+		if (stats.live_blocks() == 0) continue;
+		if (!any) out << "Heap allocations still live at shutdown:\n";
+		any = true;
+		out << "  " << stats.tag << ": " << stats.live_blocks() << " blocks, " << stats.live_bytes() << " bytes\n";
+	}
+	if (!any) out << "No heap allocations live at shutdown.\n";
+}
+
+#endif //ENABLE_ALLOC_TRACKING
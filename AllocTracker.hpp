@@ -0,0 +1,74 @@
+#pragma once
+
+/*
+ * AllocTracker replaces the global operator new / delete to count heap allocations:
+ *  totals, per frame (between calls to end_frame()), and per tagged subsystem, plus live bytes.
+ *  Anything still allocated at shutdown is reported as a leak, grouped by tag.
+ *
+ * Tag a subsystem's allocations for the rest of the enclosing scope (tags nest; the innermost wins):
+ *   ALLOC_SCOPE("update");
+ * Tag names must be string literals; allocations outside any scope are tagged "untagged".
+ * Only allocations through operator new are seen -- not malloc, and not the C libraries (SDL, libpng).
+ *
+ * Tracking is opt-in: it is compiled in only when ENABLE_ALLOC_TRACKING is defined (see the Jamfile);
+ *  otherwise the global allocator is untouched and ALLOC_SCOPE expands to nothing.
+ */
+
+#ifdef ENABLE_ALLOC_TRACKING
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+struct AllocTracker {
+	struct Stats {
+		char const *tag = "";
+		uint64_t allocations = 0;
+		uint64_t frees = 0;
+		uint64_t allocated_bytes = 0;
+		uint64_t freed_bytes = 0;
+		uint64_t live_bytes() const { return allocated_bytes - freed_bytes; }
+		uint64_t live_blocks() const { return allocations - frees; }
+	};
+
+	//look up (or register) a tag by name; there is room for MaxTags tags:
+	static uint32_t tag(char const *name);
+	static constexpr uint32_t MaxTags = 32;
+
+	//sets the calling thread's current tag; restores the previous one on destruction:
+	struct Scope {
+		Scope(uint32_t tag);
+		~Scope();
+		Scope(Scope const &) = delete;
+		Scope &operator=(Scope const &) = delete;
+		uint32_t previous;
+	};
+
+	//totals since startup, overall and per tag (tags in registration order):
+	static Stats total();
+	static std::vector< Stats > by_tag();
+
+	//end the current frame: the frame's counts become available via last_frame():
+	static void end_frame();
+	static Stats const &last_frame();
+
+	//largest resident set size the process has had, in bytes (0 if unknown):
+	static uint64_t peak_rss();
+
+	//per-tag totals, live bytes and peak RSS:
+	static void report(std::ostream &out);
+	//every tag that still has live allocations:
+	static void report_leaks(std::ostream &out);
+};
+
+#define ALLOC_CONCAT2(A, B) A ## B
+#define ALLOC_CONCAT(A, B) ALLOC_CONCAT2(A, B)
+#define ALLOC_SCOPE(NAME) \
+	static uint32_t const ALLOC_CONCAT(alloc_tag_, __LINE__) = AllocTracker::tag(NAME); \
+	AllocTracker::Scope ALLOC_CONCAT(alloc_scope_, __LINE__)(ALLOC_CONCAT(alloc_tag_, __LINE__))
+
+#else //ENABLE_ALLOC_TRACKING
+
+#define ALLOC_SCOPE(NAME) do { } while (0)
+
+#endif //ENABLE_ALLOC_TRACKING
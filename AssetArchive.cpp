@@ -0,0 +1,98 @@
+#include "AssetArchive.hpp"
+
+#include "hash.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+AssetArchive::AssetArchive(std::string const &filename) : file(filename) {
+	if (file.size < sizeof(Header)) {
+		throw std::runtime_error("Archive '" + filename + "' is too small to be valid.");
+	}
+	Header const &header = *reinterpret_cast< Header const * >(file.data);
+	if (std::memcmp(header.magic, "pak0", 4) != 0 || header.version != Version) {
+		throw std::runtime_error("Archive '" + filename + "' has the wrong magic or version.");
+	}
+	count = header.count;
+	if (file.size < sizeof(Header) + uint64_t(count) * sizeof(Entry)) {
+		throw std::runtime_error("Archive '" + filename + "' index is truncated.");
+	}
+	index = reinterpret_cast< Entry const * >(file.data + sizeof(Header));
+	for (uint32_t i = 0; i < count; ++i) {
+		if (index[i].offset > file.size || index[i].size > file.size - index[i].offset) {
+			throw std::runtime_error("Archive '" + filename + "' has an entry past the end of the file.");
+		}
+	}
+}
+
+AssetArchive::Blob AssetArchive::find(std::string const &name) const {
+	uint64_t name_hash = hash_fnv1a(name);
+	Entry const *end = index + count;
+	Entry const *f = std::lower_bound(index, end, name_hash, [](Entry const &e, uint64_t h){
+		return e.name_hash < h;
+	});
+	Blob blob;
+	if (f != end && f->name_hash == name_hash) {
+		blob.data = file.data + f->offset;
+		blob.size = size_t(f->size);
+	}
+	return blob;
+}
+
+AssetArchive::Blob AssetArchive::lookup(std::string const &name) const {
+	Blob blob = find(name);
+	if (!blob) {
+		throw std::runtime_error("Archive '" + file.filename + "' has no asset named '" + name + "'.");
+	}
+	return blob;
+}
+
+void AssetArchive::write(std::string const &filename, std::vector< std::pair< std::string, std::vector< uint8_t > > > const &assets) {
+	std::vector< Entry > entries;
+	entries.reserve(assets.size());
+	for (auto const &asset : assets) {
+		entries.emplace_back(Entry{hash_fnv1a(asset.first), 0, asset.second.size()});
+	}
+
+	//blobs are stored in input order, after the index:
+	uint64_t offset = sizeof(Header) + entries.size() * sizeof(Entry);
+	for (auto &entry : entries) {
+		offset = (offset + Alignment - 1) / Alignment * Alignment;
+		entry.offset = offset;
+		offset += entry.size;
+	}
+
+	std::vector< uint32_t > order(entries.size());
+	for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+	std::sort(order.begin(), order.end(), [&entries](uint32_t a, uint32_t b){
+		return entries[a].name_hash < entries[b].name_hash;
+	});
+	for (uint32_t i = 1; i < order.size(); ++i) {
+		if (entries[order[i-1]].name_hash == entries[order[i]].name_hash) {
+			throw std::runtime_error("Asset names '" + assets[order[i-1]].first + "' and '" + assets[order[i]].first + "' have the same hash.");
+		}
+	}
+
+	std::ofstream out(filename, std::ios::binary);
+	Header header;
+	std::memcpy(header.magic, "pak0", 4);
+	header.version = Version;
+	header.count = uint32_t(entries.size());
+	header.reserved = 0;
+	out.write(reinterpret_cast< char const * >(&header), sizeof(header));
+	for (uint32_t i : order) {
+		out.write(reinterpret_cast< char const * >(&entries[i]), sizeof(Entry));
+	}
+	uint64_t at = sizeof(Header) + entries.size() * sizeof(Entry);
+	for (uint32_t i = 0; i < entries.size(); ++i) {
+		static const char zeros[Alignment] = { 0 };
+		out.write(zeros, entries[i].offset - at);
+		out.write(reinterpret_cast< char const * >(assets[i].second.data()), assets[i].second.size());
+		at = entries[i].offset + entries[i].size;
+	}
+	if (!out) {
+		throw std::runtime_error("Failed to write archive '" + filename + "'.");
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "MappedFile.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * AssetArchive reads a packed asset file (built by the 'pack-assets' tool) through a single mmap.
+ *
+ * File layout (all integers little-endian):
+ *   Header { magic "pak0", version, count, reserved }
+ *   Entry index[count] { name_hash, offset, size }, sorted by name_hash
+ *   blobs, each starting at a 16-byte-aligned offset
+ *
+ * Names are not stored; lookups hash the name (hash_fnv1a) and binary-search the index.
+ * Blobs point directly into the mapping, so they stay valid as long as the archive does.
+ */
+
+struct AssetArchive {
+	//throws if the file can't be mapped or isn't a valid archive:
+	AssetArchive(std::string const &filename);
+
+	struct Blob {
+		uint8_t const *data = nullptr;
+		size_t size = 0;
+		explicit operator bool() const { return data != nullptr; }
+	};
+
+	//find a blob by name; returns an empty Blob if missing:
+	Blob find(std::string const &name) const;
+	//as above, but throws if missing:
+	Blob lookup(std::string const &name) const;
+
+	//----- file format -----
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint32_t count;
+		uint32_t reserved;
+	};
+	static_assert(sizeof(Header) == 16, "AssetArchive::Header should be packed");
+
+	struct Entry {
+		uint64_t name_hash;
+		uint64_t offset;
+		uint64_t size;
+	};
+	static_assert(sizeof(Entry) == 24, "AssetArchive::Entry should be packed");
+
+	static constexpr uint32_t Version = 1;
+	static constexpr uint64_t Alignment = 16;
+
+	//write an archive from (name, contents) pairs; throws on error (including hash collisions):
+	static void write(std::string const &filename, std::vector< std::pair< std::string, std::vector< uint8_t > > > const &assets);
+
+	//----- internals -----
+	MappedFile file;
+	Entry const *index = nullptr;
+	uint32_t count = 0;
+};
@@ -0,0 +1,158 @@
+#include "AssetLoader.hpp"
+
+#include "gl_errors.hpp"
+#include "CPUProfiler.hpp"
+
+#include <stdexcept>
+
+AssetLoader::AssetLoader(uint32_t workers) : start(Clock::now()), pool(workers) {
+}
+
+AssetLoader::~AssetLoader() {
+	//let any in-flight decodes finish before freeing textures:
+	pool.wait();
+
+	for (auto &texture : textures) {
+		if (texture->tex != 0 && !texture->atlas) {
+			glDeleteTextures(1, &texture->tex);
+			texture->tex = 0;
+		}
+	}
+}
+
+AssetLoader::Texture const *AssetLoader::load_texture(std::string const &filename, OriginLocation origin) {
+	textures.emplace_back(new Texture);
+	Texture *texture = textures.back().get();
+	texture->filename = filename;
+	texture->origin = origin;
+	queue(texture);
+	return texture;
+}
+
+AssetLoader::Texture const *AssetLoader::load_sprite(TextureAtlas *atlas, GLuint atlas_tex, std::string const &name, std::string const &filename) {
+	textures.emplace_back(new Texture);
+	Texture *texture = textures.back().get();
+	texture->filename = filename;
+	texture->origin = LowerLeftOrigin; //(as atlases are)
+	texture->atlas = atlas;
+	texture->sprite = name;
+	texture->tex = atlas_tex;
+	queue(texture);
+	return texture;
+}
+
+void AssetLoader::queue(Texture *texture) {
+	Clock::time_point queued = Clock::now();
+	pool.run([this, texture, queued](){
+		Clock::time_point before = Clock::now();
+		texture->queue_time = std::chrono::duration< float >(before - queued).count();
+
+		PROFILE_ZONE("decode png");
+
+		Decoded result;
+		result.texture = texture;
+		try {
+			AssetArchive::Blob blob;
+			if (archive) blob = archive->find(texture->filename);
+			if (blob) {
+				load_png(blob.data, blob.size, texture->filename, &texture->size, &result.data, texture->origin);
+			} else {
+				load_png(texture->filename, &texture->size, &result.data, texture->origin);
+			}
+		} catch (std::exception const &e) {
+			result.error = e.what();
+		}
+
+		texture->decode_time = std::chrono::duration< float >(Clock::now() - before).count();
+
+		std::unique_lock< std::mutex > lock(decoded_mutex);
+		decoded.emplace_back(std::move(result));
+	});
+}
+
+uint32_t AssetLoader::upload(uint32_t max_uploads) {
+	PROFILE_ZONE("upload textures");
+	uint32_t count = 0;
+	while (count < max_uploads) {
+		Decoded next;
+		{
+			std::unique_lock< std::mutex > lock(decoded_mutex);
+			if (decoded.empty()) break;
+			next = std::move(decoded.front());
+			decoded.pop_front();
+		}
+		Texture &texture = *next.texture;
+		if (!next.error.empty()) {
+			throw std::runtime_error("Failed to load texture '" + texture.filename + "': " + next.error);
+		}
+
+		Clock::time_point before = Clock::now();
+
+		if (texture.atlas) {
+			//pack the sprite, then copy just its (padded) rectangle from the atlas image into the atlas texture:
+			TextureAtlas &atlas = *texture.atlas;
+			if (!atlas.add(texture.sprite, texture.size, next.data.data())) {
+				throw std::runtime_error("No room in atlas for sprite '" + texture.sprite + "' from '" + texture.filename + "'.");
+			}
+			TextureAtlas::Sprite const &sprite = atlas.lookup(texture.sprite);
+			glm::uvec2 min = sprite.min_px - glm::uvec2(atlas.padding);
+			glm::uvec2 size = sprite.size_px + glm::uvec2(2 * atlas.padding);
+			glBindTexture(GL_TEXTURE_2D, texture.tex);
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, atlas.size.x);
+			glPixelStorei(GL_UNPACK_SKIP_PIXELS, min.x);
+			glPixelStorei(GL_UNPACK_SKIP_ROWS, min.y);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, min.x, min.y, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, atlas.pixels.data());
+			glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+			glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+			glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		} else {
+			glGenTextures(1, &texture.tex);
+			glBindTexture(GL_TEXTURE_2D, texture.tex);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture.size.x, texture.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, next.data.data());
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			glGenerateMipmap(GL_TEXTURE_2D);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+
+		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+
+		texture.upload_time = std::chrono::duration< float >(Clock::now() - before).count();
+		texture.ready = true;
+
+		uploaded += 1;
+		count += 1;
+	}
+	return count;
+}
+
+void AssetLoader::finish() {
+	while (!done()) {
+		if (upload(~0U) == 0) {
+			//nothing decoded yet; wait for the workers rather than spin:
+			pool.wait();
+		}
+	}
+}
+
+void AssetLoader::report(std::ostream &to) const {
+	float decode_total = 0.0f;
+	float upload_total = 0.0f;
+	for (auto const &texture : textures) {
+		to << "  '" << texture->filename << "' " << texture->size.x << "x" << texture->size.y
+		   << ": queued " << texture->queue_time * 1000.0f << "ms"
+		   << ", decode " << texture->decode_time * 1000.0f << "ms"
+		   << ", upload " << texture->upload_time * 1000.0f << "ms"
+		   << (texture->ready ? "" : " (not uploaded)") << "\n";
+		decode_total += texture->decode_time;
+		upload_total += texture->upload_time;
+	}
+	float wall = std::chrono::duration< float >(Clock::now() - start).count();
+	to << "Loaded " << uploaded << "/" << textures.size() << " textures on " << pool.size() << " workers"
+	   << ": decode " << decode_total * 1000.0f << "ms (summed)"
+	   << ", upload " << upload_total * 1000.0f << "ms"
+	   << ", wall " << wall * 1000.0f << "ms." << std::endl;
+}
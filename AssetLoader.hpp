@@ -0,0 +1,104 @@
+#pragma once
+
+#include "GL.hpp"
+#include "AssetArchive.hpp"
+#include "ThreadPool.hpp"
+#include "TextureAtlas.hpp"
+#include "load_save_png.hpp"
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+ * AssetLoader loads PNG textures in two stages:
+ *  - decoding (file read + load_png) runs concurrently on ThreadPool workers;
+ *  - uploading (glTexImage2D + mipmaps) runs on the GL thread, a few textures per upload() call.
+ * PNGs can also be loaded as sprites, packed into a TextureAtlas whose texture already exists; uploading
+ *  one only copies its rectangle into that texture.
+ *
+ * Typical use:
+ *   AssetLoader loader;
+ *   AssetLoader::Texture const *tex = loader.load_texture("sprite.png");
+ *   ... queue more ...
+ *   loader.finish(); //or call loader.upload() once per frame and check loader.done()
+ */
+
+struct AssetLoader {
+	//decode with the given number of workers (0 => one per spare core):
+	AssetLoader(uint32_t workers = 0);
+	~AssetLoader();
+
+	struct Texture {
+		std::string filename;
+		OriginLocation origin = LowerLeftOrigin;
+
+		//if set, the image is packed into this atlas (as sprite 'sprite') instead of getting its own texture:
+		TextureAtlas *atlas = nullptr;
+		std::string sprite;
+
+		//filled in once uploaded (for sprites, 'tex' is the atlas texture, which the loader doesn't own):
+		GLuint tex = 0;
+		glm::uvec2 size = glm::uvec2(0);
+		bool ready = false;
+
+		//timings, in seconds:
+		float queue_time = 0.0f; //waiting for a worker
+		float decode_time = 0.0f; //reading + decoding on a worker
+		float upload_time = 0.0f; //glTexImage2D + mipmap generation on the GL thread
+	};
+
+	//queue a texture for loading; the returned pointer stays valid for the loader's lifetime.
+	// (the texture object is owned by the loader and freed with it)
+	Texture const *load_texture(std::string const &filename, OriginLocation origin = LowerLeftOrigin);
+
+	//queue a png to be added to 'atlas' as sprite 'name' and copied into 'atlas_tex' (a texture holding the
+	// atlas image, without mipmaps); upload() throws if it doesn't fit. Only upload() touches the atlas:
+	Texture const *load_sprite(TextureAtlas *atlas, GLuint atlas_tex, std::string const &name, std::string const &filename);
+
+	//upload up to 'max_uploads' decoded textures; call from the GL thread.
+	// returns the number of textures uploaded.
+	// throws if a texture failed to decode.
+	uint32_t upload(uint32_t max_uploads = 4);
+
+	//true once every queued texture has been uploaded:
+	bool done() const { return uploaded == textures.size(); }
+
+	//upload everything, waiting for workers as needed:
+	void finish();
+
+	//print per-asset timings and totals:
+	void report(std::ostream &to = std::cout) const;
+
+	//if set, textures found in this archive are decoded straight from its mapping
+	// instead of being opened as loose files (must outlive any queued loads):
+	AssetArchive const *archive = nullptr;
+
+	//----- internals -----
+	typedef std::chrono::high_resolution_clock Clock;
+
+	struct Decoded {
+		Texture *texture = nullptr;
+		std::vector< glm::u8vec4 > data;
+		std::string error; //non-empty if decoding failed
+	};
+
+	//start decoding a texture on a worker:
+	void queue(Texture *texture);
+
+	std::deque< std::unique_ptr< Texture > > textures;
+	size_t uploaded = 0;
+	Clock::time_point start;
+
+	std::mutex decoded_mutex;
+	std::deque< Decoded > decoded; //finished decodes, waiting for upload
+
+	//declared last so workers are joined before the members they touch are destroyed:
+	ThreadPool pool;
+};
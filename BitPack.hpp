@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * BitWriter / BitReader pack unsigned fields of 1-32 bits into a byte buffer, least significant bit first
+ *  (fields to pass over -- of any length -- are BitReader::skip()'d, not read).
+ * Neither allocates: a writer that runs out of room (or a reader that runs off the end) sets a flag
+ *  and ignores the rest, so callers check once at the end.
+ */
+
+struct BitWriter {
+	BitWriter(uint8_t *data_, size_t capacity_) : data(data_), capacity(capacity_) { }
+
+	void write(uint32_t value, uint32_t bits) {
+		assert(bits >= 1 && bits <= 32);
+		if (at + bits > capacity * 8) {
+			overflowed = true;
+			return;
+		}
+		while (bits) {
+			uint32_t shift = uint32_t(at % 8);
+			uint32_t take = (bits < 8 - shift ? bits : 8 - shift);
+			uint8_t &byte = data[at / 8];
+			if (shift == 0) byte = 0;
+			byte |= uint8_t((value & ((1u << take) - 1u)) << shift);
+			value = (take < 32 ? value >> take : 0);
+			bits -= take;
+			at += take;
+		}
+	}
+	void write_bool(bool value) { write(value ? 1 : 0, 1); }
+
+	size_t bits() const { return at; }
+	size_t bytes() const { return (at + 7) / 8; }
+
+	uint8_t *data;
+	size_t capacity; //bytes
+	size_t at = 0; //bits written
+	bool overflowed = false;
+};
+
+struct BitReader {
+	BitReader(uint8_t const *data_, size_t size_) : data(data_), size(size_) { }
+
+	uint32_t read(uint32_t bits) {
+		assert(bits >= 1 && bits <= 32);
+		if (at + bits > size * 8) {
+			failed = true;
+			at = size * 8;
+			return 0;
+		}
+		uint32_t value = 0;
+		uint32_t got = 0;
+		while (got < bits) {
+			uint32_t shift = uint32_t(at % 8);
+			uint32_t take = (bits - got < 8 - shift ? bits - got : 8 - shift);
+			value |= uint32_t((data[at / 8] >> shift) & ((1u << take) - 1u)) << got;
+			got += take;
+			at += take;
+		}
+		return value;
+	}
+	bool read_bool() { return read(1) != 0; }
+	//pass over 'bits' bits:
+	void skip(size_t bits) {
+		if (at + bits > size * 8) {
+			failed = true;
+			at = size * 8;
+			return;
+		}
+		at += bits;
+	}
+
+	uint8_t const *data;
+	size_t size; //bytes
+	size_t at = 0; //bits read
+	bool failed = false;
+};
@@ -0,0 +1,124 @@
+#include "CPUProfiler.hpp"
+
+#ifdef ENABLE_PROFILER
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+constexpr uint32_t CPUProfiler::Capacity;
+
+namespace {
+	struct Event {
+		char const *name;
+		uint64_t begin, end;
+	};
+
+	//one per thread that has ever recorded a zone (or been named);
+	// kept after the thread exits so its zones can still be exported:
+	struct ThreadBuffer {
+		uint32_t tid = 0;
+		std::string name;
+		std::vector< Event > events; //ring buffer, allocated on first record()
+		std::atomic< uint64_t > written{0}; //events ever recorded; only the owning thread stores to this
+	};
+
+	//registry of every thread's buffer, guarded by a mutex that is only taken
+	// the first time a thread records and when exporting:
+	struct Registry {
+		std::mutex mutex;
+		std::vector< std::unique_ptr< ThreadBuffer > > buffers;
+		uint64_t epoch = CPUProfiler::now(); //trace timestamps are relative to this
+	};
+	Registry &registry() {
+		static Registry *registry = new Registry; //never freed: threads may record during static destruction
+		return *registry;
+	}
+
+	thread_local ThreadBuffer *thread_buffer = nullptr;
+
+	ThreadBuffer &get_thread_buffer() {
+		if (!thread_buffer) {
+			Registry &reg = registry();
+			std::unique_lock< std::mutex > lock(reg.mutex);
+			reg.buffers.emplace_back(new ThreadBuffer);
+			thread_buffer = reg.buffers.back().get();
+			thread_buffer->tid = uint32_t(reg.buffers.size());
+			thread_buffer->name = "thread " + std::to_string(thread_buffer->tid);
+		}
+		return *thread_buffer;
+	}
+
+	void write_json_string(std::ostream &out, char const *str) {
+		out << '"';
+		for (char const *c = str; *c; ++c) {
+			if (*c == '"' || *c == '\\') out << '\\' << *c;
+			else if (uint8_t(*c) < 0x20) out << ' ';
+			else out << *c;
+		}
+		out << '"';
+	}
+}
+
+void CPUProfiler::record(char const *name, uint64_t begin, uint64_t end) {
+	ThreadBuffer &buffer = get_thread_buffer();
+	if (buffer.events.empty()) buffer.events.resize(Capacity);
+
+	uint64_t index = buffer.written.load(std::memory_order_relaxed);
+	Event &event = buffer.events[index % Capacity];
+	event.name = name;
+	event.begin = begin;
+	event.end = end;
+	//publish the event to write_chrome_trace():
+	buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void CPUProfiler::set_thread_name(std::string const &name) {
+	ThreadBuffer &buffer = get_thread_buffer();
+	std::unique_lock< std::mutex > lock(registry().mutex);
+	buffer.name = name;
+}
+
+void CPUProfiler::write_chrome_trace(std::string const &filename) {
+	std::ofstream out(filename, std::ios::binary);
+	if (!out) throw std::runtime_error("Failed to open '" + filename + "' for writing trace.");
+
+	Registry &reg = registry();
+	std::unique_lock< std::mutex > lock(reg.mutex);
+
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	auto separator = [&]() {
+		if (!first) out << ",\n";
+		first = false;
+	};
+	out.precision(3);
+	out.setf(std::ios::fixed);
+	for (auto const &buffer : reg.buffers) {
+		separator();
+		out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{\"name\":";
+		write_json_string(out, buffer->name.c_str());
+		out << "}}";
+
+		uint64_t written = buffer->written.load(std::memory_order_acquire);
+		uint64_t begin = (written > Capacity ? written - Capacity : 0);
+		for (uint64_t i = begin; i < written; ++i) {
+			Event const &event = buffer->events[i % Capacity];
+			separator();
+			out << "{\"ph\":\"X\",\"name\":";
+			write_json_string(out, event.name);
+			//trace-event timestamps are in microseconds:
+			out << ",\"pid\":1,\"tid\":" << buffer->tid
+			    << ",\"ts\":" << double(int64_t(event.begin - reg.epoch)) * 1.0e-3
+			    << ",\"dur\":" << double(event.end - event.begin) * 1.0e-3 << "}";
+		}
+	}
+	out << "\n]}\n";
+
+	if (!out) throw std::runtime_error("Failed to write trace to '" + filename + "'.");
+}
+
+#endif //ENABLE_PROFILER
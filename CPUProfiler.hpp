@@ -0,0 +1,76 @@
+#pragma once
+
+/*
+ * CPUProfiler records named, scoped time zones on any thread and exports them
+ *  as Chrome trace-event JSON (load in chrome://tracing or ui.perfetto.dev).
+ *
+ * Use the macros rather than the struct directly:
+ *   PROFILE_ZONE("update");          //times the rest of the enclosing scope
+ *   PROFILE_ZONE_NAMED(zone, "build"); //...or until PROFILE_ZONE_END(zone), if that comes first
+ *   PROFILE_THREAD_NAME("worker 2"); //labels the calling thread's row in the trace
+ *   PROFILE_WRITE_TRACE("trace.json");
+ *
+ * Zone names must be string literals (only the pointer is stored).
+ *
+ * Each thread appends to its own fixed-size ring of events, so recording takes no locks;
+ *  once a ring is full, a thread's oldest events are overwritten.
+ *
+ * Profiling is compiled in only when ENABLE_PROFILER is defined (see the Jamfile);
+ *  otherwise every macro expands to nothing.
+ */
+
+#ifdef ENABLE_PROFILER
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+struct CPUProfiler {
+	struct Zone {
+		Zone(char const *name_) : name(name_), begin(now()) { }
+		~Zone() { end(); }
+		void end() {
+			if (name) record(name, begin, now());
+			name = nullptr;
+		}
+		Zone(Zone const &) = delete;
+		Zone &operator=(Zone const &) = delete;
+		char const *name;
+		uint64_t begin;
+	};
+
+	//nanoseconds on a monotonic clock:
+	static uint64_t now() {
+		return uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	//append a finished zone to the calling thread's ring:
+	static void record(char const *name, uint64_t begin, uint64_t end);
+
+	static void set_thread_name(std::string const &name);
+
+	//write every thread's recorded zones; throws on failure.
+	// (zones being recorded while this runs may come out torn, so call it between frames.)
+	static void write_chrome_trace(std::string const &filename);
+
+	//events kept per thread:
+	static constexpr uint32_t Capacity = 1 << 16;
+};
+
+#define PROFILE_CONCAT2(A, B) A ## B
+#define PROFILE_CONCAT(A, B) PROFILE_CONCAT2(A, B)
+#define PROFILE_ZONE(NAME) CPUProfiler::Zone PROFILE_CONCAT(profile_zone_, __LINE__)(NAME)
+#define PROFILE_ZONE_NAMED(VAR, NAME) CPUProfiler::Zone VAR(NAME)
+#define PROFILE_ZONE_END(VAR) VAR.end()
+#define PROFILE_THREAD_NAME(NAME) CPUProfiler::set_thread_name(NAME)
+#define PROFILE_WRITE_TRACE(FILENAME) CPUProfiler::write_chrome_trace(FILENAME)
+
+#else //ENABLE_PROFILER
+
+#define PROFILE_ZONE(NAME) do { } while (0)
+#define PROFILE_ZONE_NAMED(VAR, NAME) do { } while (0)
+#define PROFILE_ZONE_END(VAR) do { } while (0)
+#define PROFILE_THREAD_NAME(NAME) do { } while (0)
+#define PROFILE_WRITE_TRACE(FILENAME) do { } while (0)
+
+#endif //ENABLE_PROFILER
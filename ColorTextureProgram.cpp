@@ -1,17 +1,20 @@
 #include "ColorTextureProgram.hpp"
 
 #include "gl_compile_program.hpp"
+#include "FrameUniforms.hpp"
 #include "gl_errors.hpp"
 
-ColorTextureProgram::ColorTextureProgram() {
-	//Compile vertex and fragment shaders using the convenient 'gl_compile_program' helper function:
-	program = gl_compile_program(
+#include <stdexcept>
+
+ColorTextureProgram::ColorTextureProgram(GLProgramBatch &batch_) : batch(&batch_) {
+	//Start compiling vertex and fragment shaders (results are only asked for in get()):
+	batch_index = batch->submit("color_texture",
 		//vertex shader:
-		"#version 330\n"
-		"uniform mat4 OBJECT_TO_CLIP;\n"
-		"in vec4 Position;\n"
-		"in vec4 Color;\n"
-		"in vec2 TexCoord;\n"
+		std::string("#version 330\n")
+		+ FrameUniforms::GLSL +
+		"layout(location = 0) in vec4 Position;\n"
+		"layout(location = 1) in vec4 Color;\n"
+		"layout(location = 2) in vec2 TexCoord;\n"
 		"out vec4 color;\n"
 		"out vec2 texCoord;\n"
 		"void main() {\n"
@@ -32,15 +35,26 @@ ColorTextureProgram::ColorTextureProgram() {
 	);
 	//As you can see above, adjacent strings in C/C++ are concatenated.
 	// this is very useful for writing long shader programs inline.
+}
 
-	//look up the locations of vertex attributes:
-	Position_vec4 = glGetAttribLocation(program, "Position");
-	Color_vec4 = glGetAttribLocation(program, "Color");
-	TexCoord_vec2 = glGetAttribLocation(program, "TexCoord");
+GLuint ColorTextureProgram::get() {
+	if (!batch) return program;
+	program = batch->get(batch_index);
+	batch = nullptr;
+
+	//enumerate active variables once, then check the vertex attributes are where the shader puts them:
+	reflection = GLProgramReflection(program);
+	if (reflection.require_attribute("Position") != Position_vec4
+	 || reflection.require_attribute("Color") != Color_vec4
+	 || reflection.require_attribute("TexCoord") != TexCoord_vec2) {
+		throw std::runtime_error("ColorTextureProgram's attributes aren't at the locations its shader gives them.");
+	}
+
+	//OBJECT_TO_CLIP comes from the shared per-frame uniform buffer:
+	FrameUniforms::attach(program, reflection);
 
 	//look up the locations of uniforms:
-	OBJECT_TO_CLIP_mat4 = glGetUniformLocation(program, "OBJECT_TO_CLIP");
-	GLuint TEX_sampler2D = glGetUniformLocation(program, "TEX");
+	GLint TEX_sampler2D = reflection.require_uniform("TEX");
 
 	//set TEX to always refer to texture binding zero:
 	glUseProgram(program); //bind program -- glUniform* calls refer to this program now
@@ -48,9 +62,12 @@ ColorTextureProgram::ColorTextureProgram() {
 	glUniform1i(TEX_sampler2D, 0); //set TEX to sample from GL_TEXTURE0
 
 	glUseProgram(0); //unbind program -- glUniform* calls refer to ??? now
+
+	return program;
 }
 
 ColorTextureProgram::~ColorTextureProgram() {
+	//(a program never claimed with get() is deleted by its batch)
 	glDeleteProgram(program);
 	program = 0;
 }
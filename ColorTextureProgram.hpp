@@ -1,21 +1,34 @@
 #pragma once
 
 #include "GL.hpp"
+#include "gl_program_reflection.hpp"
+
+struct GLProgramBatch;
 
 //Shader program that draws transformed, textured vertices tinted with vertex colors:
 struct ColorTextureProgram {
-	ColorTextureProgram();
+	//submits the program to 'batch', which compiles it alongside other startup work; 'batch' must
+	// stay alive until the first get():
+	ColorTextureProgram(GLProgramBatch &batch);
 	~ColorTextureProgram();
 
-	GLuint program = 0;
+	//the program, ready to draw with (the first call waits for it to link, then finishes setting it up):
+	GLuint get();
+
+	GLuint program = 0; //(0 until the first get())
+	GLProgramBatch *batch = nullptr; //(until the first get())
+	uint32_t batch_index = 0;
+
+	//Attribute (per-vertex variable) locations, fixed in the shader so vertex arrays can be set up before linking:
+	GLuint Position_vec4 = 0;
+	GLuint Color_vec4 = 1;
+	GLuint TexCoord_vec2 = 2;
 
-	//Attribute (per-vertex variable) locations:
-	GLuint Position_vec4 = -1U;
-	GLuint Color_vec4 = -1U;
-	GLuint TexCoord_vec2 = -1U;
+	//Active attributes/uniforms/blocks, enumerated once after linking:
+	GLProgramReflection reflection;
 
-	//Uniform (per-invocation variable) locations:
-	GLuint OBJECT_TO_CLIP_mat4 = -1U;
+	//Uniform blocks:
+	//Frame - per-frame constants (OBJECT_TO_CLIP), from FrameUniforms
 
 	//Textures:
 	//TEXTURE0 - texture that is accessed by TexCoord
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Fixed is a Q16.16 fixed-point number: a 32-bit integer counting 1/65536ths.
+ * Arithmetic on it is plain integer arithmetic, so it gives the same bits on every compiler, optimization
+ *  setting, and instruction set -- unlike float math through std::pow and friends, or under -ffast-math.
+ * (PongSim uses it for its fixed-point physics mode; see Scenario's 'physics' record.)
+ *
+ * Range is about +/-32768 with a resolution of about 0.000015; conversions from float round to nearest
+ *  and saturate, and arithmetic does not check for overflow.
+ * Values within +/-128 convert to float and back exactly, so fixed-point state can be kept in floats.
+ */
+
+struct Fixed {
+	static constexpr int32_t One = 0x10000;
+
+	int32_t raw = 0;
+
+	constexpr Fixed() = default;
+	explicit constexpr Fixed(float f) : raw(
+		f >= 32767.0f ? INT32_MAX :
+		f <= -32767.0f ? -INT32_MAX :
+		int32_t(f * float(One) + (f < 0.0f ? -0.5f : 0.5f))) { }
+	explicit constexpr operator float() const { return float(raw) / float(One); }
+
+	static constexpr Fixed from_raw(int32_t raw) {
+		Fixed ret;
+		ret.raw = raw;
+		return ret;
+	}
+
+	constexpr Fixed operator-() const { return from_raw(-raw); }
+	constexpr Fixed operator+(Fixed o) const { return from_raw(raw + o.raw); }
+	constexpr Fixed operator-(Fixed o) const { return from_raw(raw - o.raw); }
+	//(products round to nearest; quotients truncate toward zero)
+	constexpr Fixed operator*(Fixed o) const { return from_raw(int32_t((int64_t(raw) * o.raw + One / 2) >> 16)); }
+	constexpr Fixed operator/(Fixed o) const { return from_raw(int32_t(int64_t(raw) * One / o.raw)); }
+	Fixed &operator+=(Fixed o) { raw += o.raw; return *this; }
+	Fixed &operator-=(Fixed o) { raw -= o.raw; return *this; }
+
+	constexpr bool operator==(Fixed o) const { return raw == o.raw; }
+	constexpr bool operator!=(Fixed o) const { return raw != o.raw; }
+	constexpr bool operator<(Fixed o) const { return raw < o.raw; }
+	constexpr bool operator>(Fixed o) const { return raw > o.raw; }
+	constexpr bool operator<=(Fixed o) const { return raw <= o.raw; }
+	constexpr bool operator>=(Fixed o) const { return raw >= o.raw; }
+};
+
+//the usual helpers, found by argument-dependent lookup, so templated code can call them unqualified for float or Fixed:
+inline constexpr Fixed abs(Fixed x) { return x.raw < 0 ? -x : x; }
+inline constexpr Fixed min(Fixed a, Fixed b) { return b < a ? b : a; }
+inline constexpr Fixed max(Fixed a, Fixed b) { return a < b ? b : a; }
+inline constexpr Fixed mix(Fixed a, Fixed b, Fixed t) { return a * (Fixed(1.0f) - t) + b * t; }
+
+//2^x, to within a few units of the last place for small x; saturates for x >= 15:
+inline Fixed exp2(Fixed x) {
+	int32_t whole = x.raw >> 16; //(floor, so the fraction below is in [0,1))
+	Fixed frac = Fixed::from_raw(x.raw & (Fixed::One - 1));
+	if (whole >= 15) return Fixed::from_raw(INT32_MAX);
+	if (whole < -16) return Fixed();
+	//2^f = e^(f ln 2), by its Taylor series (terms past f^6 are below the resolution):
+	Fixed poly = Fixed(0.0001540353f);
+	poly = poly * frac + Fixed(0.0013333558f);
+	poly = poly * frac + Fixed(0.0096181291f);
+	poly = poly * frac + Fixed(0.0555041087f);
+	poly = poly * frac + Fixed(0.2402265070f);
+	poly = poly * frac + Fixed(0.6931471806f);
+	poly = poly * frac + Fixed(1.0f);
+	if (whole < 0) return Fixed::from_raw(poly.raw >> -whole);
+	int64_t scaled = int64_t(poly.raw) << whole;
+	return Fixed::from_raw(scaled > INT32_MAX ? INT32_MAX : int32_t(scaled));
+}
+
+//sin(2 pi x) -- x in turns, so whole turns drop off exactly -- to within a few units of the last place:
+inline Fixed sin_turns(Fixed x) {
+	int32_t t = x.raw & (Fixed::One - 1); //(fraction of a turn, in [0,1))
+	bool negative = (t >= Fixed::One / 2); //(sin(a + pi) = -sin(a))
+	if (negative) t -= Fixed::One / 2;
+	if (t > Fixed::One / 4) t = Fixed::One / 2 - t; //(sin(pi - a) = sin(a))
+	Fixed u = Fixed::from_raw(t * 4); //quarter turns, in [0,1]
+	Fixed u2 = u * u;
+	//sin(u pi/2), by its Taylor series (terms past u^9 are below the resolution):
+	Fixed poly = Fixed(0.0001604413f);
+	poly = poly * u2 - Fixed(0.0046817541f);
+	poly = poly * u2 + Fixed(0.0796926262f);
+	poly = poly * u2 - Fixed(0.6459640975f);
+	poly = poly * u2 + Fixed(1.5707963268f);
+	poly = poly * u;
+	return negative ? -poly : poly;
+}
@@ -0,0 +1,43 @@
+#include "FrameUniforms.hpp"
+
+#include "gl_errors.hpp"
+
+#include <stdexcept>
+
+char const *FrameUniforms::GLSL =
+	"layout(std140) uniform Frame {\n"
+	"	mat4 OBJECT_TO_CLIP;\n"
+	"};\n"
+;
+
+FrameUniforms::FrameUniforms() {
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(Data), &data, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	//binding points are context state, so this only needs to happen once:
+	glBindBufferBase(GL_UNIFORM_BUFFER, Binding, buffer);
+
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+}
+
+FrameUniforms::~FrameUniforms() {
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void FrameUniforms::upload() {
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Data), &data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void FrameUniforms::attach(GLuint program, GLProgramReflection const &reflection) {
+	auto f = reflection.blocks.find("Frame");
+	if (f == reflection.blocks.end()) return; //program doesn't use per-frame data
+	if (f->second.data_size != GLint(sizeof(Data))) {
+		throw std::runtime_error("Program's Frame block is " + std::to_string(f->second.data_size) + " bytes; expected " + std::to_string(sizeof(Data)) + ".");
+	}
+	glUniformBlockBinding(program, f->second.index, Binding);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "GL.hpp"
+#include "gl_program_reflection.hpp"
+
+#include <glm/glm.hpp>
+
+//Per-frame constants, shared by every program through a single uniform buffer.
+// upload() once per frame; programs that declare the block (paste FrameUniforms::GLSL into the shader)
+// and call FrameUniforms::attach() read from it without any per-program glUniform* calls.
+struct FrameUniforms {
+	FrameUniforms();
+	~FrameUniforms();
+
+	//uniform buffer binding point the block is always bound to:
+	static constexpr GLuint Binding = 0;
+
+	//std140 block declaration, matching 'Data':
+	static char const *GLSL;
+
+	struct Data {
+		glm::mat4 OBJECT_TO_CLIP = glm::mat4(1.0f);
+	} data;
+	static_assert(sizeof(Data) == 4*16, "FrameUniforms::Data should match the std140 layout of the Frame block");
+
+	//copy 'data' into the uniform buffer:
+	void upload();
+
+	//point a program's "Frame" block (if active) at Binding; throws if its size doesn't match Data:
+	static void attach(GLuint program, GLProgramReflection const &reflection);
+
+	GLuint buffer = 0;
+};
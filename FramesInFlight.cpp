@@ -0,0 +1,126 @@
+#include "FramesInFlight.hpp"
+
+#include "gl_errors.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+FramesInFlight::FramesInFlight(uint32_t count) {
+	if (count == 0) throw std::runtime_error("FramesInFlight needs at least one frame.");
+	frames.resize(count);
+	for (auto &frame : frames) {
+		glGenBuffers(1, &frame.vertex_buffer);
+		glGenBuffers(1, &frame.readback_buffer);
+	}
+	//start "before" slot 0, so the first begin_frame() lands on it:
+	current_index = count - 1;
+
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+}
+
+FramesInFlight::~FramesInFlight() {
+	for (auto &frame : frames) {
+		if (frame.fence) glDeleteSync(frame.fence);
+		frame.fence = 0;
+		glDeleteBuffers(1, &frame.vertex_buffer);
+		frame.vertex_buffer = 0;
+		glDeleteBuffers(1, &frame.readback_buffer);
+		frame.readback_buffer = 0;
+		if (!frame.queries.empty()) glDeleteQueries(GLsizei(frame.queries.size()), frame.queries.data());
+		frame.queries.clear();
+	}
+}
+
+FramesInFlight::Frame &FramesInFlight::begin_frame() {
+	current_index = (current_index + 1) % uint32_t(frames.size());
+	Frame &frame = frames[current_index];
+
+	//wait for the GPU to finish the last frame that used this slot:
+	if (frame.fence) {
+		auto before = std::chrono::high_resolution_clock::now();
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		while (true) {
+			GLenum result = glClientWaitSync(frame.fence, flags, 1000000000ULL); //1s
+			if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) break;
+			if (result == GL_WAIT_FAILED) throw std::runtime_error("glClientWaitSync failed.");
+			flags = 0; //(only need to flush once)
+		}
+		last_wait = std::chrono::duration< float >(std::chrono::high_resolution_clock::now() - before).count();
+		total_wait += last_wait;
+		glDeleteSync(frame.fence);
+		frame.fence = 0;
+	} else {
+		last_wait = 0.0f;
+	}
+
+	//deliver last use's results:
+	if (frame.on_readback) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, frame.readback_buffer);
+		void const *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame.readback_size.x * frame.readback_size.y * 4, GL_MAP_READ_BIT);
+		if (pixels) {
+			frame.on_readback(frame.readback_size, reinterpret_cast< glm::u8vec4 const * >(pixels));
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		frame.on_readback = nullptr;
+	}
+	for (auto const &fn : on_retire) {
+		fn(frame);
+	}
+	frame.queries_used = 0;
+
+	frame_number += 1;
+	frame.number = frame_number;
+	return frame;
+}
+
+void FramesInFlight::end_frame() {
+	Frame &frame = frames[current_index];
+	frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void FramesInFlight::upload_vertices(void const *data, size_t size) {
+	Frame &frame = frames[current_index];
+	glBindBuffer(GL_ARRAY_BUFFER, frame.vertex_buffer);
+	if (GLsizeiptr(size) > frame.vertex_buffer_capacity) {
+		//grow geometrically so steady-state frames never reallocate:
+		GLsizeiptr capacity = std::max< GLsizeiptr >(frame.vertex_buffer_capacity, 4096);
+		while (capacity < GLsizeiptr(size)) capacity *= 2;
+		glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+		frame.vertex_buffer_capacity = capacity;
+	}
+	if (size == 0) return;
+	//the slot's fence has passed, so there's no need for the driver to synchronize:
+	void *dst = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (dst) {
+		std::memcpy(dst, data, size);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	} else {
+		glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+	}
+}
+
+void FramesInFlight::read_pixels_async(glm::uvec2 const &min, glm::uvec2 const &size, std::function< void(glm::uvec2 const &, glm::u8vec4 const *) > const &callback) {
+	Frame &frame = frames[current_index];
+	GLsizeiptr bytes = GLsizeiptr(size.x) * size.y * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, frame.readback_buffer);
+	if (bytes > frame.readback_buffer_capacity) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+		frame.readback_buffer_capacity = bytes;
+	}
+	glReadPixels(min.x, min.y, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	frame.readback_size = size;
+	frame.on_readback = callback;
+}
+
+GLuint FramesInFlight::next_query() {
+	Frame &frame = frames[current_index];
+	if (frame.queries_used == frame.queries.size()) {
+		frame.queries.emplace_back(0);
+		glGenQueries(1, &frame.queries.back());
+	}
+	return frame.queries[frame.queries_used++];
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/*
+ * FramesInFlight lets the CPU prepare frame N+1 while the GPU is still drawing frame N.
+ *
+ * There are 'count' frame slots, used round-robin. Each slot owns its own transient resources
+ *  (a streaming vertex buffer, a pixel readback buffer, a pool of query objects) and is guarded by a fence:
+ *  - begin_frame() waits -- explicitly, and timed -- until the GPU is done with the slot's previous frame,
+ *    then delivers that frame's readback and query results;
+ *  - end_frame() fences the slot once this frame's commands are submitted.
+ *
+ * Because a slot is never touched while the GPU might still be using it, writes into its buffers can
+ *  skip the driver's implicit synchronization (unsynchronized maps) and results can be read without stalling.
+ */
+
+struct FramesInFlight {
+	FramesInFlight(uint32_t count = 3);
+	~FramesInFlight();
+
+	FramesInFlight(FramesInFlight const &) = delete;
+	FramesInFlight &operator=(FramesInFlight const &) = delete;
+
+	struct Frame {
+		GLsync fence = 0;
+		uint64_t number = 0; //which frame last used this slot
+
+		//streaming vertex data:
+		GLuint vertex_buffer = 0;
+		GLsizeiptr vertex_buffer_capacity = 0;
+
+		//asynchronous glReadPixels target:
+		GLuint readback_buffer = 0;
+		GLsizeiptr readback_buffer_capacity = 0;
+		glm::uvec2 readback_size = glm::uvec2(0);
+		std::function< void(glm::uvec2 const &size, glm::u8vec4 const *pixels) > on_readback;
+
+		//query objects, handed out by next_query() and recycled every time the slot comes around:
+		std::vector< GLuint > queries;
+		uint32_t queries_used = 0;
+	};
+
+	//wait for the next slot to be free; returns it:
+	Frame &begin_frame();
+	//fence the current slot:
+	void end_frame();
+
+	Frame &current() { return frames[current_index]; }
+
+	//copy 'size' bytes into the current slot's vertex buffer (growing it if needed).
+	// the buffer is left bound to GL_ARRAY_BUFFER.
+	void upload_vertices(void const *data, size_t size);
+
+	//read the given rectangle of the current read framebuffer without stalling;
+	// 'callback' is called from a later begin_frame(), once the GPU has finished the copy:
+	void read_pixels_async(glm::uvec2 const &min, glm::uvec2 const &size, std::function< void(glm::uvec2 const &, glm::u8vec4 const *) > const &callback);
+
+	//a query object from the current slot's pool; its result is available (without stalling)
+	// in the on_retire callbacks of the begin_frame() that reuses this slot:
+	GLuint next_query();
+
+	//called from begin_frame() after a slot's fence has passed, before its queries are recycled:
+	std::vector< std::function< void(Frame &) > > on_retire;
+
+	//----- timing -----
+	float last_wait = 0.0f; //seconds spent blocked in the most recent begin_frame()
+	double total_wait = 0.0; //seconds spent blocked in begin_frame(), ever
+	uint64_t frame_number = 0; //frames begun so far
+
+	//----- internals -----
+	std::vector< Frame > frames;
+	uint32_t current_index = 0;
+};
@@ -1,8 +1,11 @@
 #include "GL.hpp"
 
 #include <SDL.h>
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #ifdef _WIN32
 	#define DO(fn) \
@@ -14,6 +17,91 @@
 	#define DO(fn)
 #endif
 
+GLCaps gl_caps;
+
+namespace GLext {
+	 void (APIENTRY *glBufferStorage) (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags) = nullptr;
+	 void (APIENTRY *glGetProgramBinary) (GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary) = nullptr;
+	 void (APIENTRY *glProgramBinary) (GLuint program, GLenum binaryFormat, const void *binary, GLsizei length) = nullptr;
+	 void (APIENTRY *glProgramParameteri) (GLuint program, GLenum pname, GLint value) = nullptr;
+	 void (APIENTRY *glDebugMessageControl) (GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint *ids, GLboolean enabled) = nullptr;
+	 void (APIENTRY *glDebugMessageInsert) (GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar *buf) = nullptr;
+	 void (APIENTRY *glDebugMessageCallback) (GLDEBUGPROC callback, const void *userParam) = nullptr;
+	 GLuint (APIENTRY *glGetDebugMessageLog) (GLuint count, GLsizei bufSize, GLenum *sources, GLenum *types, GLuint *ids, GLenum *severities, GLsizei *lengths, GLchar *messageLog) = nullptr;
+	 void (APIENTRY *glPushDebugGroup) (GLenum source, GLuint id, GLsizei length, const GLchar *message) = nullptr;
+	 void (APIENTRY *glPopDebugGroup) (void) = nullptr;
+	 void (APIENTRY *glObjectLabel) (GLenum identifier, GLuint name, GLsizei length, const GLchar *label) = nullptr;
+	 void (APIENTRY *glGetObjectLabel) (GLenum identifier, GLuint name, GLsizei bufSize, GLsizei *length, GLchar *label) = nullptr;
+	 void (APIENTRY *glObjectPtrLabel) (const void *ptr, GLsizei length, const GLchar *label) = nullptr;
+	 void (APIENTRY *glGetObjectPtrLabel) (const void *ptr, GLsizei bufSize, GLsizei *length, GLchar *label) = nullptr;
+	 void (APIENTRY *glMultiDrawArraysIndirect) (GLenum mode, const void *indirect, GLsizei drawcount, GLsizei stride) = nullptr;
+	 void (APIENTRY *glMultiDrawElementsIndirect) (GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride) = nullptr;
+	 void (APIENTRY *glMaxShaderCompilerThreadsKHR) (GLuint count) = nullptr;
+}
+
+static bool has_extension(std::vector< std::string > const &extensions, char const *name) {
+	return std::find(extensions.begin(), extensions.end(), name) != extensions.end();
+}
+
+static void init_GL_caps() {
+	glGetIntegerv(GL_MAJOR_VERSION, &gl_caps.major);
+	glGetIntegerv(GL_MINOR_VERSION, &gl_caps.minor);
+	auto version_at_least = [](GLint major, GLint minor) {
+		return gl_caps.major > major || (gl_caps.major == major && gl_caps.minor >= minor);
+	};
+
+	std::vector< std::string > extensions;
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i) {
+		GLubyte const *name = glGetStringi(GL_EXTENSIONS, GLuint(i));
+		if (name) extensions.emplace_back(reinterpret_cast< char const * >(name));
+	}
+
+	#define EXT(fn) \
+		GLext::fn = (decltype(GLext::fn))SDL_GL_GetProcAddress(#fn); \
+		if (!GLext::fn) ok = false;
+
+	if (version_at_least(4, 4) || has_extension(extensions, "GL_ARB_buffer_storage")) {
+		bool ok = true;
+		EXT(glBufferStorage)
+		gl_caps.ARB_buffer_storage = ok;
+	}
+	if (version_at_least(4, 1) || has_extension(extensions, "GL_ARB_get_program_binary")) {
+		bool ok = true;
+		EXT(glGetProgramBinary)
+		EXT(glProgramBinary)
+		EXT(glProgramParameteri)
+		gl_caps.ARB_get_program_binary = ok;
+	}
+	if (version_at_least(4, 3) || has_extension(extensions, "GL_KHR_debug")) {
+		bool ok = true;
+		EXT(glDebugMessageControl)
+		EXT(glDebugMessageInsert)
+		EXT(glDebugMessageCallback)
+		EXT(glGetDebugMessageLog)
+		EXT(glPushDebugGroup)
+		EXT(glPopDebugGroup)
+		EXT(glObjectLabel)
+		EXT(glGetObjectLabel)
+		EXT(glObjectPtrLabel)
+		EXT(glGetObjectPtrLabel)
+		gl_caps.KHR_debug = ok;
+	}
+	if (version_at_least(4, 3) || has_extension(extensions, "GL_ARB_multi_draw_indirect")) {
+		bool ok = true;
+		EXT(glMultiDrawArraysIndirect)
+		EXT(glMultiDrawElementsIndirect)
+		gl_caps.ARB_multi_draw_indirect = ok;
+	}
+	if (has_extension(extensions, "GL_KHR_parallel_shader_compile")) {
+		bool ok = true;
+		EXT(glMaxShaderCompilerThreadsKHR)
+		gl_caps.KHR_parallel_shader_compile = ok;
+	}
+	#undef EXT
+}
+
 void init_GL() {
 	DO(glDrawRangeElements)
 	DO(glTexImage3D)
@@ -298,6 +386,8 @@ void init_GL() {
 	DO(glVertexAttribP3uiv)
 	DO(glVertexAttribP4ui)
 	DO(glVertexAttribP4uiv)
+
+	init_GL_caps();
 }
 #ifdef _WIN32
 	 void (APIENTRYFP glDrawRangeElements) (GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void *indices);
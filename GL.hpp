@@ -13,6 +13,9 @@
  *
  * On MacOS, all are prototypes.
  *
+ * A few optional extensions (see the end of this file) are function pointers
+ *  on every platform; check gl_caps before calling them.
+ *
  * This file has been automatically generated from glcorearb.h by make-GL.py
  *
  */
@@ -1277,3 +1280,124 @@ GLAPI void (APIENTRYFP glVertexAttribP4ui) (GLuint index, GLenum type, GLboolean
 GLAPI void (APIENTRYFP glVertexAttribP4uiv) (GLuint index, GLenum type, GLboolean normalized, const GLuint *value);
 
 }
+
+//------------ optional extensions ------------
+//init_GL() fills in gl_caps with the context version and which of these extensions are usable.
+// entry points of unavailable extensions are left null, so always check the flag first
+// and keep a fallback path that uses only 3.3 core.
+
+struct GLCaps {
+	GLint major = 0, minor = 0; //context version
+	bool ARB_buffer_storage = false; //core in 4.4
+	bool ARB_get_program_binary = false; //core in 4.1
+	bool KHR_debug = false; //core in 4.3
+	bool ARB_multi_draw_indirect = false; //core in 4.3
+	bool KHR_parallel_shader_compile = false;
+};
+extern GLCaps gl_caps;
+
+// from GL_ARB_buffer_storage:
+#define GL_MAP_PERSISTENT_BIT             0x0040
+#define GL_MAP_COHERENT_BIT               0x0080
+#define GL_DYNAMIC_STORAGE_BIT            0x0100
+#define GL_CLIENT_STORAGE_BIT             0x0200
+#define GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT 0x00004000
+#define GL_BUFFER_IMMUTABLE_STORAGE       0x821F
+#define GL_BUFFER_STORAGE_FLAGS           0x8220
+
+// from GL_ARB_get_program_binary:
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH          0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS     0x87FE
+#define GL_PROGRAM_BINARY_FORMATS         0x87FF
+
+// from GL_KHR_debug:
+typedef void (APIENTRY  *GLDEBUGPROC)(GLenum source,GLenum type,GLuint id,GLenum severity,GLsizei length,const GLchar *message,const void *userParam);
+#define GL_DEBUG_OUTPUT_SYNCHRONOUS       0x8242
+#define GL_DEBUG_NEXT_LOGGED_MESSAGE_LENGTH 0x8243
+#define GL_DEBUG_CALLBACK_FUNCTION        0x8244
+#define GL_DEBUG_CALLBACK_USER_PARAM      0x8245
+#define GL_DEBUG_SOURCE_API               0x8246
+#define GL_DEBUG_SOURCE_WINDOW_SYSTEM     0x8247
+#define GL_DEBUG_SOURCE_SHADER_COMPILER   0x8248
+#define GL_DEBUG_SOURCE_THIRD_PARTY       0x8249
+#define GL_DEBUG_SOURCE_APPLICATION       0x824A
+#define GL_DEBUG_SOURCE_OTHER             0x824B
+#define GL_DEBUG_TYPE_ERROR               0x824C
+#define GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR 0x824D
+#define GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR  0x824E
+#define GL_DEBUG_TYPE_PORTABILITY         0x824F
+#define GL_DEBUG_TYPE_PERFORMANCE         0x8250
+#define GL_DEBUG_TYPE_OTHER               0x8251
+#define GL_DEBUG_LOGGED_MESSAGES          0x9145
+#define GL_DEBUG_SEVERITY_HIGH            0x9146
+#define GL_DEBUG_SEVERITY_MEDIUM          0x9147
+#define GL_DEBUG_SEVERITY_LOW             0x9148
+#define GL_DEBUG_TYPE_MARKER              0x8268
+#define GL_DEBUG_TYPE_PUSH_GROUP          0x8269
+#define GL_DEBUG_TYPE_POP_GROUP           0x826A
+#define GL_DEBUG_SEVERITY_NOTIFICATION    0x826B
+#define GL_DEBUG_GROUP_STACK_DEPTH        0x826D
+#define GL_DEBUG_OUTPUT                   0x92E0
+#define GL_MAX_DEBUG_MESSAGE_LENGTH       0x9143
+#define GL_MAX_DEBUG_LOGGED_MESSAGES      0x9144
+#define GL_MAX_DEBUG_GROUP_STACK_DEPTH    0x826C
+#define GL_MAX_LABEL_LENGTH               0x82E8
+#define GL_CONTEXT_FLAG_DEBUG_BIT         0x00000002
+#define GL_BUFFER                         0x82E0
+#define GL_SHADER                         0x82E1
+#define GL_PROGRAM                        0x82E2
+#define GL_QUERY                          0x82E3
+#define GL_PROGRAM_PIPELINE               0x82E4
+#define GL_SAMPLER                        0x82E6
+
+// from GL_ARB_multi_draw_indirect:
+#define GL_DRAW_INDIRECT_BUFFER           0x8F3F
+#define GL_DRAW_INDIRECT_BUFFER_BINDING   0x8F43
+
+// from GL_KHR_parallel_shader_compile:
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR          0x91B1
+
+//(in a namespace so they don't collide with symbols exported by the system GL library)
+namespace GLext {
+	//ARB_buffer_storage:
+	extern void (APIENTRY *glBufferStorage) (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+	//ARB_get_program_binary:
+	extern void (APIENTRY *glGetProgramBinary) (GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+	extern void (APIENTRY *glProgramBinary) (GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+	extern void (APIENTRY *glProgramParameteri) (GLuint program, GLenum pname, GLint value);
+	//KHR_debug:
+	extern void (APIENTRY *glDebugMessageControl) (GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint *ids, GLboolean enabled);
+	extern void (APIENTRY *glDebugMessageInsert) (GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar *buf);
+	extern void (APIENTRY *glDebugMessageCallback) (GLDEBUGPROC callback, const void *userParam);
+	extern GLuint (APIENTRY *glGetDebugMessageLog) (GLuint count, GLsizei bufSize, GLenum *sources, GLenum *types, GLuint *ids, GLenum *severities, GLsizei *lengths, GLchar *messageLog);
+	extern void (APIENTRY *glPushDebugGroup) (GLenum source, GLuint id, GLsizei length, const GLchar *message);
+	extern void (APIENTRY *glPopDebugGroup) (void);
+	extern void (APIENTRY *glObjectLabel) (GLenum identifier, GLuint name, GLsizei length, const GLchar *label);
+	extern void (APIENTRY *glGetObjectLabel) (GLenum identifier, GLuint name, GLsizei bufSize, GLsizei *length, GLchar *label);
+	extern void (APIENTRY *glObjectPtrLabel) (const void *ptr, GLsizei length, const GLchar *label);
+	extern void (APIENTRY *glGetObjectPtrLabel) (const void *ptr, GLsizei bufSize, GLsizei *length, GLchar *label);
+	//ARB_multi_draw_indirect:
+	extern void (APIENTRY *glMultiDrawArraysIndirect) (GLenum mode, const void *indirect, GLsizei drawcount, GLsizei stride);
+	extern void (APIENTRY *glMultiDrawElementsIndirect) (GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+	//KHR_parallel_shader_compile:
+	extern void (APIENTRY *glMaxShaderCompilerThreadsKHR) (GLuint count);
+}
+using GLext::glBufferStorage;
+using GLext::glGetProgramBinary;
+using GLext::glProgramBinary;
+using GLext::glProgramParameteri;
+using GLext::glDebugMessageControl;
+using GLext::glDebugMessageInsert;
+using GLext::glDebugMessageCallback;
+using GLext::glGetDebugMessageLog;
+using GLext::glPushDebugGroup;
+using GLext::glPopDebugGroup;
+using GLext::glObjectLabel;
+using GLext::glGetObjectLabel;
+using GLext::glObjectPtrLabel;
+using GLext::glGetObjectPtrLabel;
+using GLext::glMultiDrawArraysIndirect;
+using GLext::glMultiDrawElementsIndirect;
+using GLext::glMaxShaderCompilerThreadsKHR;
@@ -0,0 +1,158 @@
+#include "GPUProfiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+GPUProfiler::GPUProfiler(FramesInFlight &frames_, uint32_t window_) : frames(frames_), window(window_) {
+	if (window == 0) throw std::runtime_error("GPUProfiler window must be at least one sample.");
+	marks.resize(frames.frames.size());
+	retire_index = frames.on_retire.size();
+	frames.on_retire.emplace_back([this](FramesInFlight::Frame &frame){
+		retire(frame);
+	});
+}
+
+GPUProfiler::~GPUProfiler() {
+	//leave a no-op in our slot so other callbacks keep their positions:
+	frames.on_retire[retire_index] = [](FramesInFlight::Frame &){};
+}
+
+void GPUProfiler::push(std::string const &name) {
+	std::string path = (open_paths.empty() ? name : open_paths.back() + "/" + name);
+
+	auto f = series_by_path.find(path);
+	if (f == series_by_path.end()) {
+		f = series_by_path.emplace(path, uint32_t(series.size())).first;
+		series.emplace_back();
+		series.back().path = path;
+		series.back().depth = uint32_t(open_paths.size());
+		series.back().samples.reserve(window);
+	}
+
+	Mark mark;
+	mark.series = f->second;
+	mark.begin_query = 0;
+	mark.end_query = 0;
+	if (enabled) {
+		mark.begin_query = frames.next_query();
+		glQueryCounter(mark.begin_query, GL_TIMESTAMP);
+	}
+	open.emplace_back(mark);
+	open_paths.emplace_back(path);
+}
+
+void GPUProfiler::pop() {
+	if (open.empty()) throw std::runtime_error("GPUProfiler::pop() without a matching push().");
+
+	Mark mark = open.back();
+	open.pop_back();
+	open_paths.pop_back();
+
+	if (mark.begin_query == 0) return; //pushed while disabled
+
+	mark.end_query = frames.next_query();
+	glQueryCounter(mark.end_query, GL_TIMESTAMP);
+	marks[frames.current_index].emplace_back(mark);
+}
+
+void GPUProfiler::retire(FramesInFlight::Frame &frame) {
+	std::vector< Mark > &slot = marks[&frame - frames.frames.data()];
+	for (Mark const &mark : slot) {
+		//the slot's fence has passed, so results should be ready; never block if a driver disagrees:
+		GLuint available = GL_FALSE;
+		glGetQueryObjectuiv(mark.end_query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) continue;
+
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(mark.begin_query, GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(mark.end_query, GL_QUERY_RESULT, &end);
+		float ms = float(double(end - begin) * 1.0e-6); //timestamps are in nanoseconds
+
+		Series &s = series[mark.series];
+		if (s.samples.size() < window) {
+			s.samples.emplace_back(ms);
+		} else {
+			s.samples[s.next] = ms;
+		}
+		s.next = (s.next + 1) % window;
+	}
+	slot.clear();
+}
+
+GPUProfiler::Stats GPUProfiler::compute(Series const &s) const {
+	Stats stats;
+	stats.path = s.path;
+	stats.depth = s.depth;
+	stats.count = uint32_t(s.samples.size());
+	if (s.samples.empty()) return stats;
+
+	std::vector< float > sorted = s.samples;
+	std::sort(sorted.begin(), sorted.end());
+
+	double sum = 0.0;
+	for (float ms : sorted) sum += ms;
+
+	stats.min = sorted.front();
+	stats.avg = sum / sorted.size();
+	//nearest-rank 99th percentile:
+	size_t rank = size_t(std::ceil(0.99 * sorted.size()));
+	stats.p99 = sorted[std::max< size_t >(rank, 1) - 1];
+	return stats;
+}
+
+GPUProfiler::Stats GPUProfiler::stats(std::string const &path) const {
+	auto f = series_by_path.find(path);
+	if (f == series_by_path.end()) throw std::runtime_error("GPUProfiler has no scope named '" + path + "'.");
+	return compute(series[f->second]);
+}
+
+float GPUProfiler::latest(std::string const &path) const {
+	auto f = series_by_path.find(path);
+	if (f == series_by_path.end()) return 0.0f;
+	Series const &s = series[f->second];
+	if (s.samples.empty()) return 0.0f;
+	return s.samples[(s.next + s.samples.size() - 1) % s.samples.size()];
+}
+
+std::vector< GPUProfiler::Stats > GPUProfiler::all_stats() const {
+	std::vector< Stats > ret;
+	ret.reserve(series.size());
+	for (auto const &s : series) {
+		ret.emplace_back(compute(s));
+	}
+	return ret;
+}
+
+void GPUProfiler::report(std::ostream &out) const {
+	out << "GPU scopes (ms over last " << window << " frames):\n";
+	out << "  " << std::left << std::setw(28) << "scope" << std::right
+	    << std::setw(10) << "min" << std::setw(10) << "avg" << std::setw(10) << "p99" << std::setw(8) << "n" << "\n";
+	for (auto const &stats : all_stats()) {
+		std::string name = std::string(2 * stats.depth, ' ') + stats.path.substr(stats.path.rfind('/') + 1);
+		out << "  " << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(3)
+		    << std::setw(10) << stats.min << std::setw(10) << stats.avg << std::setw(10) << stats.p99
+		    << std::setw(8) << stats.count << "\n";
+	}
+	out.unsetf(std::ios::floatfield);
+}
+
+void GPUProfiler::dump(std::string const &filename) const {
+	std::ofstream out(filename, std::ios::binary);
+	if (!out) throw std::runtime_error("Failed to open '" + filename + "' for writing GPU profile.");
+	out << "scope\tmin_ms\tavg_ms\tp99_ms\tsamples\n";
+	for (auto const &stats : all_stats()) {
+		out << stats.path << '\t' << stats.min << '\t' << stats.avg << '\t' << stats.p99 << '\t' << stats.count << '\n';
+	}
+	if (!out) throw std::runtime_error("Failed to write GPU profile to '" + filename + "'.");
+}
+
+void GPUProfiler::reset() {
+	for (auto &s : series) {
+		s.samples.clear();
+		s.next = 0;
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "FramesInFlight.hpp"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * GPUProfiler measures how long the GPU spends on named, nestable scopes of draw commands.
+ *
+ * Each scope brackets its commands with a pair of GL_TIMESTAMP queries (glQueryCounter); unlike
+ *  GL_TIME_ELAPSED, timestamps may overlap, so scopes can nest. Queries come from the current
+ *  FramesInFlight slot and are read when that slot is retired -- i.e., frames later, once its fence
+ *  has passed -- so reading results never stalls the pipeline.
+ *
+ * Usage:
+ *   { GPUProfiler::Scope scope(profiler, "trails"); glDrawArrays(...); }
+ *
+ * Every scope keeps a rolling window of recent durations for min / avg / p99 statistics.
+ */
+
+struct GPUProfiler {
+	//hooks itself into frames.on_retire; 'frames' must outlive the profiler:
+	GPUProfiler(FramesInFlight &frames, uint32_t window = 240);
+	~GPUProfiler();
+
+	GPUProfiler(GPUProfiler const &) = delete;
+	GPUProfiler &operator=(GPUProfiler const &) = delete;
+
+	//open / close a scope in the current frame (must be between frames.begin_frame() and frames.end_frame()):
+	void push(std::string const &name);
+	void pop();
+
+	struct Scope {
+		Scope(GPUProfiler &profiler_, std::string const &name) : profiler(profiler_) { profiler.push(name); }
+		~Scope() { profiler.pop(); }
+		GPUProfiler &profiler;
+	};
+
+	struct Stats {
+		std::string path; //"parent/child" name of the scope
+		uint32_t depth = 0; //nesting depth (0 for outermost scopes)
+		uint32_t count = 0; //samples in the window
+		double min = 0.0, avg = 0.0, p99 = 0.0; //milliseconds
+	};
+
+	//statistics for the scope with the given path; throws if the scope was never measured:
+	Stats stats(std::string const &path) const;
+	//most recent duration (milliseconds) of the scope with the given path, or zero if none yet:
+	float latest(std::string const &path) const;
+	//statistics for every scope, in first-seen order:
+	std::vector< Stats > all_stats() const;
+
+	//human-readable table of all_stats():
+	void report(std::ostream &out) const;
+	//write all_stats() as tab-separated values; throws on failure:
+	void dump(std::string const &filename) const;
+
+	//drop all collected samples:
+	void reset();
+
+	bool enabled = true; //when false, push()/pop() issue no queries
+
+	//----- internals -----
+	struct Series {
+		std::string path;
+		uint32_t depth = 0;
+		std::vector< float > samples; //ring buffer of durations (milliseconds)
+		uint32_t next = 0; //ring buffer write position
+	};
+	Stats compute(Series const &series) const;
+
+	struct Mark {
+		uint32_t series;
+		GLuint begin_query, end_query;
+	};
+	void retire(FramesInFlight::Frame &frame);
+
+	FramesInFlight &frames;
+	uint32_t window;
+	size_t retire_index; //position of our callback in frames.on_retire
+
+	std::vector< Series > series;
+	std::unordered_map< std::string, uint32_t > series_by_path;
+
+	std::vector< std::vector< Mark > > marks; //per frame slot, scopes closed in that slot's current frame
+	std::vector< Mark > open; //scopes pushed but not yet popped (series filled in; end_query unused)
+	std::vector< std::string > open_paths;
+};
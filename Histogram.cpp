@@ -0,0 +1,97 @@
+#include "Histogram.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+	//index of the highest set bit (value must be nonzero):
+	uint32_t highest_bit(uint64_t value) {
+	#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return uint32_t(index);
+	#else
+		return 63 - uint32_t(__builtin_clzll(value));
+	#endif
+	}
+}
+
+Histogram::Histogram(uint32_t bits_) : bits(bits_) {
+	if (bits < 1 || bits > 16) throw std::runtime_error("Histogram precision must be between 1 and 16 bits.");
+	//the largest value, 2^64-1, lands in the last bucket:
+	counts.assign((uint64_t(1) << bits) * (65 - bits), 0);
+}
+
+uint32_t Histogram::index(uint64_t value) const {
+	uint64_t sub = uint64_t(1) << bits;
+	if (value < 2 * sub) return uint32_t(value);
+	//keep the top (bits+1) bits of the value; the shift says which power-of-two range it is in:
+	uint32_t shift = highest_bit(value) - bits;
+	uint64_t top = value >> shift; //in [sub, 2*sub)
+	return uint32_t(sub * (shift + 1) + (top - sub));
+}
+
+uint64_t Histogram::highest_in_bucket(uint32_t idx) const {
+	uint64_t sub = uint64_t(1) << bits;
+	if (idx < 2 * sub) return idx;
+	uint32_t shift = uint32_t(idx / sub) - 1;
+	uint64_t top = idx % sub + sub;
+	return ((top + 1) << shift) - 1; //(wraps to 2^64-1 for the very last bucket, which is what we want)
+}
+
+void Histogram::record(uint64_t value, uint64_t count) {
+	if (count == 0) return;
+	counts[index(value)] += count;
+	if (total == 0) {
+		min_value = max_value = value;
+	} else {
+		min_value = std::min(min_value, value);
+		max_value = std::max(max_value, value);
+	}
+	total += count;
+	sum += value * count;
+}
+
+void Histogram::merge(Histogram const &other) {
+	if (other.bits != bits) throw std::runtime_error("Can't merge histograms of different precision.");
+	if (other.total == 0) return;
+	for (size_t i = 0; i < counts.size(); ++i) {
+		counts[i] += other.counts[i];
+	}
+	if (total == 0) {
+		min_value = other.min_value;
+		max_value = other.max_value;
+	} else {
+		min_value = std::min(min_value, other.min_value);
+		max_value = std::max(max_value, other.max_value);
+	}
+	total += other.total;
+	sum += other.sum;
+}
+
+void Histogram::clear() {
+	if (total == 0) return;
+	std::fill(counts.begin(), counts.end(), 0);
+	total = 0;
+	sum = 0;
+	min_value = max_value = 0;
+}
+
+uint64_t Histogram::percentile(double percentile) const {
+	if (total == 0) return 0;
+	percentile = std::min(100.0, std::max(0.0, percentile));
+	//rank of the sample we want (1-based, at least 1):
+	uint64_t rank = std::max< uint64_t >(1, uint64_t(percentile / 100.0 * double(total) + 0.5));
+	uint64_t seen = 0;
+	for (uint32_t i = index(min_value); i < counts.size(); ++i) {
+		seen += counts[i];
+		if (seen >= rank) {
+			return std::max(min_value, std::min(max_value, highest_in_bucket(i)));
+		}
+	}
+	return max_value;
+}
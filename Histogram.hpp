@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Histogram counts non-negative integer samples in log-linear buckets (in the style of HdrHistogram):
+ *  values below 2^(bits+1) are counted exactly; larger values land in buckets whose width
+ *  is at most 1/2^bits of their value. So percentiles are accurate to within that relative error
+ *  (under 1% with the default bits = 7) over the whole 64-bit range, in a fixed amount of memory,
+ *  and recording is a couple of shifts and an increment.
+ */
+
+struct Histogram {
+	Histogram(uint32_t bits = 7);
+
+	void record(uint64_t value, uint64_t count = 1);
+	//add all of another histogram's samples (must have the same 'bits'):
+	void merge(Histogram const &other);
+	void clear();
+
+	uint64_t count() const { return total; }
+	uint64_t min() const { return total ? min_value : 0; }
+	uint64_t max() const { return total ? max_value : 0; }
+	double mean() const { return total ? double(sum) / double(total) : 0.0; }
+
+	//smallest value v such that at least 'percentile'% of samples are <= v (up to bucket precision);
+	// percentile in [0,100]; returns 0 for an empty histogram:
+	uint64_t percentile(double percentile) const;
+
+	//----- internals -----
+	uint32_t bits;
+	std::vector< uint64_t > counts;
+	uint64_t total = 0;
+	uint64_t sum = 0;
+	uint64_t min_value = 0;
+	uint64_t max_value = 0;
+
+	uint32_t index(uint64_t value) const;
+	uint64_t highest_in_bucket(uint32_t index) const;
+};
@@ -0,0 +1,85 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::string const &filename_) : filename(filename_) {
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		throw std::runtime_error("Failed to open '" + filename + "'.");
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		unmap();
+		throw std::runtime_error("Failed to get size of '" + filename + "'.");
+	}
+	size = size_t(file_size.QuadPart);
+	if (size == 0) return; //can't map empty files; leave data == nullptr
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping) {
+		data = reinterpret_cast< uint8_t const * >(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (!data) {
+		unmap();
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+}
+
+void MappedFile::unmap() {
+	if (data) UnmapViewOfFile(data);
+	data = nullptr;
+	if (mapping) CloseHandle(mapping);
+	mapping = nullptr;
+	if (file) CloseHandle(file);
+	file = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile(std::string const &filename_) : filename(filename_) {
+	fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		throw std::runtime_error("Failed to open '" + filename + "'.");
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		unmap();
+		throw std::runtime_error("Failed to stat '" + filename + "'.");
+	}
+	size = size_t(st.st_size);
+	if (size == 0) return; //can't map empty files; leave data == nullptr
+
+	void *ptr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED) {
+		unmap();
+		throw std::runtime_error("Failed to map '" + filename + "'.");
+	}
+	data = reinterpret_cast< uint8_t const * >(ptr);
+}
+
+void MappedFile::unmap() {
+	if (data) munmap(const_cast< uint8_t * >(data), size);
+	data = nullptr;
+	if (fd >= 0) close(fd);
+	fd = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+	unmap();
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * MappedFile maps a whole file read-only into memory.
+ * (mmap on Linux/MacOS, MapViewOfFile on Windows)
+ */
+
+struct MappedFile {
+	//throws on failure to open/map:
+	MappedFile(std::string const &filename);
+	~MappedFile();
+
+	MappedFile(MappedFile const &) = delete;
+	MappedFile &operator=(MappedFile const &) = delete;
+
+	uint8_t const *data = nullptr;
+	size_t size = 0;
+
+	std::string filename;
+
+	//----- internals -----
+	void unmap();
+#ifdef _WIN32
+	void *file = nullptr;
+	void *mapping = nullptr;
+#else
+	int fd = -1;
+#endif
+};
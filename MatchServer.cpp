@@ -0,0 +1,368 @@
+#include "MatchServer.hpp"
+
+#include "AllocTracker.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+constexpr uint32_t MatchServer::Outbox::Capacity;
+
+namespace {
+	//most balls a game of 'scenario' can ever have (so buffers can be sized once):
+	size_t most_balls(Scenario const &scenario, PongSim const &sim) {
+		size_t most = std::max< size_t >(sim.balls.size(), scenario.max_balls);
+		for (Scenario::Burst const &burst : scenario.bursts) {
+			most += burst.count;
+		}
+		return most;
+	}
+
+	//run the calling thread on just 'core' (best effort):
+	void pin_to_core(uint32_t core) {
+#ifdef __linux__
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(core, &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+	}
+}
+
+//----- Match -----
+
+MatchServer::Match::Match(Scenario const &scenario) : sim(scenario) {
+	//paddles the scenario gives to a player are played by the ai until someone joins:
+	free_script[0] = (scenario.left.kind == PaddleScript::Player ? PaddleScript(PaddleScript::AI) : scenario.left);
+	free_script[1] = (scenario.right.kind == PaddleScript::Player ? PaddleScript(PaddleScript::AI) : scenario.right);
+	sim.left_script = free_script[0];
+	sim.right_script = free_script[1];
+
+	size_t most = most_balls(scenario, sim);
+	sim.balls.reserve(most);
+	current.balls.reserve(most);
+	for (NetServer::Client &client : clients) {
+		for (NetView &view : client.sent) {
+			view.balls.reserve(most);
+		}
+	}
+}
+
+//----- Outbox -----
+
+MatchServer::Outbox::Outbox() : buffers(Capacity * NetPacket::MaxSize), datagrams(Capacity) {
+}
+
+uint8_t *MatchServer::Outbox::next() {
+	return buffers.data() + count * NetPacket::MaxSize;
+}
+
+void MatchServer::Outbox::add(NetAddress const &to, size_t size) {
+	UDPDatagram &datagram = datagrams[count];
+	datagram.address = to;
+	datagram.data = next();
+	datagram.size = size;
+	count += 1;
+}
+
+void MatchServer::Outbox::flush(UDPSocket &socket, MatchServer &server) {
+	if (count == 0) return;
+	size_t sent = socket.send_batch(datagrams.data(), count);
+	uint64_t bytes = 0;
+	for (size_t i = 0; i < sent; ++i) {
+		bytes += datagrams[i].size + NetPacket::Overhead;
+	}
+	server.packets_out.fetch_add(sent, std::memory_order_relaxed);
+	server.bytes_out.fetch_add(bytes, std::memory_order_relaxed);
+	count = 0;
+}
+
+//----- MatchServer -----
+
+MatchServer::MatchServer(Config const &config_) : config(config_) {
+#ifndef __linux__
+	throw std::runtime_error("MatchServer needs epoll, so it only runs on Linux for now.");
+#endif
+	if (config.matches == 0) throw std::runtime_error("MatchServer needs at least one match.");
+	if (config.workers == 0) config.workers = std::max(1U, std::thread::hardware_concurrency());
+	config.io_threads = std::max(1U, config.io_threads);
+
+	//all sockets share one port (if the port was 0, the first picks it):
+	NetAddress bind_to = config.bind_to;
+	for (uint32_t i = 0; i < config.io_threads; ++i) {
+		sockets.emplace_back(new UDPSocket(bind_to, true));
+		sockets.back()->set_buffer_sizes(4 << 20);
+		if (i == 0) bind_to.port = sockets[0]->local_address().port;
+	}
+	config.bind_to.port = bind_to.port;
+
+	//workers create their own matches (so each match's memory is first touched by the core that runs it):
+	matches.resize(config.matches);
+	for (uint32_t w = 0; w < config.workers; ++w) {
+		workers.emplace_back(&MatchServer::worker, this, w, config.workers);
+	}
+	while (workers_ready.load() < config.workers) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	last_report = std::chrono::steady_clock::now();
+#ifdef ENABLE_ALLOC_TRACKING
+	for (AllocTracker::Stats const &stats : AllocTracker::by_tag()) {
+		if (std::string(stats.tag) == "match tick") tick_allocations_before = stats.allocations;
+	}
+#endif
+
+	for (uint32_t i = 0; i < config.io_threads; ++i) {
+		io_threads.emplace_back(&MatchServer::io_thread, this, i);
+	}
+}
+
+MatchServer::~MatchServer() {
+	quit = true;
+	for (std::thread &thread : io_threads) thread.join();
+	for (std::thread &thread : workers) thread.join();
+}
+
+bool MatchServer::post(NetAddress const &from, uint8_t const *data, size_t size) {
+	uint8_t type = NetPacket::type(data, size);
+	NetInput input;
+	if (type == NetPacket::Input) {
+		if (!input.read(data, size)) return false;
+	} else if (type == NetPacket::Bye) {
+		uint32_t index = 0;
+		if (!read_bye(data, size, &index) || index >= matches.size()) return false;
+		Match &match = *matches[index];
+		std::lock_guard< std::mutex > lock(match.mutex);
+		for (Match::Inbox &inbox : match.inbox) {
+			if (inbox.taken && inbox.address == from) {
+				inbox.bye = true;
+				return true;
+			}
+		}
+		return false;
+	} else {
+		return false;
+	}
+	if (input.match >= matches.size()) return false;
+
+	Match &match = *matches[input.match];
+	std::lock_guard< std::mutex > lock(match.mutex);
+	Match::Inbox *slot = nullptr;
+	for (Match::Inbox &inbox : match.inbox) {
+		if (inbox.taken && inbox.address == from) slot = &inbox;
+	}
+	if (!slot) {
+		//join, taking the first free paddle (if any):
+		for (Match::Inbox &inbox : match.inbox) {
+			if (!inbox.taken) {
+				slot = &inbox;
+				break;
+			}
+		}
+		if (!slot) return false;
+		*slot = Match::Inbox();
+		slot->taken = true;
+		slot->address = from;
+	}
+	slot->heard = true;
+	slot->paddle_y = input.paddle_y;
+	//(the newest ack wins, even if inputs arrive out of order)
+	if (input.ack != NetPacket::NoSeq && (slot->ack == NetPacket::NoSeq || input.ack > slot->ack)) {
+		slot->ack = input.ack;
+	}
+	return true;
+}
+
+void MatchServer::io_thread(uint32_t index) {
+#ifdef __linux__
+	UDPSocket &socket = *sockets[index];
+	int epoll = epoll_create1(0);
+	if (epoll < 0) {
+		std::cerr << "MatchServer: failed to create epoll instance; I/O thread " << index << " is not running." << std::endl;
+		return;
+	}
+	epoll_event event;
+	event.events = EPOLLIN;
+	event.data.u32 = index;
+	epoll_ctl(epoll, EPOLL_CTL_ADD, socket.fd, &event);
+
+	//packets are read in batches into buffers this thread owns:
+	constexpr uint32_t Batch = 64;
+	std::vector< uint8_t > buffers(Batch * NetPacket::MaxSize);
+	std::vector< UDPDatagram > datagrams(Batch);
+	for (uint32_t i = 0; i < Batch; ++i) {
+		datagrams[i].data = buffers.data() + i * NetPacket::MaxSize;
+		datagrams[i].capacity = NetPacket::MaxSize;
+	}
+
+	while (!quit.load(std::memory_order_relaxed)) {
+		epoll_event ready;
+		//(the timeout is only so 'quit' gets noticed)
+		if (epoll_wait(epoll, &ready, 1, 100) <= 0) continue;
+		while (size_t count = socket.receive_batch(datagrams.data(), Batch)) {
+			uint64_t bytes = 0;
+			for (size_t i = 0; i < count; ++i) {
+				post(datagrams[i].address, datagrams[i].data, datagrams[i].size);
+				bytes += datagrams[i].size + NetPacket::Overhead;
+			}
+			packets_in.fetch_add(count, std::memory_order_relaxed);
+			bytes_in.fetch_add(bytes, std::memory_order_relaxed);
+			if (count < Batch) break;
+		}
+	}
+	close(epoll);
+#endif
+}
+
+void MatchServer::worker(uint32_t index, uint32_t count) {
+	pin_to_core(index % std::max(1U, std::thread::hardware_concurrency()));
+	for (uint32_t m = index; m < matches.size(); m += count) {
+		//(each match is its own game: same setup, different random numbers)
+		Scenario scenario = config.scenario;
+		scenario.seed += m;
+		matches[m].reset(new Match(scenario));
+	}
+	Outbox outbox;
+	UDPSocket &socket = *sockets[index % sockets.size()];
+	workers_ready.fetch_add(1);
+
+	auto const tick_length = std::chrono::duration_cast< std::chrono::steady_clock::duration >(std::chrono::duration< double >(1.0 / config.tick_rate));
+	auto next_tick = std::chrono::steady_clock::now();
+	while (!quit.load(std::memory_order_relaxed)) {
+		std::this_thread::sleep_until(next_tick);
+		auto start = std::chrono::steady_clock::now();
+		{
+			ALLOC_SCOPE("match tick");
+			for (uint32_t m = index; m < matches.size(); m += count) {
+				tick(*matches[m], outbox, socket);
+			}
+			outbox.flush(socket, *this);
+		}
+		auto end = std::chrono::steady_clock::now();
+		busy_ns.fetch_add(uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(end - start).count()), std::memory_order_relaxed);
+
+		next_tick += tick_length;
+		if (end > next_tick) {
+			//overran the tick; start the next right away, but don't try to make up more than one:
+			late.fetch_add(1, std::memory_order_relaxed);
+			next_tick = std::max(next_tick, end - tick_length);
+		}
+	}
+}
+
+void MatchServer::tick(Match &match, Outbox &outbox, UDPSocket &socket) {
+	auto start = std::chrono::steady_clock::now();
+	float const elapsed = 1.0f / config.tick_rate;
+
+	//take the inbox's news:
+	{
+		std::lock_guard< std::mutex > lock(match.mutex);
+		for (uint32_t s = 0; s < 2; ++s) {
+			Match::Inbox &inbox = match.inbox[s];
+			NetServer::Client &client = match.clients[s];
+			if (inbox.taken && !match.playing[s]) {
+				//joined:
+				glm::vec2 const &paddle = (s == 0 ? match.sim.left_paddle : match.sim.right_paddle);
+				client.reset(inbox.address, uint8_t(s + 1), paddle.y);
+				match.playing[s] = true;
+				(s == 0 ? match.sim.left_script : match.sim.right_script) = PaddleScript(PaddleScript::Player);
+			}
+			if (!match.playing[s]) continue;
+			if (inbox.heard) {
+				client.silent = 0.0f;
+				client.paddle_y = inbox.paddle_y;
+				client.ack(inbox.ack);
+				inbox.heard = false;
+			}
+			client.silent += elapsed;
+			if (inbox.bye || client.silent > config.timeout) {
+				//left (or gone quiet):
+				inbox = Match::Inbox();
+				match.playing[s] = false;
+				(s == 0 ? match.sim.left_script : match.sim.right_script) = match.free_script[s];
+			}
+		}
+	}
+
+	//simulate:
+	if (match.playing[0]) match.sim.left_paddle.y = match.clients[0].paddle_y;
+	if (match.playing[1]) match.sim.right_paddle.y = match.clients[1].paddle_y;
+	match.sim.update(elapsed);
+	match.ticks += 1;
+
+	//send snapshots:
+	uint32_t players = 0;
+	if (match.playing[0] || match.playing[1]) {
+		match.current.capture(match.sim, match.ticks);
+		for (uint32_t s = 0; s < 2; ++s) {
+			if (!match.playing[s]) continue;
+			players += 1;
+			NetServer::Client &client = match.clients[s];
+			if (!client.refill(elapsed, config.budget)) continue;
+			if (size_t size = client.write_snapshot(match.current, match.empty, outbox.next())) {
+				outbox.add(client.address, size);
+				if (outbox.count == Outbox::Capacity) outbox.flush(socket, *this);
+			}
+		}
+	}
+	match.players.store(players, std::memory_order_relaxed);
+
+	uint64_t ns = uint64_t(std::chrono::duration_cast< std::chrono::nanoseconds >(std::chrono::steady_clock::now() - start).count());
+	match.cost_ns.fetch_add(ns, std::memory_order_relaxed);
+	match.cost_ticks.fetch_add(1, std::memory_order_relaxed);
+	if (ns > match.worst_ns.load(std::memory_order_relaxed)) match.worst_ns.store(ns, std::memory_order_relaxed);
+}
+
+MatchServer::Report MatchServer::report() {
+	Report report;
+	auto now = std::chrono::steady_clock::now();
+	report.seconds = std::chrono::duration< float >(now - last_report).count();
+	last_report = now;
+
+	report.matches = uint32_t(matches.size());
+	costs.clear();
+	uint64_t total_ns = 0;
+	uint64_t worst_ns = 0;
+	for (uint32_t m = 0; m < matches.size(); ++m) {
+		Match &match = *matches[m];
+		uint64_t ns = match.cost_ns.exchange(0, std::memory_order_relaxed);
+		uint32_t ticks = match.cost_ticks.exchange(0, std::memory_order_relaxed);
+		uint64_t worst = match.worst_ns.exchange(0, std::memory_order_relaxed);
+		report.players += match.players.load(std::memory_order_relaxed);
+		report.ticks += ticks;
+		total_ns += ns;
+		if (worst > worst_ns) {
+			worst_ns = worst;
+			report.costliest_match = m;
+		}
+		if (ticks) costs.emplace_back(ns / 1000.0f / ticks);
+	}
+	if (!costs.empty()) {
+		report.cost_mean_us = total_ns / 1000.0f / std::max< uint64_t >(1, report.ticks);
+		std::sort(costs.begin(), costs.end());
+		report.cost_median_us = costs[costs.size() / 2];
+		report.cost_p99_us = costs[std::min(costs.size() - 1, costs.size() * 99 / 100)];
+		report.cost_max_us = worst_ns / 1000.0f;
+	}
+	report.late = late.exchange(0, std::memory_order_relaxed);
+	report.busy = busy_ns.exchange(0, std::memory_order_relaxed) / (1e9f * std::max(1e-6f, report.seconds) * workers.size());
+	report.packets_in = packets_in.exchange(0, std::memory_order_relaxed);
+	report.bytes_in = bytes_in.exchange(0, std::memory_order_relaxed);
+	report.packets_out = packets_out.exchange(0, std::memory_order_relaxed);
+	report.bytes_out = bytes_out.exchange(0, std::memory_order_relaxed);
+#ifdef ENABLE_ALLOC_TRACKING
+	for (AllocTracker::Stats const &stats : AllocTracker::by_tag()) {
+		if (std::string(stats.tag) == "match tick") {
+			report.tick_allocations = stats.allocations - tick_allocations_before;
+			tick_allocations_before = stats.allocations;
+		}
+	}
+#endif
+	return report;
+}
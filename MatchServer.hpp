@@ -0,0 +1,137 @@
+#pragma once
+
+#include "NetServer.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * MatchServer hosts many independent matches at once, each a game like NetServer's (same protocol; clients
+ *  pick a match by number in their Input packets) with up to two players.
+ *
+ * Threads:
+ *  - a few I/O threads, each reading its own socket (all bound to the same port, so the system spreads
+ *    clients across them) as epoll says packets are waiting, in batches (recvmmsg). They only parse inputs
+ *    and post them to the match's inbox, under that match's own lock.
+ *  - a pool of worker threads, one pinned to each core, which tick the matches at the fixed rate. Each match
+ *    belongs to one worker for good (match % workers), which also created it, so a match's memory stays
+ *    near -- and in the cache of -- the core that runs it. Workers send their matches' snapshots themselves,
+ *    in batches (sendmmsg).
+ *
+ * Nothing allocates per tick: matches reserve room for as many balls as their scenario can make, and
+ *  packets are built in buffers each thread owns. (With ENABLE_ALLOC_TRACKING, report() counts any
+ *  allocations made while ticking, to keep it that way.)
+ *
+ * Every match's cost -- time spent ticking it, snapshots included -- is measured, and report() sums
+ *  and ranks them.
+ *
+ * Needs epoll, so Linux only for now; the constructor throws elsewhere.
+ */
+
+struct MatchServer {
+	struct Config {
+		NetAddress bind_to;
+		Scenario scenario; //every match plays this (with seeds offset by match number, so they differ)
+		uint32_t matches = 1000;
+		uint32_t workers = 0; //0 = one per core
+		uint32_t io_threads = 2;
+		float tick_rate = 60.0f;
+		uint32_t budget = 16384; //bytes per second per client (see NetServer)
+		float timeout = 5.0f; //seconds
+	};
+	//opens the sockets and starts every thread (returning once all matches exist); throws on failure:
+	MatchServer(Config const &config);
+	//stops and joins every thread:
+	~MatchServer();
+
+	MatchServer(MatchServer const &) = delete;
+	MatchServer &operator=(MatchServer const &) = delete;
+
+	//what happened since the last report (the first covers everything since starting):
+	struct Report {
+		float seconds = 0.0f;
+		uint32_t matches = 0;
+		uint32_t players = 0;
+		uint64_t ticks = 0; //match ticks run
+		uint32_t late = 0; //worker passes that didn't finish within a tick
+		//cost per match tick, in microseconds (across matches, of each one's average this period):
+		float cost_mean_us = 0.0f;
+		float cost_median_us = 0.0f;
+		float cost_p99_us = 0.0f;
+		float cost_max_us = 0.0f; //(the single most expensive tick)
+		uint32_t costliest_match = 0;
+		float busy = 0.0f; //fraction of the workers' time spent ticking
+		uint64_t packets_in = 0, bytes_in = 0;
+		uint64_t packets_out = 0, bytes_out = 0; //(bytes include IP and UDP headers)
+		uint64_t tick_allocations = 0; //heap allocations while ticking (only counted with ENABLE_ALLOC_TRACKING)
+	};
+	Report report();
+
+	Config config;
+
+	struct Match {
+		Match(Scenario const &scenario);
+		PongSim sim;
+		NetView current;
+		NetView empty;
+		uint32_t ticks = 0;
+		PaddleScript free_script[2]; //how paddles move without a player
+		NetServer::Client clients[2]; //left, right
+		bool playing[2] = {false, false};
+
+		//written by I/O threads, read by the match's worker, both under 'mutex':
+		std::mutex mutex;
+		struct Inbox {
+			bool taken = false; //a client has this paddle
+			NetAddress address;
+			bool heard = false; //new input since the worker last looked
+			bool bye = false;
+			float paddle_y = 0.0f;
+			uint32_t ack = NetPacket::NoSeq;
+		} inbox[2];
+
+		//statistics (written by the match's worker, read and reset by report()):
+		std::atomic< uint64_t > cost_ns{0};
+		std::atomic< uint64_t > worst_ns{0};
+		std::atomic< uint32_t > cost_ticks{0};
+		std::atomic< uint32_t > players{0};
+	};
+	//(created by their workers, before any I/O starts; never moved after)
+	std::vector< std::unique_ptr< Match > > matches;
+
+	//----- internals -----
+	std::vector< std::unique_ptr< UDPSocket > > sockets; //one per I/O thread
+	std::vector< std::thread > io_threads;
+	std::vector< std::thread > workers;
+	std::atomic< bool > quit{false};
+	std::atomic< uint32_t > workers_ready{0};
+	std::chrono::steady_clock::time_point last_report = std::chrono::steady_clock::now();
+
+	std::atomic< uint64_t > packets_in{0}, bytes_in{0};
+	std::atomic< uint64_t > packets_out{0}, bytes_out{0};
+	std::atomic< uint32_t > late{0};
+	std::atomic< uint64_t > busy_ns{0};
+	uint64_t tick_allocations_before = 0;
+	std::vector< float > costs; //(report()'s scratch space)
+
+	void io_thread(uint32_t index);
+	void worker(uint32_t index, uint32_t count);
+	//post an input (or a bye) to its match; returns false if there is no such match or no room:
+	bool post(NetAddress const &from, uint8_t const *data, size_t size);
+
+	//a worker's outgoing packets, sent in batches:
+	struct Outbox {
+		static constexpr uint32_t Capacity = 64;
+		Outbox();
+		uint8_t *next(); //buffer for the next packet (NetPacket::MaxSize bytes)
+		void add(NetAddress const &to, size_t size); //queue the packet just written to next()
+		void flush(UDPSocket &socket, MatchServer &server);
+		std::vector< uint8_t > buffers;
+		std::vector< UDPDatagram > datagrams;
+		uint32_t count = 0;
+	};
+	void tick(Match &match, Outbox &outbox, UDPSocket &socket);
+};
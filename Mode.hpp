@@ -5,6 +5,8 @@
 
 #include <memory>
 
+struct Telemetry;
+
 struct Mode : std::enable_shared_from_this< Mode > {
 	virtual ~Mode() { }
 
@@ -20,6 +22,9 @@ struct Mode : std::enable_shared_from_this< Mode > {
 	//draw is called after update:
 	virtual void draw(glm::uvec2 const &drawable_size) = 0;
 
+	//record_telemetry is called after draw, to add mode-specific per-frame measurements:
+	virtual void record_telemetry(Telemetry &) { }
+
 	//Mode::current is the Mode to which events are dispatched.
 	// use 'set_current' to change the current Mode (e.g., to switch to a menu)
 	static std::shared_ptr< Mode > current;
@@ -0,0 +1,219 @@
+#include "Net.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+std::string NetAddress::to_string() const {
+	return std::to_string((host >> 24) & 0xff) + "." + std::to_string((host >> 16) & 0xff) + "."
+	     + std::to_string((host >> 8) & 0xff) + "." + std::to_string(host & 0xff) + ":" + std::to_string(port);
+}
+
+#ifndef _WIN32
+
+namespace {
+	sockaddr_in to_sockaddr(NetAddress const &address) {
+		sockaddr_in addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(address.host);
+		addr.sin_port = htons(address.port);
+		return addr;
+	}
+	NetAddress from_sockaddr(sockaddr_in const &addr) {
+		NetAddress address;
+		address.host = ntohl(addr.sin_addr.s_addr);
+		address.port = ntohs(addr.sin_port);
+		return address;
+	}
+}
+
+NetAddress NetAddress::parse(std::string const &str) {
+	size_t colon = str.rfind(':');
+	if (colon == std::string::npos) {
+		throw std::runtime_error("Address '" + str + "' should be 'host:port'.");
+	}
+	std::string host = str.substr(0, colon);
+	std::string port = str.substr(colon + 1);
+	char *end = nullptr;
+	unsigned long port_number = std::strtoul(port.c_str(), &end, 10);
+	if (port.empty() || *end != '\0' || port_number > 0xffff) {
+		throw std::runtime_error("Address '" + str + "' has a bad port.");
+	}
+
+	NetAddress address;
+	address.port = uint16_t(port_number);
+	if (host.empty()) return address;
+
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo *found = nullptr;
+	int err = getaddrinfo(host.c_str(), nullptr, &hints, &found);
+	if (err != 0 || !found) {
+		throw std::runtime_error("Failed to resolve '" + host + "': " + std::string(gai_strerror(err)));
+	}
+	address.host = from_sockaddr(*reinterpret_cast< sockaddr_in const * >(found->ai_addr)).host;
+	freeaddrinfo(found);
+	return address;
+}
+
+UDPSocket::UDPSocket(NetAddress const &bind_to, bool share_port) {
+	fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0) throw std::runtime_error("Failed to create UDP socket: " + std::string(std::strerror(errno)));
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	if (share_port) {
+		int one = 1;
+		if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+			std::string error = std::strerror(errno);
+			::close(fd);
+			fd = -1;
+			throw std::runtime_error("Failed to share UDP port: " + error);
+		}
+	}
+	sockaddr_in addr = to_sockaddr(bind_to);
+	if (::bind(fd, reinterpret_cast< sockaddr const * >(&addr), sizeof(addr)) != 0) {
+		std::string error = std::strerror(errno);
+		::close(fd);
+		fd = -1;
+		throw std::runtime_error("Failed to bind UDP socket to " + bind_to.to_string() + ": " + error);
+	}
+}
+
+UDPSocket::~UDPSocket() {
+	if (fd >= 0) ::close(fd);
+}
+
+bool UDPSocket::send(NetAddress const &to, void const *data, size_t size) {
+	sockaddr_in addr = to_sockaddr(to);
+	return ::sendto(fd, data, size, 0, reinterpret_cast< sockaddr const * >(&addr), sizeof(addr)) == ssize_t(size);
+}
+
+size_t UDPSocket::receive(NetAddress *from, void *data, size_t capacity) {
+	sockaddr_in addr;
+	socklen_t addr_size = sizeof(addr);
+	ssize_t got = ::recvfrom(fd, data, capacity, 0, reinterpret_cast< sockaddr * >(&addr), &addr_size);
+	if (got <= 0) return 0; //(nothing waiting -- or an error, which for UDP is as good as a lost datagram)
+	if (from) *from = from_sockaddr(addr);
+	return size_t(got);
+}
+
+size_t UDPSocket::send_batch(UDPDatagram const *datagrams, size_t count) {
+#ifdef __linux__
+	//(in chunks, so the system call's arrays can live on the stack)
+	constexpr size_t Chunk = 64;
+	mmsghdr messages[Chunk];
+	iovec iovecs[Chunk];
+	sockaddr_in addrs[Chunk];
+	size_t sent = 0;
+	while (sent < count) {
+		size_t chunk = std::min(Chunk, count - sent);
+		for (size_t i = 0; i < chunk; ++i) {
+			UDPDatagram const &datagram = datagrams[sent + i];
+			addrs[i] = to_sockaddr(datagram.address);
+			iovecs[i].iov_base = datagram.data;
+			iovecs[i].iov_len = datagram.size;
+			std::memset(&messages[i], 0, sizeof(messages[i]));
+			messages[i].msg_hdr.msg_name = &addrs[i];
+			messages[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+			messages[i].msg_hdr.msg_iov = &iovecs[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+		int got = ::sendmmsg(fd, messages, unsigned(chunk), 0);
+		if (got <= 0) break;
+		sent += size_t(got);
+		if (size_t(got) < chunk) break;
+	}
+	return sent;
+#else
+	size_t sent = 0;
+	while (sent < count && send(datagrams[sent].address, datagrams[sent].data, datagrams[sent].size)) ++sent;
+	return sent;
+#endif
+}
+
+size_t UDPSocket::receive_batch(UDPDatagram *datagrams, size_t count) {
+#ifdef __linux__
+	constexpr size_t Chunk = 64;
+	mmsghdr messages[Chunk];
+	iovec iovecs[Chunk];
+	sockaddr_in addrs[Chunk];
+	size_t received = 0;
+	while (received < count) {
+		size_t chunk = std::min(Chunk, count - received);
+		for (size_t i = 0; i < chunk; ++i) {
+			UDPDatagram &datagram = datagrams[received + i];
+			iovecs[i].iov_base = datagram.data;
+			iovecs[i].iov_len = datagram.capacity;
+			std::memset(&messages[i], 0, sizeof(messages[i]));
+			messages[i].msg_hdr.msg_name = &addrs[i];
+			messages[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+			messages[i].msg_hdr.msg_iov = &iovecs[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+		int got = ::recvmmsg(fd, messages, unsigned(chunk), MSG_DONTWAIT, nullptr);
+		if (got <= 0) break;
+		for (int i = 0; i < got; ++i) {
+			UDPDatagram &datagram = datagrams[received + i];
+			datagram.address = from_sockaddr(addrs[i]);
+			datagram.size = messages[i].msg_len;
+		}
+		received += size_t(got);
+		if (size_t(got) < chunk) break;
+	}
+	return received;
+#else
+	size_t received = 0;
+	while (received < count) {
+		UDPDatagram &datagram = datagrams[received];
+		datagram.size = receive(&datagram.address, datagram.data, datagram.capacity);
+		if (datagram.size == 0) break;
+		++received;
+	}
+	return received;
+#endif
+}
+
+void UDPSocket::set_buffer_sizes(int bytes) {
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+	setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes));
+}
+
+NetAddress UDPSocket::local_address() const {
+	sockaddr_in addr;
+	socklen_t addr_size = sizeof(addr);
+	std::memset(&addr, 0, sizeof(addr));
+	getsockname(fd, reinterpret_cast< sockaddr * >(&addr), &addr_size);
+	return from_sockaddr(addr);
+}
+
+#else //_WIN32
+
+NetAddress NetAddress::parse(std::string const &str) {
+	throw std::runtime_error("Networking isn't supported on Windows yet (can't use '" + str + "').");
+}
+
+UDPSocket::UDPSocket(NetAddress const &, bool) {
+	throw std::runtime_error("Networking isn't supported on Windows yet.");
+}
+UDPSocket::~UDPSocket() { }
+bool UDPSocket::send(NetAddress const &, void const *, size_t) { return false; }
+size_t UDPSocket::receive(NetAddress *, void *, size_t) { return 0; }
+size_t UDPSocket::send_batch(UDPDatagram const *, size_t) { return 0; }
+size_t UDPSocket::receive_batch(UDPDatagram *, size_t) { return 0; }
+void UDPSocket::set_buffer_sizes(int) { }
+NetAddress UDPSocket::local_address() const { return NetAddress(); }
+
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * Minimal UDP networking: an IPv4 address type and a non-blocking UDP socket.
+ * (BSD sockets on Linux/MacOS; not yet supported on Windows, where opening a socket throws.)
+ */
+
+struct NetAddress {
+	uint32_t host = 0; //IPv4 address, host byte order (0 = any)
+	uint16_t port = 0; //host byte order (0 = any)
+
+	//parse "host:port" or ":port" (host may be a name, resolved now); throws on failure:
+	static NetAddress parse(std::string const &str);
+	std::string to_string() const;
+
+	bool operator==(NetAddress const &o) const { return host == o.host && port == o.port; }
+	bool operator!=(NetAddress const &o) const { return !(*this == o); }
+};
+
+//one datagram of a batch (see UDPSocket::send_batch / receive_batch):
+struct UDPDatagram {
+	NetAddress address; //destination (sending) or source (received)
+	uint8_t *data = nullptr;
+	size_t size = 0; //bytes in 'data' (set by receive_batch)
+	size_t capacity = 0; //room in 'data' (for receive_batch)
+};
+
+struct UDPSocket {
+	//open a non-blocking socket bound to 'bind_to' (port 0 picks a free one); throws on failure.
+	// With 'share_port', several sockets can bind the same port, and the system spreads incoming
+	// datagrams across them by sender (so each can be read by its own thread):
+	UDPSocket(NetAddress const &bind_to = NetAddress(), bool share_port = false);
+	~UDPSocket();
+
+	UDPSocket(UDPSocket const &) = delete;
+	UDPSocket &operator=(UDPSocket const &) = delete;
+
+	//send one datagram; returns false if it couldn't be sent right now (datagrams may be lost anyway):
+	bool send(NetAddress const &to, void const *data, size_t size);
+	//receive one waiting datagram into 'data'; returns its size, or 0 if none is waiting
+	// (datagrams longer than 'capacity' are truncated):
+	size_t receive(NetAddress *from, void *data, size_t capacity);
+
+	//the same for several datagrams at once, with as few system calls as the platform allows
+	// (sendmmsg / recvmmsg on Linux); send_batch returns how many were sent, receive_batch how many were received:
+	size_t send_batch(UDPDatagram const *datagrams, size_t count);
+	size_t receive_batch(UDPDatagram *datagrams, size_t count);
+
+	//ask for larger kernel send / receive buffers (for servers with many clients; the system may give less):
+	void set_buffer_sizes(int bytes);
+
+	//the address actually bound (e.g., to find the port picked for port 0):
+	NetAddress local_address() const;
+
+	//----- internals -----
+	int fd = -1;
+};
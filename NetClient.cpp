@@ -0,0 +1,62 @@
+#include "NetClient.hpp"
+
+constexpr uint32_t NetClient::History;
+
+NetClient::NetClient(NetAddress const &server_) : server(server_) {
+	view_seq.fill(NetPacket::NoSeq);
+}
+
+NetClient::~NetClient() {
+	size_t size = write_bye(match, buffer.data(), buffer.size());
+	socket.send(server, buffer.data(), size);
+}
+
+void NetClient::send_input(float paddle_y) {
+	NetInput input;
+	input.match = match;
+	input.ack = newest;
+	input.paddle_y = paddle_y;
+	size_t size = input.write(buffer.data(), buffer.size());
+	socket.send(server, buffer.data(), size);
+}
+
+bool NetClient::poll() {
+	bool changed = false;
+	NetAddress from;
+	while (size_t size = socket.receive(&from, buffer.data(), buffer.size())) {
+		if (from != server) continue;
+		NetSnapshotHeader header;
+		if (!header.read(buffer.data(), size)) continue;
+		bytes += size + NetPacket::Overhead;
+
+		//only newer snapshots matter (this is unreliable transport; late ones are just dropped):
+		if (newest != NetPacket::NoSeq && header.seq <= newest) {
+			dropped += 1;
+			continue;
+		}
+		static NetView const empty;
+		NetView const *baseline = &empty;
+		if (header.baseline != NetPacket::NoSeq) {
+			//(the server never deltas against a snapshot History or more back, so the baseline's slot isn't the new one's)
+			if (header.baseline >= header.seq || header.seq - header.baseline >= History
+			 || view_seq[header.baseline % History] != header.baseline) {
+				dropped += 1;
+				continue;
+			}
+			baseline = &views[header.baseline % History];
+		}
+		NetView &decoded = views[header.seq % History];
+		view_seq[header.seq % History] = NetPacket::NoSeq;
+		if (!read_snapshot(buffer.data(), size, *baseline, &decoded)) {
+			dropped += 1;
+			continue;
+		}
+		view_seq[header.seq % History] = header.seq;
+		newest = header.seq;
+		side = header.side;
+		view = decoded;
+		snapshots += 1;
+		changed = true;
+	}
+	return changed;
+}
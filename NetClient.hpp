@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Net.hpp"
+#include "NetSnapshot.hpp"
+
+#include <array>
+#include <cstdint>
+
+/*
+ * NetClient is the client end of a NetServer connection: it sends the local paddle's height
+ *  (and acks snapshots) with send_input(), and poll() decodes whatever snapshots have arrived into 'view'.
+ * There is no handshake: the first input joins the game, and the destructor says goodbye.
+ */
+
+struct NetClient {
+	//throws if the socket can't be opened:
+	NetClient(NetAddress const &server);
+	~NetClient();
+
+	//send the paddle height (ignored by the server unless this client has a paddle):
+	void send_input(float paddle_y);
+	//read waiting snapshots; returns true if 'view' changed:
+	bool poll();
+
+	NetAddress server;
+	uint32_t match = 0; //which match to play in (on a MatchServer)
+	UDPSocket socket;
+
+	//newest state received, and which paddle (if any) is ours (1 = left, 2 = right, 0 = watching):
+	NetView view;
+	uint8_t side = 0;
+	uint32_t newest = NetPacket::NoSeq; //seq of 'view'
+
+	//statistics (reset by whoever reports them):
+	uint64_t bytes = 0; //received, including headers
+	uint32_t snapshots = 0;
+	uint32_t dropped = 0; //snapshots that were stale or whose baseline was gone
+
+	//----- internals -----
+	//recent snapshots (indexed by seq % History), since the server may delta against any that were acked:
+	static constexpr uint32_t History = 64;
+	std::array< NetView, History > views;
+	std::array< uint32_t, History > view_seq;
+	std::array< uint8_t, NetPacket::MaxSize > buffer;
+};
@@ -0,0 +1,62 @@
+#include "NetLink.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+//----- UDPLink -----
+
+UDPLink::UDPLink(NetAddress const &bind_to, NetAddress const &peer_) : socket(bind_to), peer(peer_) {
+}
+
+void UDPLink::send(void const *data, size_t size) {
+	socket.send(peer, data, size);
+}
+
+size_t UDPLink::receive(void *data, size_t capacity) {
+	NetAddress from;
+	while (size_t size = socket.receive(&from, data, capacity)) {
+		if (from == peer) return size;
+	}
+	return 0;
+}
+
+//----- Loopback -----
+
+Loopback::Loopback(Conditions const &conditions_, uint64_t seed) : conditions(conditions_), rng(seed) {
+	for (uint32_t i = 0; i < 2; ++i) {
+		ends[i].loopback = this;
+		ends[i].other = &ends[1 - i];
+	}
+}
+
+void Loopback::End::send(void const *data, size_t size) {
+	Conditions const &conditions = loopback->conditions;
+	loopback->sent += 1;
+	if (loopback->rng.next_float() < conditions.loss) {
+		loopback->dropped += 1;
+		return;
+	}
+	if (other->in_flight_count == other->in_flight.size()) other->in_flight.emplace_back();
+	Packet &packet = other->in_flight[other->in_flight_count++];
+	packet.arrives = loopback->time + conditions.latency + loopback->rng.next_float() * conditions.jitter;
+	packet.data.assign(reinterpret_cast< uint8_t const * >(data), reinterpret_cast< uint8_t const * >(data) + size);
+}
+
+size_t Loopback::End::receive(void *data, size_t capacity) {
+	//deliver the earliest-arriving packet that has arrived:
+	uint32_t earliest = in_flight_count;
+	for (uint32_t i = 0; i < in_flight_count; ++i) {
+		if (in_flight[i].arrives <= loopback->time && (earliest == in_flight_count || in_flight[i].arrives < in_flight[earliest].arrives)) {
+			earliest = i;
+		}
+	}
+	if (earliest == in_flight_count) return 0;
+
+	Packet &packet = in_flight[earliest];
+	size_t size = std::min(capacity, packet.data.size());
+	std::memcpy(data, packet.data.data(), size);
+	//(swap it past the end, keeping its buffer for a later packet)
+	in_flight_count -= 1;
+	std::swap(in_flight[earliest], in_flight[in_flight_count]);
+	return size;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Net.hpp"
+#include "Rng.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * NetLink is a datagram connection to one peer (unreliable and unordered, like UDP), for RollbackSession.
+ *  UDPLink is the real thing; Loopback connects two links inside one process through a simulated network
+ *  with latency, jitter and loss, so netcode can be tried out (and tested repeatably) without a network.
+ */
+
+struct NetLink {
+	virtual ~NetLink() { }
+	//send one datagram (which may be lost):
+	virtual void send(void const *data, size_t size) = 0;
+	//receive one waiting datagram into 'data'; returns its size, or 0 if none is waiting:
+	virtual size_t receive(void *data, size_t capacity) = 0;
+};
+
+struct UDPLink : NetLink {
+	//throws if the socket can't be opened:
+	UDPLink(NetAddress const &bind_to, NetAddress const &peer);
+	virtual void send(void const *data, size_t size) override;
+	//(datagrams from anyone but 'peer' are ignored)
+	virtual size_t receive(void *data, size_t capacity) override;
+
+	UDPSocket socket;
+	NetAddress peer;
+};
+
+struct Loopback {
+	struct Conditions {
+		float latency = 0.05f; //one-way delay, seconds
+		float jitter = 0.0f; //extra delay, uniform in [0,jitter) seconds (so packets can arrive out of order)
+		float loss = 0.0f; //fraction of packets dropped
+	};
+	//the simulated network's randomness comes from 'seed', so a run with the same sends is the same:
+	Loopback(Conditions const &conditions, uint64_t seed = 1);
+
+	//the two ends (what ends[0] sends, ends[1] receives, and vice versa):
+	NetLink &end(uint32_t index) { return ends[index]; }
+
+	//packets are delivered by the simulated clock, which the caller moves along:
+	void advance(float elapsed) { time += elapsed; }
+	double time = 0.0;
+
+	Conditions conditions;
+	Rng rng;
+
+	//statistics:
+	uint64_t sent = 0;
+	uint64_t dropped = 0;
+
+	//----- internals -----
+	struct Packet {
+		double arrives = 0.0;
+		std::vector< uint8_t > data; //(spent packets are kept, so their buffers get reused)
+	};
+	struct End : NetLink {
+		virtual void send(void const *data, size_t size) override;
+		virtual size_t receive(void *data, size_t capacity) override;
+		Loopback *loopback = nullptr;
+		End *other = nullptr;
+		std::vector< Packet > in_flight; //to this end
+		uint32_t in_flight_count = 0; //(entries past this are spare)
+	};
+	End ends[2];
+
+	Loopback(Loopback const &) = delete;
+	Loopback &operator=(Loopback const &) = delete;
+};
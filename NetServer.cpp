@@ -0,0 +1,156 @@
+#include "NetServer.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+constexpr uint32_t NetServer::History;
+constexpr size_t NetServer::MinPacket;
+
+NetServer::NetServer(Scenario const &scenario_, NetAddress const &bind_to, float tick_rate_)
+	: scenario(scenario_), sim(scenario_), socket(bind_to), tick_rate(tick_rate_) {
+	//paddles the scenario gives to a player are played by the ai until someone joins:
+	free_script[0] = (scenario.left.kind == PaddleScript::Player ? PaddleScript(PaddleScript::AI) : scenario.left);
+	free_script[1] = (scenario.right.kind == PaddleScript::Player ? PaddleScript(PaddleScript::AI) : scenario.right);
+	sim.left_script = free_script[0];
+	sim.right_script = free_script[1];
+}
+
+void NetServer::poll() {
+	NetAddress from;
+	while (size_t size = socket.receive(&from, buffer.data(), buffer.size())) {
+		auto found = std::find_if(clients.begin(), clients.end(), [&from](Client const &c) { return c.address == from; });
+		uint8_t type = NetPacket::type(buffer.data(), size);
+		if (type == NetPacket::Input) {
+			NetInput input;
+			if (!input.read(buffer.data(), size)) continue;
+			if (found == clients.end()) {
+				if (clients.size() >= max_clients) continue;
+				join(from);
+				found = clients.end() - 1;
+			}
+			Client &client = *found;
+			client.silent = 0.0f;
+			client.paddle_y = input.paddle_y;
+			client.ack(input.ack);
+		} else if (type == NetPacket::Bye) {
+			if (found != clients.end()) leave(found - clients.begin());
+		}
+		//(anything else is ignored)
+	}
+}
+
+void NetServer::join(NetAddress const &address) {
+	clients.emplace_back();
+	Client &client = clients.back();
+	client.reset(address, 0, 0.0f);
+	bool left_taken = false, right_taken = false;
+	for (Client const &c : clients) {
+		left_taken = left_taken || c.side == 1;
+		right_taken = right_taken || c.side == 2;
+	}
+	if (!left_taken) {
+		client.side = 1;
+		sim.left_script = PaddleScript(PaddleScript::Player);
+		client.paddle_y = sim.left_paddle.y;
+	} else if (!right_taken) {
+		client.side = 2;
+		sim.right_script = PaddleScript(PaddleScript::Player);
+		client.paddle_y = sim.right_paddle.y;
+	}
+	std::cout << "Client " << address.to_string() << " joined"
+	          << (client.side == 1 ? " as left player." : client.side == 2 ? " as right player." : " to watch.") << std::endl;
+}
+
+void NetServer::leave(size_t index) {
+	Client const &client = clients[index];
+	if (client.side == 1) sim.left_script = free_script[0];
+	if (client.side == 2) sim.right_script = free_script[1];
+	std::cout << "Client " << client.address.to_string() << " left." << std::endl;
+	clients.erase(clients.begin() + index);
+}
+
+void NetServer::tick() {
+	float elapsed = 1.0f / tick_rate;
+
+	for (Client const &client : clients) {
+		if (client.side == 1) sim.left_paddle.y = client.paddle_y;
+		if (client.side == 2) sim.right_paddle.y = client.paddle_y;
+	}
+	sim.update(elapsed);
+	ticks += 1;
+	current.capture(sim, ticks);
+
+	for (size_t i = 0; i < clients.size(); ) {
+		Client &client = clients[i];
+		client.silent += elapsed;
+		if (client.silent > timeout) {
+			std::cout << "Client " << client.address.to_string() << " timed out." << std::endl;
+			leave(i);
+			continue;
+		}
+		if (client.refill(elapsed, budget)) {
+			if (size_t size = client.write_snapshot(current, empty, buffer.data())) {
+				socket.send(client.address, buffer.data(), size);
+			}
+		}
+		++i;
+	}
+}
+
+//----- NetServer::Client -----
+
+void NetServer::Client::reset(NetAddress const &address_, uint8_t side_, float paddle_y_) {
+	address = address_;
+	side = side_;
+	paddle_y = paddle_y_;
+	acked = NetPacket::NoSeq;
+	next_seq = 0;
+	silent = 0.0f;
+	tokens = 0.0f;
+	cursor = 0;
+	sent_seq.fill(NetPacket::NoSeq);
+	bytes = 0;
+	snapshots = 0;
+	balls_sent = 0;
+	balls_left = 0;
+}
+
+void NetServer::Client::ack(uint32_t seq) {
+	if (seq != NetPacket::NoSeq && seq < next_seq && (acked == NetPacket::NoSeq || seq > acked)) {
+		acked = seq;
+	}
+}
+
+bool NetServer::Client::refill(float elapsed, uint32_t budget) {
+	//(tokens can bank up to one full packet)
+	float const most = float(NetPacket::MaxSize + NetPacket::Overhead);
+	tokens = std::min(most, tokens + budget * elapsed);
+	return tokens >= float(std::min(MinPacket, NetPacket::MaxSize) + NetPacket::Overhead);
+}
+
+size_t NetServer::Client::write_snapshot(NetView const &current, NetView const &empty, uint8_t *out) {
+	NetSnapshotHeader header;
+	header.seq = next_seq;
+	header.side = side;
+	//delta against the acked snapshot if it is still in the history (and not about to be overwritten):
+	NetView const *baseline = &empty;
+	if (acked != NetPacket::NoSeq && header.seq - acked < History && sent_seq[acked % History] == acked) {
+		header.baseline = acked;
+		baseline = &sent[acked % History];
+	}
+
+	if (tokens < float(NetPacket::Overhead)) return 0;
+	size_t capacity = std::min(NetPacket::MaxSize, size_t(tokens) - NetPacket::Overhead);
+	NetSnapshotStats stats;
+	size_t size = ::write_snapshot(header, *baseline, current, &cursor, out, capacity, &sent[header.seq % History], &stats);
+	if (size == 0) return 0;
+	sent_seq[header.seq % History] = header.seq;
+	next_seq += 1;
+
+	tokens -= float(size + NetPacket::Overhead);
+	bytes += size + NetPacket::Overhead;
+	snapshots += 1;
+	balls_sent += stats.balls_sent;
+	balls_left = stats.balls_left;
+	return size;
+}
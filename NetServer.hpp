@@ -0,0 +1,87 @@
+#pragma once
+
+#include "PongSim.hpp"
+#include "Scenario.hpp"
+#include "Net.hpp"
+#include "NetSnapshot.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/*
+ * NetServer runs a game authoritatively at a fixed tick rate for remote players (see NetSnapshot.hpp
+ *  for the protocol). A client joins by sending Input: it gets the first free paddle (left, then right),
+ *  or watches if both are taken, and is dropped after 'timeout' seconds without a packet.
+ *  Paddles without a player play as the scenario says (with the ai standing in for a missing player).
+ *
+ * Each tick, every client is sent a snapshot delta-compressed against the newest snapshot it acked, as its
+ *  bandwidth budget allows: a client's budget fills a token bucket, a snapshot is only sent once there are
+ *  tokens for a reasonable packet, and it holds only as many changed balls as the tokens pay for
+ *  (the rest follow in later packets). So a client's bandwidth stays under budget however many balls there are.
+ */
+
+struct NetServer {
+	//throws if the socket can't be opened:
+	NetServer(Scenario const &scenario, NetAddress const &bind_to, float tick_rate = 60.0f);
+
+	//handle every packet waiting on the socket:
+	void poll();
+	//simulate one tick (with the newest inputs), then send snapshots:
+	void tick();
+
+	Scenario scenario;
+	PongSim sim;
+	UDPSocket socket;
+	float tick_rate;
+	uint32_t ticks = 0;
+
+	uint32_t budget = 16384; //bytes per second per client (IP and UDP headers included)
+	float timeout = 5.0f; //seconds
+	uint32_t max_clients = 8;
+
+	//snapshots kept per client as possible baselines (a client acking one older than this gets a full update):
+	static constexpr uint32_t History = 64;
+	//snapshots aren't sent until there are tokens for at least this many bytes (or a full packet's worth):
+	static constexpr size_t MinPacket = 128;
+
+	struct Client {
+		NetAddress address;
+		uint8_t side = 0; //1 = left, 2 = right, 0 = watching
+		float paddle_y = 0.0f;
+		uint32_t acked = NetPacket::NoSeq;
+		uint32_t next_seq = 0;
+		float silent = 0.0f; //seconds since last heard from
+		float tokens = 0.0f; //bytes that may be sent now
+		uint32_t cursor = 0; //round-robin position for balls that don't all fit
+		std::array< NetView, History > sent; //views as of each snapshot sent (indexed by seq % History)
+		std::array< uint32_t, History > sent_seq;
+
+		//statistics (reset by whoever reports them):
+		uint64_t bytes = 0; //including headers
+		uint32_t snapshots = 0;
+		uint32_t balls_sent = 0;
+		uint32_t balls_left = 0; //in the last snapshot
+
+		//start over as a new client (keeping the history's buffers):
+		void reset(NetAddress const &address, uint8_t side, float paddle_y);
+		//take the ack from an input (acks only move forward, since inputs can arrive out of order,
+		// and only to snapshots actually sent):
+		void ack(uint32_t seq);
+		//add 'elapsed' seconds' worth of 'budget' bytes per second to the token bucket;
+		// returns true if there are now enough tokens to send a snapshot:
+		bool refill(float elapsed, uint32_t budget);
+		//write the next snapshot of 'current' into 'out' (with room for NetPacket::MaxSize bytes) as a delta against
+		// the newest usable ack (or 'empty'), as many bytes as the tokens allow, and count it as sent; returns its size:
+		size_t write_snapshot(NetView const &current, NetView const &empty, uint8_t *out);
+	};
+	std::vector< Client > clients;
+
+	//----- internals -----
+	NetView current; //this tick's view (shared by all clients)
+	NetView empty; //baseline for clients without a usable ack
+	PaddleScript free_script[2]; //how unplayed paddles move
+	std::array< uint8_t, NetPacket::MaxSize > buffer;
+	void join(NetAddress const &address);
+	void leave(size_t index);
+};
@@ -0,0 +1,278 @@
+#include "NetSnapshot.hpp"
+
+#include "BitPack.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr float NetView::Scale;
+constexpr uint8_t NetPacket::Protocol;
+constexpr size_t NetPacket::MaxSize;
+constexpr size_t NetPacket::Overhead;
+constexpr uint32_t NetPacket::NoSeq;
+
+namespace {
+	//coordinate deltas are zigzag-coded (so small negatives are small), then sent with a 2-bit size class:
+	// 0 = unchanged, 1 = 6 bits, 2 = 10 bits, 3 = 17 bits (any int16 difference)
+	uint32_t zigzag(int32_t delta) {
+		return (uint32_t(delta) << 1) ^ uint32_t(delta >> 31);
+	}
+	uint32_t delta_bits(int32_t delta) {
+		uint32_t z = zigzag(delta);
+		if (z == 0) return 2;
+		else if (z < (1u << 6)) return 2 + 6;
+		else if (z < (1u << 10)) return 2 + 10;
+		else return 2 + 17;
+	}
+	void write_delta(BitWriter &bits, int32_t delta) {
+		uint32_t z = zigzag(delta);
+		if (z == 0) {
+			bits.write(0, 2);
+		} else if (z < (1u << 6)) {
+			bits.write(1, 2);
+			bits.write(z, 6);
+		} else if (z < (1u << 10)) {
+			bits.write(2, 2);
+			bits.write(z, 10);
+		} else {
+			bits.write(3, 2);
+			bits.write(z, 17);
+		}
+	}
+	int32_t read_delta(BitReader &bits) {
+		uint32_t size_class = bits.read(2);
+		uint32_t z = 0;
+		if (size_class == 1) z = bits.read(6);
+		else if (size_class == 2) z = bits.read(10);
+		else if (size_class == 3) z = bits.read(17);
+		return int32_t(z >> 1) ^ -int32_t(z & 1);
+	}
+
+	//fields shared by write_snapshot and read_snapshot, after the header:
+	void write_view_scalars(BitWriter &bits, NetView const &view) {
+		bits.write(view.tick, 32);
+		bits.write(view.time_ms, 32);
+		bits.write(view.left_score, 16);
+		bits.write(view.right_score, 16);
+		bits.write(uint16_t(view.left_paddle), 16);
+		bits.write(uint16_t(view.right_paddle), 16);
+		bits.write(uint32_t(view.balls.size()), 16);
+	}
+	uint32_t read_view_scalars(BitReader &bits, NetView *view) {
+		view->tick = bits.read(32);
+		view->time_ms = bits.read(32);
+		view->left_score = uint16_t(bits.read(16));
+		view->right_score = uint16_t(bits.read(16));
+		view->left_paddle = int16_t(uint16_t(bits.read(16)));
+		view->right_paddle = int16_t(uint16_t(bits.read(16)));
+		return bits.read(16); //ball count
+	}
+
+	//start 'view' as a copy of 'baseline', resized to 'count' balls (new ones are all-zero), without reallocating if possible:
+	void start_from(NetView const &baseline, uint32_t count, NetView *view) {
+		size_t keep = std::min< size_t >(baseline.balls.size(), count);
+		view->balls.assign(baseline.balls.begin(), baseline.balls.begin() + keep);
+		view->balls.resize(count);
+	}
+}
+
+//----- NetView -----
+
+int16_t NetView::quantize(float value) {
+	float q = std::round(value * Scale);
+	q = std::max(-32767.0f, std::min(32767.0f, q));
+	return int16_t(q);
+}
+
+void NetView::capture(PongSim const &sim, uint32_t tick_) {
+	tick = tick_;
+	time_ms = uint32_t(std::max(0.0f, sim.time) * 1000.0f);
+	left_score = uint16_t(std::min< uint32_t >(sim.left_score, 0xffff));
+	right_score = uint16_t(std::min< uint32_t >(sim.right_score, 0xffff));
+	left_paddle = quantize(sim.left_paddle.y);
+	right_paddle = quantize(sim.right_paddle.y);
+
+	//(ball counts are sent in 16 bits)
+	balls.resize(std::min< size_t >(sim.balls.size(), 0xffff));
+	for (size_t i = 0; i < balls.size(); ++i) {
+		::Ball const &ball = sim.balls[i];
+		Ball &out = balls[i];
+		out.x = quantize(ball.ball.x);
+		out.y = quantize(ball.ball.y);
+		out.radius = uint8_t(std::max(0.0f, std::min(255.0f, std::round(ball.ball_radius.x * Scale))));
+		if (ball.trail_color == sim.player1_trail) out.color = 1;
+		else if (ball.trail_color == sim.player2_trail) out.color = 2;
+		else out.color = 0;
+	}
+}
+
+void NetView::apply(PongSim *sim) const {
+	sim->time = time_ms / 1000.0f;
+	sim->left_score = left_score;
+	sim->right_score = right_score;
+	sim->left_paddle.y = dequantize(left_paddle);
+	sim->right_paddle.y = dequantize(right_paddle);
+
+	//(new balls start out zeroed, with empty trails)
+	sim->balls.resize(balls.size());
+	for (size_t i = 0; i < balls.size(); ++i) {
+		Ball const &in = balls[i];
+		::Ball &ball = sim->balls[i];
+		ball.ball = glm::vec2(dequantize(in.x), dequantize(in.y));
+		ball.ball_radius = glm::vec2(in.radius / Scale);
+		if (in.color == 1) ball.trail_color = sim->player1_trail;
+		else if (in.color == 2) ball.trail_color = sim->player2_trail;
+		else ball.trail_color = glm::u8vec4(0x00, 0x00, 0x00, 0xff);
+	}
+}
+
+//----- packets -----
+
+uint8_t NetPacket::type(uint8_t const *data, size_t size) {
+	//(protocol and type are the first two 8-bit fields, so they are the first two bytes)
+	if (size < 2 || data[0] != Protocol) return 0;
+	return data[1];
+}
+
+size_t NetInput::write(uint8_t *out, size_t capacity) const {
+	BitWriter bits(out, capacity);
+	bits.write(NetPacket::Protocol, 8);
+	bits.write(NetPacket::Input, 8);
+	bits.write(match, 32);
+	bits.write(ack, 32);
+	bits.write(uint16_t(NetView::quantize(paddle_y)), 16);
+	return bits.overflowed ? 0 : bits.bytes();
+}
+
+bool NetInput::read(uint8_t const *data, size_t size) {
+	if (NetPacket::type(data, size) != NetPacket::Input) return false;
+	BitReader bits(data, size);
+	bits.skip(16); //(protocol and packet type)
+	match = bits.read(32);
+	ack = bits.read(32);
+	paddle_y = NetView::dequantize(int16_t(uint16_t(bits.read(16))));
+	return !bits.failed;
+}
+
+size_t write_bye(uint32_t match, uint8_t *out, size_t capacity) {
+	BitWriter bits(out, capacity);
+	bits.write(NetPacket::Protocol, 8);
+	bits.write(NetPacket::Bye, 8);
+	bits.write(match, 32);
+	return bits.overflowed ? 0 : bits.bytes();
+}
+
+bool read_bye(uint8_t const *data, size_t size, uint32_t *match) {
+	if (NetPacket::type(data, size) != NetPacket::Bye) return false;
+	BitReader bits(data, size);
+	bits.skip(16); //(protocol and packet type)
+	*match = bits.read(32);
+	return !bits.failed;
+}
+
+bool NetSnapshotHeader::read(uint8_t const *data, size_t size) {
+	if (NetPacket::type(data, size) != NetPacket::Snapshot) return false;
+	BitReader bits(data, size);
+	bits.skip(16); //(protocol and packet type)
+	seq = bits.read(32);
+	baseline = bits.read(32);
+	side = uint8_t(bits.read(2));
+	return !bits.failed;
+}
+
+size_t write_snapshot(NetSnapshotHeader const &header, NetView const &baseline, NetView const &view,
+	uint32_t *cursor, uint8_t *out, size_t capacity, NetView *sent, NetSnapshotStats *stats_) {
+	NetSnapshotStats stats;
+
+	BitWriter bits(out, capacity);
+	bits.write(NetPacket::Protocol, 8);
+	bits.write(NetPacket::Snapshot, 8);
+	bits.write(header.seq, 32);
+	bits.write(header.baseline, 32);
+	bits.write(header.side, 2);
+	write_view_scalars(bits, view);
+	if (bits.overflowed) return 0;
+
+	sent->tick = view.tick;
+	sent->time_ms = view.time_ms;
+	sent->left_score = view.left_score;
+	sent->right_score = view.right_score;
+	sent->left_paddle = view.left_paddle;
+	sent->right_paddle = view.right_paddle;
+	uint32_t count = uint32_t(view.balls.size());
+	start_from(baseline, count, sent);
+
+	//each ball entry: a 'more' bit, the index (one bit if it follows the previous entry's -- the
+	// "previous" before the first is index -1 -- otherwise 16 bits), a bit for whether radius and color
+	// follow, then the position as deltas from the baseline. A 0 'more' bit ends the list.
+	uint32_t start = (*cursor < count ? *cursor : 0);
+	uint32_t previous = 0xffffffff;
+	bool full = false;
+	for (uint32_t n = 0; n < count; ++n) {
+		uint32_t i = (start + n < count ? start + n : start + n - count);
+		NetView::Ball const &now = view.balls[i];
+		NetView::Ball &was = sent->balls[i];
+		if (now == was) continue;
+		if (full) {
+			stats.balls_left += 1;
+			continue;
+		}
+		bool follows = (i == previous + 1);
+		bool looks = (now.radius != was.radius || now.color != was.color);
+		size_t entry_bits = 1 + 1 + (follows ? 0 : 16) + 1 + (looks ? 8 + 2 : 0)
+			+ delta_bits(int32_t(now.x) - was.x) + delta_bits(int32_t(now.y) - was.y);
+		if (bits.bits() + entry_bits + 1 > capacity * 8) {
+			//out of room; the next packet starts here:
+			full = true;
+			*cursor = i;
+			stats.balls_left += 1;
+			continue;
+		}
+		bits.write_bool(true);
+		bits.write_bool(follows);
+		if (!follows) bits.write(i, 16);
+		bits.write_bool(looks);
+		if (looks) {
+			bits.write(now.radius, 8);
+			bits.write(now.color, 2);
+		}
+		write_delta(bits, int32_t(now.x) - was.x);
+		write_delta(bits, int32_t(now.y) - was.y);
+		was = now;
+		previous = i;
+		stats.balls_sent += 1;
+	}
+	bits.write_bool(false);
+
+	if (stats_) *stats_ = stats;
+	return bits.bytes();
+}
+
+bool read_snapshot(uint8_t const *data, size_t size, NetView const &baseline, NetView *view) {
+	NetSnapshotHeader header;
+	if (!header.read(data, size)) return false;
+	BitReader bits(data, size);
+	bits.skip(16 + 32 + 32 + 2); //(the header, read above)
+	uint32_t count = read_view_scalars(bits, view);
+	if (bits.failed) return false;
+	start_from(baseline, count, view);
+
+	uint32_t previous = 0xffffffff;
+	while (bits.read_bool()) {
+		uint32_t i = (bits.read_bool() ? previous + 1 : bits.read(16));
+		if (i >= count) return false;
+		NetView::Ball &ball = view->balls[i];
+		if (bits.read_bool()) {
+			ball.radius = uint8_t(bits.read(8));
+			ball.color = uint8_t(bits.read(2));
+		}
+		int32_t x = ball.x + read_delta(bits);
+		int32_t y = ball.y + read_delta(bits);
+		if (x < -32768 || x > 32767 || y < -32768 || y > 32767) return false;
+		ball.x = int16_t(x);
+		ball.y = int16_t(y);
+		previous = i;
+		if (bits.failed) return false;
+	}
+	return !bits.failed;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "PongSim.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * The network protocol's packets, and the game state ("view") clients are sent.
+ *
+ * A NetView is what a client needs to draw the game, quantized: ball positions and radii in 1/512ths of
+ *  a court unit, each ball's trail color as who last hit it, paddle heights, scores and time.
+ *  (Trails themselves aren't sent; clients grow them from the positions they get, as PongSim does.)
+ *
+ * Every packet is bit-packed (see BitPack.hpp) and starts with the protocol version and a packet type:
+ *  Input     client -> server: paddle height, plus the newest snapshot received (as an ack), and which
+ *            match to play in (for servers hosting many; see MatchServer.hpp); sent every frame
+ *  Snapshot  server -> client: a view, as a delta against a 'baseline' view the client acked (or against
+ *            an empty view): only balls that differ from the baseline are sent, each as small deltas,
+ *            as many as fit the packet (round-robin from where the last packet stopped, so all get their turn)
+ *  Bye       client -> server: leaving (and which match it was in, as for Input)
+ * (Peer-to-peer rollback games have their own packet type, PeerInputs; see Rollback.hpp.)
+ */
+
+struct NetView {
+	static constexpr float Scale = 512.0f; //units per court unit (so positions must be within +/-64)
+
+	struct Ball {
+		int16_t x = 0;
+		int16_t y = 0;
+		uint8_t radius = 0; //(so radii above 255/Scale are clamped)
+		uint8_t color = 0; //who last hit the ball: 0 = nobody, 1 = left player, 2 = right player
+		bool operator==(Ball const &o) const { return x == o.x && y == o.y && radius == o.radius && color == o.color; }
+		bool operator!=(Ball const &o) const { return !(*this == o); }
+	};
+
+	uint32_t tick = 0;
+	uint32_t time_ms = 0;
+	uint16_t left_score = 0;
+	uint16_t right_score = 0;
+	int16_t left_paddle = 0;
+	int16_t right_paddle = 0;
+	std::vector< Ball > balls;
+
+	//quantize 'sim's state into this view (allocates only if there are more balls than ever before):
+	void capture(PongSim const &sim, uint32_t tick);
+	//set 'sim's balls, paddles, scores and time from this view (leaving trails to PongSim::update_trails):
+	void apply(PongSim *sim) const;
+
+	static int16_t quantize(float value);
+	static float dequantize(int16_t value) { return value / Scale; }
+};
+
+struct NetPacket {
+	static constexpr uint8_t Protocol = 3; //2: Input names a match; 3: so does Bye
+	enum Type : uint8_t {
+		Input = 1,
+		Snapshot = 2,
+		Bye = 3,
+		PeerInputs = 4, //between RollbackSession peers (see Rollback.hpp)
+	};
+	//largest packet (stays under the usual 1500-byte MTU):
+	static constexpr size_t MaxSize = 1200;
+	//IPv4 + UDP header bytes, which count against bandwidth budgets too:
+	static constexpr size_t Overhead = 28;
+	static constexpr uint32_t NoSeq = 0xffffffff;
+
+	//the packet type (0 if the packet isn't from this protocol):
+	static uint8_t type(uint8_t const *data, size_t size);
+};
+
+struct NetInput {
+	uint32_t match = 0; //(NetServer hosts just one, and ignores this)
+	uint32_t ack = NetPacket::NoSeq; //newest snapshot received
+	float paddle_y = 0.0f;
+
+	//both return the packet size / false for a malformed packet:
+	size_t write(uint8_t *out, size_t capacity) const;
+	bool read(uint8_t const *data, size_t size);
+};
+
+//write a Bye packet for leaving 'match'; returns its size:
+size_t write_bye(uint32_t match, uint8_t *out, size_t capacity);
+//read a Bye packet's match; returns false for a malformed packet:
+bool read_bye(uint8_t const *data, size_t size, uint32_t *match);
+
+struct NetSnapshotHeader {
+	uint32_t seq = 0;
+	uint32_t baseline = NetPacket::NoSeq; //snapshot this one is a delta against (NoSeq = the empty view)
+	uint8_t side = 0; //the receiving client's paddle: 1 = left, 2 = right, 0 = watching
+
+	//returns false for a malformed packet:
+	bool read(uint8_t const *data, size_t size);
+};
+
+struct NetSnapshotStats {
+	uint32_t balls_sent = 0; //balls in the packet
+	uint32_t balls_left = 0; //balls that differ from the baseline, but didn't fit
+};
+
+//write 'view' as a snapshot delta against 'baseline' into at most 'capacity' bytes of 'out'; returns the size
+// (0 if even the header doesn't fit). Differing balls are written round-robin from '*cursor' (which is
+// updated) until out of room; 'sent' gets the view the client will have after reading it (so the server
+// can use it as a later baseline; it must not be 'baseline'). Doesn't allocate unless 'sent' must grow.
+size_t write_snapshot(NetSnapshotHeader const &header, NetView const &baseline, NetView const &view,
+	uint32_t *cursor, uint8_t *out, size_t capacity, NetView *sent, NetSnapshotStats *stats = nullptr);
+
+//read a snapshot, given the baseline view its header names, into 'view' (which must not be 'baseline');
+// returns false if malformed:
+bool read_snapshot(uint8_t const *data, size_t size, NetView const &baseline, NetView *view);
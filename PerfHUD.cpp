@@ -0,0 +1,163 @@
+#include "PerfHUD.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+constexpr uint32_t PerfHUD::History;
+
+namespace {
+	//3x5 pixel font, top row first; '#' is lit:
+	struct Glyph {
+		char c;
+		char const *rows[5];
+	};
+	Glyph const Font[] = {
+		{'0', {"###", "#.#", "#.#", "#.#", "###"}},
+		{'1', {".#.", "##.", ".#.", ".#.", "###"}},
+		{'2', {"###", "..#", "###", "#..", "###"}},
+		{'3', {"###", "..#", ".##", "..#", "###"}},
+		{'4', {"#.#", "#.#", "###", "..#", "..#"}},
+		{'5', {"###", "#..", "###", "..#", "###"}},
+		{'6', {"###", "#..", "###", "#.#", "###"}},
+		{'7', {"###", "..#", "..#", ".#.", ".#."}},
+		{'8', {"###", "#.#", "###", "#.#", "###"}},
+		{'9', {"###", "#.#", "###", "..#", "###"}},
+		{'.', {"...", "...", "...", "...", ".#."}},
+		{':', {"...", ".#.", "...", ".#.", "..."}},
+		{'A', {".#.", "#.#", "###", "#.#", "#.#"}},
+		{'B', {"##.", "#.#", "##.", "#.#", "##."}},
+		{'C', {".##", "#..", "#..", "#..", ".##"}},
+		{'D', {"##.", "#.#", "#.#", "#.#", "##."}},
+		{'E', {"###", "#..", "##.", "#..", "###"}},
+		{'F', {"###", "#..", "##.", "#..", "#.."}},
+		{'G', {".##", "#..", "#.#", "#.#", ".##"}},
+		{'K', {"#.#", "#.#", "##.", "#.#", "#.#"}},
+		{'L', {"#..", "#..", "#..", "#..", "###"}},
+		{'M', {"#.#", "###", "###", "#.#", "#.#"}},
+		{'O', {".#.", "#.#", "#.#", "#.#", ".#."}},
+		{'P', {"##.", "#.#", "##.", "#..", "#.."}},
+		{'R', {"##.", "#.#", "##.", "#.#", "#.#"}},
+		{'S', {".##", "#..", ".#.", "..#", "##."}},
+		{'T', {"###", ".#.", ".#.", ".#.", ".#."}},
+		{'U', {"#.#", "#.#", "#.#", "#.#", "###"}},
+		{'V', {"#.#", "#.#", "#.#", "#.#", ".#."}},
+		{'W', {"#.#", "#.#", "###", "###", "#.#"}},
+		{'X', {"#.#", "#.#", ".#.", "#.#", "#.#"}},
+	};
+
+	//glyphs are stored enlarged, so linear filtering only softens their edges:
+	constexpr uint32_t GlyphScale = 4;
+
+	std::string glyph_sprite(char c) {
+		return std::string("hud-font-") + c;
+	}
+}
+
+void PerfHUD::add_font(TextureAtlas &atlas) {
+	glm::uvec2 size(3 * GlyphScale, 5 * GlyphScale);
+	std::vector< glm::u8vec4 > image(size.x * size.y);
+	for (Glyph const &glyph : Font) {
+		for (uint32_t y = 0; y < size.y; ++y) {
+			//image has a lower-left origin, font rows are listed top first:
+			char const *row = glyph.rows[4 - y / GlyphScale];
+			for (uint32_t x = 0; x < size.x; ++x) {
+				bool lit = (row[x / GlyphScale] == '#');
+				image[y * size.x + x] = glm::u8vec4(0xff, 0xff, 0xff, lit ? 0xff : 0x00);
+			}
+		}
+		if (!atlas.add(glyph_sprite(glyph.c), size, image.data())) {
+			throw std::runtime_error("No room in atlas for HUD font.");
+		}
+	}
+}
+
+void PerfHUD::push(Frame const &frame) {
+	history[next] = frame;
+	next = (next + 1) % History;
+	count = std::min(count + 1, History);
+}
+
+void PerfHUD::build(TextureAtlas const &atlas, glm::uvec2 const &drawable_size, EmitFn const &emit) const {
+	if (!visible || drawable_size.x == 0 || drawable_size.y == 0) return;
+
+	TextureAtlas::Sprite const &white = atlas.lookup("white");
+
+	//layout is done in whole screen pixels (origin at upper left, y down), one font pixel = 'px' screen pixels:
+	float px = float(std::max(1U, drawable_size.y / 240));
+	glm::vec2 to_clip = glm::vec2(2.0f / drawable_size.x, -2.0f / drawable_size.y);
+	auto rect = [&](float x0, float y0, float x1, float y1, TextureAtlas::Sprite const &sprite, glm::u8vec4 const &color) {
+		emit(glm::vec2(-1.0f, 1.0f) + glm::vec2(x0, y1) * to_clip, glm::vec2(-1.0f, 1.0f) + glm::vec2(x1, y0) * to_clip, sprite, color);
+	};
+
+	//---- contents ----
+	Frame const &frame = latest();
+	char lines[4][64];
+	uint32_t line_count = 3;
+	std::snprintf(lines[0], sizeof(lines[0]), "FRAME %.1f MS", frame.frame_ms);
+	std::snprintf(lines[1], sizeof(lines[1]), "UPD %.2f DRW %.2f GPU %.2f", frame.update_ms, frame.draw_ms, frame.gpu_ms);
+	std::snprintf(lines[2], sizeof(lines[2]), "CALLS %u VTX %u", frame.draw_calls, frame.vertices);
+	if (frame.allocations_tracked) {
+		std::snprintf(lines[3], sizeof(lines[3]), "ALLOC %llu %.1f KB", (unsigned long long)frame.allocations, frame.allocated_bytes / 1024.0);
+		line_count = 4;
+	}
+
+	float const margin = 4.0f * px;
+	float const advance = 4.0f * px; //glyph width plus one pixel of spacing
+	float const line_height = 7.0f * px;
+	float const graph_height = 40.0f * px;
+	float const bar_width = px;
+
+	size_t longest = 0;
+	for (uint32_t l = 0; l < line_count; ++l) {
+		longest = std::max(longest, std::string(lines[l]).size());
+	}
+	float width = std::max(longest * advance, History * bar_width) + 2.0f * margin;
+	float height = line_count * line_height + graph_height + 3.0f * margin;
+
+	//backdrop:
+	rect(0.0f, 0.0f, width, height, white, glm::u8vec4(0x00, 0x00, 0x00, 0xb0));
+
+	//text:
+	float y = margin;
+	for (uint32_t l = 0; l < line_count; ++l) {
+		float x = margin;
+		for (char const *c = lines[l]; *c; ++c) {
+			if (*c != ' ') {
+				auto f = atlas.sprites.find(glyph_sprite(*c));
+				if (f != atlas.sprites.end()) {
+					rect(x, y, x + 3.0f * px, y + 5.0f * px, f->second, glm::u8vec4(0xff, 0xff, 0xff, 0xff));
+				}
+			}
+			x += advance;
+		}
+		y += line_height;
+	}
+
+	//graph of frame times, oldest on the left; each bar is update (bottom), draw, then everything else:
+	// (in colors that are neither player's trail color, so they can never be counted as turf)
+	float graph_top = y + margin;
+	float graph_bottom = graph_top + graph_height;
+	float ms_to_px = graph_height / graph_ms;
+	auto clamp_y = [&](float bar_y) { return std::max(graph_top, bar_y); };
+	float x = margin + (History - count) * bar_width;
+	for (uint32_t i = 0; i < count; ++i) {
+		Frame const &f = history[(next + History - count + i) % History];
+		float update_top = clamp_y(graph_bottom - f.update_ms * ms_to_px);
+		float draw_top = clamp_y(update_top - f.draw_ms * ms_to_px);
+		float frame_top = clamp_y(graph_bottom - f.frame_ms * ms_to_px);
+		rect(x, update_top, x + bar_width, graph_bottom, white, glm::u8vec4(0x30, 0xd0, 0x90, 0xff));
+		rect(x, draw_top, x + bar_width, update_top, white, glm::u8vec4(0xb0, 0x70, 0xff, 0xff));
+		if (frame_top < draw_top) {
+			//a frame over budget is drawn in a warning color:
+			glm::u8vec4 color = (f.frame_ms > 1000.0f / 60.0f + 1.0f ? glm::u8vec4(0xff, 0xc0, 0x00, 0xff) : glm::u8vec4(0x80, 0x80, 0x80, 0xff));
+			rect(x, frame_top, x + bar_width, draw_top, white, color);
+		}
+		x += bar_width;
+	}
+	//60Hz budget line:
+	float budget_y = graph_bottom - (1000.0f / 60.0f) * ms_to_px;
+	rect(margin, budget_y, margin + History * bar_width, budget_y + std::max(1.0f, 0.5f * px), white, glm::u8vec4(0x40, 0xff, 0x40, 0xc0));
+}
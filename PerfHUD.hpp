@@ -0,0 +1,57 @@
+#pragma once
+
+#include "TextureAtlas.hpp"
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+
+/*
+ * PerfHUD is a toggleable performance overlay: a few lines of numbers about the latest frame
+ *  plus a graph of recent frame times (split into update / draw / other).
+ *
+ * It doesn't draw anything itself: build() emits clip-space rectangles textured with sprites from
+ *  the caller's atlas (its font is added with add_font), so the caller can batch the overlay
+ *  into the same vertex buffer (and texture) as the rest of the frame.
+ */
+
+struct PerfHUD {
+	//add the HUD's font glyphs (sprites named "hud-font-<char>") to an atlas; throws if they don't fit:
+	static void add_font(TextureAtlas &atlas);
+
+	struct Frame {
+		float frame_ms = 0.0f; //start-of-draw to start-of-draw
+		float update_ms = 0.0f;
+		float draw_ms = 0.0f; //CPU time in draw()
+		float gpu_ms = 0.0f;
+		uint32_t draw_calls = 0;
+		uint32_t vertices = 0;
+		//heap allocations (only shown if tracked; see AllocTracker.hpp):
+		bool allocations_tracked = false;
+		uint64_t allocations = 0;
+		uint64_t allocated_bytes = 0;
+	};
+
+	//record a frame's measurements in the history:
+	void push(Frame const &frame);
+
+	//emit the overlay as clip-space rectangles (min, max corners) sampling 'sprite' tinted by 'color';
+	// font pixels are sized to stay crisp and legible at 'drawable_size':
+	using EmitFn = std::function< void(glm::vec2 const &min, glm::vec2 const &max, TextureAtlas::Sprite const &sprite, glm::u8vec4 const &color) >;
+	void build(TextureAtlas const &atlas, glm::uvec2 const &drawable_size, EmitFn const &emit) const;
+
+	bool visible = false;
+
+	//frame time that fills the graph's height:
+	float graph_ms = 33.3f;
+
+	//----- history (ring buffer, 'next' is the oldest entry) -----
+	static constexpr uint32_t History = 120;
+	std::array< Frame, History > history;
+	uint32_t next = 0;
+	uint32_t count = 0; //frames recorded, up to History
+
+	Frame const &latest() const { return history[(next + History - 1) % History]; }
+};
@@ -2,108 +2,100 @@
 
 //for the GL_ERRORS() macro:
 #include "gl_errors.hpp"
+#include "CPUProfiler.hpp"
+#include "AllocTracker.hpp"
+#include "load_save_png.hpp"
 
-//for glm::value_ptr() :
-#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <fstream>
 #include <iostream>
-#include <random>
+#include <stdexcept>
 using namespace std;
 
-PongMode::PongMode() {
-
-	Ball *b = new Ball();
-	b->ball = glm::vec2(0.0f, 0.0f);
-	b->ball_velocity = glm::vec2(-1.0f, 0.0f);
-	b->ball_radius = glm::vec2(0.2f, 0.2f);
-	b->alive = 0.0;
-	b->trail_color = (glm::u8vec4((0x000000ff >> 24) & 0xff, (0x000000ff >> 16) & 0xff, (0x000000ff >> 8) & 0xff, (0x000000ff) & 0xff ));
-	balls.push_back(b);
-
-	//set up trail as if ball has been here for 'forever':
-	balls[0]->ball_trail.clear();
-	balls[0]->ball_trail.emplace_back(balls[0]->ball, trail_length);
-	balls[0]->ball_trail.emplace_back(balls[0]->ball, 0.0f);
-	
+PongMode::PongMode(Scenario const &scenario) : PongSim(scenario) {
 	//----- allocate OpenGL resources -----
-	{ //vertex buffer:
-		glGenBuffers(1, &vertex_buffer);
-		//for now, buffer will be un-filled.
-
-		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
-	}
-
-	{ //vertex array mapping buffer for color_texture_program:
-		//ask OpenGL to fill vertex_buffer_for_color_texture_program with the name of an unused vertex array object:
-		glGenVertexArrays(1, &vertex_buffer_for_color_texture_program);
-
-		//set vertex_buffer_for_color_texture_program as the current vertex array object:
-		glBindVertexArray(vertex_buffer_for_color_texture_program);
-
-		//set vertex_buffer as the source of glVertexAttribPointer() commands:
-		glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-
-		//set up the vertex array object to describe arrays of PongMode::Vertex:
-		glVertexAttribPointer(
-			color_texture_program.Position_vec4, //attribute
-			3, //size
-			GL_FLOAT, //type
-			GL_FALSE, //normalized
-			sizeof(Vertex), //stride
-			(GLbyte *)0 + 0 //offset
-		);
-		glEnableVertexAttribArray(color_texture_program.Position_vec4);
-		//[Note that it is okay to bind a vec3 input to a vec4 attribute -- the w component will be filled with 1.0 automatically]
-
-		glVertexAttribPointer(
-			color_texture_program.Color_vec4, //attribute
-			4, //size
-			GL_UNSIGNED_BYTE, //type
-			GL_TRUE, //normalized
-			sizeof(Vertex), //stride
-			(GLbyte *)0 + 4*3 //offset
-		);
-		glEnableVertexAttribArray(color_texture_program.Color_vec4);
-
-		glVertexAttribPointer(
-			color_texture_program.TexCoord_vec2, //attribute
-			2, //size
-			GL_FLOAT, //type
-			GL_FALSE, //normalized
-			sizeof(Vertex), //stride
-			(GLbyte *)0 + 4*3 + 4*1 //offset
-		);
-		glEnableVertexAttribArray(color_texture_program.TexCoord_vec2);
+	{ //vertex array mapping buffer for color_texture_program, one for each frame slot's vertex buffer:
+		//ask OpenGL to fill vertex_buffer_for_color_texture_program with the names of unused vertex array objects:
+		vertex_buffer_for_color_texture_program.assign(frames.frames.size(), 0);
+		glGenVertexArrays(GLsizei(vertex_buffer_for_color_texture_program.size()), vertex_buffer_for_color_texture_program.data());
+
+		for (uint32_t f = 0; f < frames.frames.size(); ++f) {
+			//set vertex_buffer_for_color_texture_program[f] as the current vertex array object:
+			glBindVertexArray(vertex_buffer_for_color_texture_program[f]);
+
+			//set the slot's vertex_buffer as the source of glVertexAttribPointer() commands:
+			glBindBuffer(GL_ARRAY_BUFFER, frames.frames[f].vertex_buffer);
+
+			//set up the vertex array object to describe arrays of PongMode::Vertex:
+			glVertexAttribPointer(
+				color_texture_program.Position_vec4, //attribute
+				3, //size
+				GL_FLOAT, //type
+				GL_FALSE, //normalized
+				sizeof(Vertex), //stride
+				(GLbyte *)0 + 0 //offset
+			);
+			glEnableVertexAttribArray(color_texture_program.Position_vec4);
+			//[Note that it is okay to bind a vec3 input to a vec4 attribute -- the w component will be filled with 1.0 automatically]
+
+			glVertexAttribPointer(
+				color_texture_program.Color_vec4, //attribute
+				4, //size
+				GL_UNSIGNED_BYTE, //type
+				GL_TRUE, //normalized
+				sizeof(Vertex), //stride
+				(GLbyte *)0 + 4*3 //offset
+			);
+			glEnableVertexAttribArray(color_texture_program.Color_vec4);
+
+			glVertexAttribPointer(
+				color_texture_program.TexCoord_vec2, //attribute
+				2, //size
+				GL_FLOAT, //type
+				GL_FALSE, //normalized
+				sizeof(Vertex), //stride
+				(GLbyte *)0 + 4*3 + 4*1 //offset
+			);
+			glEnableVertexAttribArray(color_texture_program.TexCoord_vec2);
+		}
 
-		//done referring to vertex_buffer, so unbind it:
+		//done referring to vertex buffers, so unbind:
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-		//done setting up vertex array object, so unbind it:
+		//done setting up vertex array objects, so unbind:
 		glBindVertexArray(0);
 
 		GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
 	}
 
-	{ //solid white texture:
-		//ask OpenGL to fill white_tex with the name of an unused texture object:
-		glGenTextures(1, &white_tex);
+	{ //sprite atlas:
+		//solid white sprite for plain colored rectangles:
+		std::vector< glm::u8vec4 > white(1, glm::u8vec4(0xff, 0xff, 0xff, 0xff));
+		atlas.add("white", glm::uvec2(1,1), white.data());
+
+		//glyphs for the performance overlay:
+		PerfHUD::add_font(atlas);
+
+		sprites.white = atlas.lookup("white");
+		//(until a skin says otherwise)
+		sprites.ball = sprites.white;
+		sprites.paddle = sprites.white;
+
+		//ask OpenGL to fill atlas_tex with the name of an unused texture object:
+		glGenTextures(1, &atlas_tex);
 
 		//bind that texture object as a GL_TEXTURE_2D-type texture:
-		glBindTexture(GL_TEXTURE_2D, white_tex);
+		glBindTexture(GL_TEXTURE_2D, atlas_tex);
 
-		//upload a 1x1 image of solid white to the texture:
-		glm::uvec2 size = glm::uvec2(1,1);
-		std::vector< glm::u8vec4 > data(size.x*size.y, glm::u8vec4(0xff, 0xff, 0xff, 0xff));
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+		//upload the packed atlas image to the texture:
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas.size.x, atlas.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlas.pixels.data());
 
 		//set filtering and wrapping parameters:
-		//(it's a bit silly to mipmap a 1x1 texture, but I'm doing it because you may want to use this code to load different sizes of texture)
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		//(no mipmaps -- lower mip levels would blend neighboring sprites together)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-		//since texture uses a mipmap and we haven't uploaded one, instruct opengl to make one for us:
-		glGenerateMipmap(GL_TEXTURE_2D);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
 		//Okay, texture uploaded, can unbind it:
 		glBindTexture(GL_TEXTURE_2D, 0);
@@ -113,315 +105,218 @@ PongMode::PongMode() {
 }
 
 PongMode::~PongMode() {
+	if (recorder) recorder->finish(*this);
+
+	//(stop decoding before the atlas goes away)
+	skin_loader.reset();
 
 	//----- free OpenGL resources -----
-	glDeleteBuffers(1, &vertex_buffer);
-	vertex_buffer = 0;
+	glDeleteVertexArrays(GLsizei(vertex_buffer_for_color_texture_program.size()), vertex_buffer_for_color_texture_program.data());
+	vertex_buffer_for_color_texture_program.clear();
 
-	glDeleteVertexArrays(1, &vertex_buffer_for_color_texture_program);
-	vertex_buffer_for_color_texture_program = 0;
+	glDeleteTextures(1, &atlas_tex);
+	atlas_tex = 0;
 
-	glDeleteTextures(1, &white_tex);
-	white_tex = 0;
+	glDeleteFramebuffers(1, &turf_framebuffer);
+	turf_framebuffer = 0;
+	glDeleteTextures(1, &turf_tex);
+	turf_tex = 0;
 }
 
-bool PongMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size) {
-
-	if (evt.type == SDL_MOUSEMOTION) {
-		//convert mouse from window pixels (top-left origin, +y is down) to clip space ([-1,1]x[-1,1], +y is up):
-		glm::vec2 clip_mouse = glm::vec2(
-			(evt.motion.x + 0.5f) / window_size.x * 2.0f - 1.0f,
-			(evt.motion.y + 0.5f) / window_size.y *-2.0f + 1.0f
-		);
-		left_paddle.y = (clip_to_court * glm::vec3(clip_mouse, 1.0f)).y;
-	}
-
-	return false;
-}
+void PongMode::resize_turf(glm::uvec2 const &size) {
+	GLuint old_framebuffer = turf_framebuffer;
+	GLuint old_tex = turf_tex;
+	glm::uvec2 old_size = turf_size;
+
+	//color texture to paint the turf into:
+	glGenTextures(1, &turf_tex);
+	glBindTexture(GL_TEXTURE_2D, turf_tex);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
 
-void PongMode::newBall() {
-	float lo = 0.03f;
-	float hi = 0.1f;
-	float r = lo + static_cast <float> (rand()) / (static_cast <float> (RAND_MAX/(hi-lo)));
-	Ball *b = new Ball();
-	if (rand() % 2 == 1) {
-		b->ball_radius = glm::vec2(0.2f + r, 0.2f + r);
-	} else {
-		b->ball_radius = glm::vec2(0.2f - r, 0.2f - r);
+	//...and a framebuffer to draw into it with:
+	glGenFramebuffers(1, &turf_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, turf_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, turf_tex, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		throw std::runtime_error("Turf framebuffer is incomplete.");
 	}
-	int rint = rand();
-	if (rint % 2 == 1) {
-		b->ball_velocity = glm::vec2(-1.0f, 0.0f);
-		b->trail_color = player1_trail;
+	turf_size = size;
+
+	if (old_framebuffer) {
+		//carry over the turf painted so far:
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, old_framebuffer);
+		glBlitFramebuffer(0, 0, old_size.x, old_size.y, 0, 0, size.x, size.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glDeleteFramebuffers(1, &old_framebuffer);
+		glDeleteTextures(1, &old_tex);
 	} else {
-		b->ball_velocity = glm::vec2(1.0f, 0.0f);
-		b->trail_color = player2_trail;
+		//(a new turf starts out blank)
+		clear_turf = true;
 	}
-	b->ball = glm::vec2(0.0f, 0.0f);
-	b->ball_trail.clear();
-	b->ball_trail.emplace_back(b->ball, trail_length);
-	b->ball_trail.emplace_back(b->ball, 0.0f);
-	
-	balls.push_back(b);
-}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-void PongMode::update(float elapsed) {
+	GL_ERRORS(); //PARANOIA: print out any OpenGL errors that may have happened
+}
 
-	static std::mt19937 mt; //mersenne twister pseudo-random number generator
+void PongMode::load_skin(std::string const &path) {
+	static char const * const names[] = {"ball", "paddle"};
 
-	time += elapsed;
-	if (time > threshold && balls.size() < 6) {
-		newBall();
-		threshold += 6.0f;
+	std::string dir = path;
+	if (path.size() >= 4 && path.substr(path.size() - 4) == ".pak") {
+		skin_archive.reset(new AssetArchive(path));
+		dir = "";
 	}
+	skin_loader.reset(new AssetLoader());
+	skin_loader->archive = skin_archive.get();
+	for (char const *name : names) {
+		std::string filename = (dir.empty() ? "" : dir + "/") + name + ".png";
+		//(skins needn't have every sprite)
+		bool found = (skin_archive ? bool(skin_archive->find(filename)) : bool(std::ifstream(filename, std::ios::binary)));
+		if (found) skin_loader->load_sprite(&atlas, atlas_tex, name, filename);
+	}
+}
 
-	//----- paddle update -----
+bool PongMode::handle_event(SDL_Event const &evt, glm::uvec2 const &window_size) {
 
-	{ //right player ai:
-		ai_offset_update -= elapsed;
-		if (ai_offset_update < elapsed) {
-			//update again in [0.5,1.0) seconds:
-			ai_offset_update = (mt() / float(mt.max())) * 0.5f + 0.5f;
-			ai_offset = (mt() / float(mt.max())) * 2.5f - 1.25f;
-		}
-		int closest = 0;
-		double dist = INT_MAX;
-		for(int i = 0; i < balls.size(); i++) {
-			if (balls[i]->ball_velocity.x > 0 && balls[i]->trail_color == player1_trail) {
-				double newDist = sqrt(std::pow(right_paddle.x - balls[i]->ball.x, 2) + std::pow(right_paddle.y - balls[i]->ball.y, 2) * 1.0);
-				if (newDist < dist) {
-					dist = newDist;
-					closest = i;
-				}
-			}
-		}
-		if (right_paddle.y < balls[closest]->ball.y + ai_offset) {
-				right_paddle.y = std::min(balls[closest]->ball.y + ai_offset, right_paddle.y + 10.0f * elapsed);
-			} else {
-				right_paddle.y = std::max(balls[closest]->ball.y + ai_offset, right_paddle.y - 10.0f * elapsed);
+	if (player && evt.type == SDL_KEYDOWN) {
+		//replay playback controls:
+		if (evt.key.keysym.sym == SDLK_SPACE) {
+			player->speed = (player->speed == ReplayPlayer::Paused ? ReplayPlayer::Realtime : ReplayPlayer::Paused);
+			player->banked = 0.0f;
+			return true;
+		} else if (evt.key.keysym.sym == SDLK_RIGHT) {
+			player->speed = ReplayPlayer::Paused;
+			player->step(*this);
+			return true;
+		} else if (evt.key.keysym.sym == SDLK_LEFT) {
+			player->speed = ReplayPlayer::Paused;
+			if (player->next > 0) player->seek(*this, player->next - 1);
+			clear_turf = true;
+			replay_seeked = true;
+			return true;
+		} else if (evt.key.keysym.sym == SDLK_LEFTBRACKET || evt.key.keysym.sym == SDLK_RIGHTBRACKET) {
+			player->skip(*this, evt.key.keysym.sym == SDLK_LEFTBRACKET ? -5.0f : 5.0f);
+			clear_turf = true;
+			replay_seeked = true;
+			return true;
+		} else if (evt.key.keysym.sym == SDLK_TAB) {
+			player->speed = (player->speed == ReplayPlayer::MaxSpeed ? ReplayPlayer::Realtime : ReplayPlayer::MaxSpeed);
+			player->banked = 0.0f;
+			return true;
 		}
 	}
 
-	//clamp paddles to court:
-	right_paddle.y = std::max(right_paddle.y, -court_radius.y + paddle_radius.y);
-	right_paddle.y = std::min(right_paddle.y,  court_radius.y - paddle_radius.y);
-
-	left_paddle.y = std::max(left_paddle.y, -court_radius.y + paddle_radius.y);
-	left_paddle.y = std::min(left_paddle.y,  court_radius.y - paddle_radius.y);
-
-	//----- ball update -----
-	float speed_mult;
-	for (int i = 0; i < balls.size(); i++) {
-		balls[i]->alive += elapsed;
-		speed_mult = 4.0f * std::pow(2.0f, balls[i]->alive / 5.0f);
-		speed_mult = std::min(speed_mult, 10.0f);
-		balls[i]->ball += elapsed * speed_mult * balls[i]->ball_velocity;
+	if (evt.type == SDL_MOUSEMOTION && (net || rollback || (left_script.kind == PaddleScript::Player && !player))) {
+		//convert mouse from window pixels (top-left origin, +y is down) to clip space ([-1,1]x[-1,1], +y is up):
+		glm::vec2 clip_mouse = glm::vec2(
+			(evt.motion.x + 0.5f) / window_size.x * 2.0f - 1.0f,
+			(evt.motion.y + 0.5f) / window_size.y *-2.0f + 1.0f
+		);
+		float y = (clip_to_court * glm::vec3(clip_mouse, 1.0f)).y;
+		if (net || rollback) net_paddle_y = y;
+		else left_paddle.y = y;
+	} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F3) {
+		hud.visible = !hud.visible;
+		return true;
+	} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_PRINTSCREEN) {
+		screenshot_requested = true;
+		return true;
+	} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F8) {
+		profile_court_passes = !profile_court_passes;
+		std::cout << (profile_court_passes ? "Timing" : "Not timing") << " trails and solids separately." << std::endl;
+		return true;
+	} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F9) {
+		//dump GPU pass timings:
+		std::string filename = "gpu-profile.tsv";
+		gpu_profiler.report(std::cout);
+		std::cout << "Saving GPU profile to '" << filename << "'." << std::endl;
+		gpu_profiler.dump(filename);
+		return true;
 	}
 
-	//---- collision handling ----
-
-	//paddles:
-	auto paddle_vs_ball = [this](glm::vec2 const &paddle, Ball *ball) {
-		//compute area of overlap:
-		glm::u8vec4 new_color;
-		if (paddle.x == -court_radius.x + 0.5f) {
-			new_color = player1_trail;
-		} else if (paddle.x == court_radius.x - 0.5f) {
-			new_color = player2_trail;
-		}
-		glm::vec2 min = glm::max(paddle - paddle_radius, ball->ball - ball->ball_radius);
-		glm::vec2 max = glm::min(paddle + paddle_radius, ball->ball + ball->ball_radius);
-		//if no overlap, no collision:
-		if (min.x > max.x || min.y > max.y)  {
-			return;
-		}
-
-		if (max.x - min.x > max.y - min.y) {
-			//wider overlap in x => bounce in y direction:
-			if (ball->ball.y > paddle.y) {
-				ball->ball.y = paddle.y + paddle_radius.y + ball->ball_radius.y;
-				ball->ball_velocity.y = std::abs(ball->ball_velocity.y);
-			} else {
-				ball->ball.y = paddle.y - paddle_radius.y - ball->ball_radius.y;
-				ball->ball_velocity.y = -std::abs(ball->ball_velocity.y);
-			}
-			ball->trail_color = new_color;
-		} else {
-			//wider overlap in y => bounce in x direction:
-			if (ball->ball.x > paddle.x) {
-				ball->ball.x = paddle.x + paddle_radius.x + ball->ball_radius.x;
-				ball->ball_velocity.x = std::abs(ball->ball_velocity.x);
-			} else {
-				ball->ball.x = paddle.x - paddle_radius.x - ball->ball_radius.x;
-				ball->ball_velocity.x = -std::abs(ball->ball_velocity.x);
-			}
-			//warp y velocity based on offset from paddle center:
-			float vel = (ball->ball.y - paddle.y) / (paddle_radius.y + ball->ball_radius.y);
-			ball->ball_velocity.y = glm::mix(ball->ball_velocity.y, vel, 0.75f);
-			ball->trail_color = new_color;
-		}
-		
-	};
-	
-	for (int i = 0; i < balls.size(); i ++) {
-		paddle_vs_ball(left_paddle, balls[i]);
-		paddle_vs_ball(right_paddle, balls[i]);
-	}
-	
-	//court walls:
-	for (int i = 0; i < balls.size(); i++) {
-		if (balls[i]->ball.y > court_radius.y - balls[i]->ball_radius.y) {
-			balls[i]->ball.y = court_radius.y - balls[i]->ball_radius.y;
-			if (balls[i]->ball_velocity.y > 0.0f) {
-				balls[i]->ball_velocity.y = -balls[i]->ball_velocity.y;
-			}
-		}
-		if (balls[i]->ball.y < -court_radius.y + balls[i]->ball_radius.y) {
-			balls[i]->ball.y = -court_radius.y + balls[i]->ball_radius.y;
-			if (balls[i]->ball_velocity.y < 0.0f) {
-				balls[i]->ball_velocity.y = -balls[i]->ball_velocity.y;
-			}
-		}
+	return false;
+}
 
-		if (balls[i]->ball.x > court_radius.x - balls[i]->ball_radius.x) {
-			balls[i]->ball.x = court_radius.x - balls[i]->ball_radius.x;
-			if (balls[i]->ball_velocity.x > 0.0f) {
-				balls[i]->ball_velocity.x = -balls[i]->ball_velocity.x;
-			}
-		}
-		if (balls[i]->ball.x < -court_radius.x + balls[i]->ball_radius.x) {
-			balls[i]->ball.x = -court_radius.x + balls[i]->ball_radius.x;
-			if (balls[i]->ball_velocity.x < 0.0f) {
-				balls[i]->ball_velocity.x = -balls[i]->ball_velocity.x;
+void PongMode::update(float elapsed) {
+	auto update_start = std::chrono::steady_clock::now();
+
+	if (net) {
+		net->send_input(net_paddle_y);
+		net->poll();
+		net->view.apply(this);
+		//(our own paddle follows the mouse right away, rather than a round trip later)
+		if (net->side == 1) left_paddle.y = net_paddle_y;
+		if (net->side == 2) right_paddle.y = net_paddle_y;
+		update_trails(elapsed);
+	} else if (rollback) {
+		rollback->advance(elapsed, net_paddle_y);
+	} else if (player) {
+		player->advance(*this, elapsed);
+		//score the turf once the replay has played to its end (see 'replay_seeked'):
+		if (player->done() && player->replay.has_end && !replay_scored) {
+			if (replay_seeked) {
+				std::cout << "Replay turf not scored: it was cleared by seeking, so it doesn't hold the whole game." << std::endl;
+				replay_scored = true;
+			} else if (turf_score.ready) {
+				float pixels = float(std::max(1U, turf_score.size.x * turf_score.size.y));
+				std::cout << "Replay turf: Player 1 " << turf_score.player1 / pixels << ", Player 2 " << turf_score.player2 / pixels << "." << std::endl;
+				replay_scored = true;
+			} else if (!turf_score.requested && !turf_score.pending) {
+				turf_score.requested = true;
 			}
 		}
+	} else {
+		if (recorder) recorder->step(elapsed, *this);
+		PongSim::update(elapsed);
 	}
 
-	//----- rainbow trails -----
-
-	//age up all locations in ball trail:
-	for (int i = 0; i < balls.size(); i++) {
-		for (auto &t : balls[i]->ball_trail) {
-			t.z += elapsed;
-		}
-		//store fresh location at back of ball trail:
-		balls[i]->ball_trail.emplace_back(balls[i]->ball, 0.0f);
-
-		//trim any too-old locations from back of trail:
-		//NOTE: since trail drawing interpolates between points, only removes back element if second-to-back element is too old:
-		while (balls[i]->ball_trail.size() >= 2 && balls[i]->ball_trail[1].z > trail_length) {
-			balls[i]->ball_trail.pop_front();
-		}
-	}
+	last_update_ms = std::chrono::duration< float, std::milli >(std::chrono::steady_clock::now() - update_start).count();
 }
 
 void PongMode::draw(glm::uvec2 const &drawable_size) {
+	auto draw_start = std::chrono::steady_clock::now();
+	PerfHUD::Frame hud_frame;
+	hud_frame.frame_ms = std::chrono::duration< float, std::milli >(draw_start - last_draw_start).count();
+	hud_frame.update_ms = last_update_ms;
+	last_draw_start = draw_start;
+
 	//some nice colors from the course web page:
 	#define HEX_TO_U8VEC4( HX ) (glm::u8vec4( (HX >> 24) & 0xff, (HX >> 16) & 0xff, (HX >> 8) & 0xff, (HX) & 0xff ))
 	const glm::u8vec4 bg_color = HEX_TO_U8VEC4(0x171714ff);
-	const glm::u8vec4 fg_color = HEX_TO_U8VEC4(0xffffffff);
-	const glm::u8vec4 shadow_color = HEX_TO_U8VEC4(0x604d29ff);
-	const glm::u8vec4 player1_color = HEX_TO_U8VEC4(0x008DECff);
-	const glm::u8vec4 player2_color = HEX_TO_U8VEC4(0xEC0040ff);
-	const std::vector< glm::u8vec4 > rainbow_colors = {
-		HEX_TO_U8VEC4(0x604d29ff), HEX_TO_U8VEC4(0x624f29fc), HEX_TO_U8VEC4(0x69542df2),
-		HEX_TO_U8VEC4(0x6a552df1), HEX_TO_U8VEC4(0x6b562ef0), HEX_TO_U8VEC4(0x6b562ef0),
-		HEX_TO_U8VEC4(0x6d572eed), HEX_TO_U8VEC4(0x6f592feb), HEX_TO_U8VEC4(0x725b31e7),
-		HEX_TO_U8VEC4(0x745d31e3), HEX_TO_U8VEC4(0x755e32e0), HEX_TO_U8VEC4(0x765f33de),
-		HEX_TO_U8VEC4(0x7a6234d8), HEX_TO_U8VEC4(0x826838ca), HEX_TO_U8VEC4(0x977840a4),
-		HEX_TO_U8VEC4(0x96773fa5), HEX_TO_U8VEC4(0xa07f4493), HEX_TO_U8VEC4(0xa1814590),
-		HEX_TO_U8VEC4(0x9e7e4496), HEX_TO_U8VEC4(0xa6844887), HEX_TO_U8VEC4(0xa9864884),
-		HEX_TO_U8VEC4(0xad8a4a7c),
-	};
 	#undef HEX_TO_U8VEC4
 
 	//other useful drawing constants:
-	const float wall_radius = 0.05f;
-	const float shadow_offset = 0.07f;
 	const float padding = 0.14f; //padding between outside of walls and edge of window
 
-	//---- compute vertices to draw ----
-
-	//vertices will be accumulated into this list and then uploaded+drawn at the end of this function:
-	std::vector< Vertex > vertices;
-
-	//inline helper function for rectangle drawing:
-	auto draw_rectangle = [&vertices](glm::vec2 const &center, glm::vec2 const &radius, glm::u8vec4 const &color) {
-		//draw rectangle as two CCW-oriented triangles:
-		vertices.emplace_back(glm::vec3(center.x-radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(center.x+radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(center.x+radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-
-		vertices.emplace_back(glm::vec3(center.x-radius.x, center.y-radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(center.x+radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-		vertices.emplace_back(glm::vec3(center.x-radius.x, center.y+radius.y, 0.0f), color, glm::vec2(0.5f, 0.5f));
-	};
-
-	//shadows for everything (except the trail):
-
-	glm::vec2 s = glm::vec2(0.0f,-shadow_offset);
-
-	/*
-	draw_rectangle(glm::vec2(-court_radius.x-wall_radius, 0.0f)+s, glm::vec2(wall_radius, court_radius.y + 2.0f * wall_radius), shadow_color);
-	draw_rectangle(glm::vec2( court_radius.x+wall_radius, 0.0f)+s, glm::vec2(wall_radius, court_radius.y + 2.0f * wall_radius), shadow_color);
-	draw_rectangle(glm::vec2( 0.0f,-court_radius.y-wall_radius)+s, glm::vec2(court_radius.x, wall_radius), shadow_color);
-	draw_rectangle(glm::vec2( 0.0f, court_radius.y+wall_radius)+s, glm::vec2(court_radius.x, wall_radius), shadow_color);
-	draw_rectangle(left_paddle+s, paddle_radius, shadow_color);
-	draw_rectangle(right_paddle+s, paddle_radius, shadow_color);
-	draw_rectangle(ball+s, ball_radius, shadow_color);
-	*/
-	
-	//ball's trail:
-	for (int j = 0; j < balls.size(); j++) {
-		if (balls[j]->ball_trail.size() >= 2) {
-			//start ti at second element so there is always something before it to interpolate from:
-			std::deque< glm::vec3 >::iterator ti = balls[j]->ball_trail.begin() + 1;
-			//draw trail from oldest-to-newest:
-			for (uint32_t i = uint32_t(rainbow_colors.size())-1; i < rainbow_colors.size(); --i) {
-				//time at which to draw the trail element:
-				float t = (i + 1) / float(rainbow_colors.size()) * trail_length;
-				//advance ti until 'just before' t:
-				while (ti != balls[j]->ball_trail.end() && ti->z > t) ++ti;
-				//if we ran out of tail, stop drawing:
-				if (ti == balls[j]->ball_trail.end()) break;
-				//interpolate between previous and current trail point to the correct time:
-				glm::vec3 a = *(ti-1);
-				glm::vec3 b = *(ti);
-				glm::vec2 at = (t - a.z) / (b.z - a.z) * (glm::vec2(b) - glm::vec2(a)) + glm::vec2(a);
-				//draw:
-				draw_rectangle(at, balls[j]->ball_radius, balls[j]->trail_color);
-				//draw_rectangle(at, ball_radius, rainbow_colors[7]);
-			}
+	//---- upload a few more skin sprites (if loading one) ----
+	if (skin_loader) {
+		if (skin_loader->upload(4) > 0) {
+			auto use = [this](char const *name, TextureAtlas::Sprite *sprite) {
+				auto f = atlas.sprites.find(name);
+				if (f != atlas.sprites.end()) *sprite = f->second;
+			};
+			use("ball", &sprites.ball);
+			use("paddle", &sprites.paddle);
+		}
+		if (skin_loader->done()) {
+			std::cout << "Skin loaded:\n";
+			skin_loader->report(std::cout);
+			skin_loader.reset();
+			skin_archive.reset();
 		}
-	}
-	//solid objects:
-
-	//walls:
-	draw_rectangle(glm::vec2(-court_radius.x-wall_radius, 0.0f), glm::vec2(wall_radius, court_radius.y + 2.0f * wall_radius), fg_color);
-	draw_rectangle(glm::vec2( court_radius.x+wall_radius, 0.0f), glm::vec2(wall_radius, court_radius.y + 2.0f * wall_radius), fg_color);
-	draw_rectangle(glm::vec2( 0.0f,-court_radius.y-wall_radius), glm::vec2(court_radius.x, wall_radius), fg_color);
-	draw_rectangle(glm::vec2( 0.0f, court_radius.y+wall_radius), glm::vec2(court_radius.x, wall_radius), fg_color);
-
-	//paddles:
-	draw_rectangle(left_paddle, paddle_radius, player1_color);
-	draw_rectangle(right_paddle, paddle_radius, player2_color);
-	
-
-	//ball:
-	for (int i = 0; i < balls.size(); i++) {
-		draw_rectangle(balls[i]->ball, balls[i]->ball_radius, fg_color);
-	}
-
-	//scores:
-	glm::vec2 score_radius = glm::vec2(0.1f, 0.1f);
-	for (uint32_t i = 0; i < left_score; ++i) {
-		draw_rectangle(glm::vec2( -court_radius.x + (2.0f + 3.0f * i) * score_radius.x, court_radius.y + 2.0f * wall_radius + 2.0f * score_radius.y), score_radius, fg_color);
-	}
-	for (uint32_t i = 0; i < right_score; ++i) {
-		draw_rectangle(glm::vec2( court_radius.x - (2.0f + 3.0f * i) * score_radius.x, court_radius.y + 2.0f * wall_radius + 2.0f * score_radius.y), score_radius, fg_color);
 	}
 
+	//---- compute vertices to draw ----
+	PROFILE_ZONE_NAMED(vertices_zone, "vertices");
 
+	//vertices will be accumulated into this list and then uploaded+drawn at the end of this function:
+	std::vector< Vertex > vertices;
+	//(trails come first, so they can be drawn -- and timed -- as a pass of their own; see profile_court_passes)
+	size_t trail_vertices = build_vertices(sprites, &vertices);
 
 	//------ compute court-to-window transform ------
 
@@ -464,7 +359,20 @@ void PongMode::draw(glm::uvec2 const &drawable_size) {
 		glm::vec2(center.x, center.y)
 	);
 
+	size_t court_vertices = vertices.size();
+
+	//performance overlay goes on top of everything, in the same vertex buffer (but drawn over the window, not the turf):
+	// (the HUD lays itself out in clip space, so map its rectangles back through clip_to_court)
+	hud.build(atlas, drawable_size, [&](glm::vec2 const &min, glm::vec2 const &max, TextureAtlas::Sprite const &sprite, glm::u8vec4 const &color) {
+		glm::vec2 court_min = clip_to_court * glm::vec3(min, 1.0f);
+		glm::vec2 court_max = clip_to_court * glm::vec3(max, 1.0f);
+		push_sprite(&vertices, 0.5f * (court_min + court_max), 0.5f * (court_max - court_min), sprite, color);
+	});
+
+	PROFILE_ZONE_END(vertices_zone);
+
 	//---- actual drawing ----
+	PROFILE_ZONE("submit");
 
 	/*
 	GL.Enable (EnableCap.ScissorTest);
@@ -473,6 +381,25 @@ void PongMode::draw(glm::uvec2 const &drawable_size) {
 	GL.Disable (EnableCap.ScissorTest);
 	*/
 
+	//wait (as late as possible) until the GPU is done with this frame slot's last use:
+	frames.begin_frame();
+
+	gpu_profiler.push("draw");
+
+	//the court is drawn into the turf:
+	//(a minimized window may have no pixels; the turf keeps its size until it has some again)
+	if (turf_size != drawable_size && drawable_size.x > 0 && drawable_size.y > 0) resize_turf(drawable_size);
+	glBindFramebuffer(GL_FRAMEBUFFER, turf_framebuffer);
+
+	gpu_profiler.push("clears");
+
+	//a new turf -- or, after a replay seek, one painted at a different moment -- starts from scratch:
+	if (clear_turf) {
+		clear_turf = false;
+		glClearColor(bg_color.r / 255.0f, bg_color.g / 255.0f, bg_color.b / 255.0f, bg_color.a / 255.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
 	float rightx = 597 / 640;
 	float paddleScale = 20 / 640;
 	float leftx = 30 / 640;
@@ -496,34 +423,103 @@ void PongMode::draw(glm::uvec2 const &drawable_size) {
 	glClear(GL_COLOR_BUFFER_BIT);
 	glDisable(GL_SCISSOR_TEST);
 
+	gpu_profiler.pop(); //clears
+
 	//use alpha blending:
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	//don't use the depth test:
 	glDisable(GL_DEPTH_TEST);
 
-	//upload vertices to vertex_buffer:
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer); //set vertex_buffer as current
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertices[0]), vertices.data(), GL_STREAM_DRAW); //upload vertices array
+	//upload vertices to this slot's vertex buffer:
+	frames.upload_vertices(vertices.data(), vertices.size() * sizeof(vertices[0]));
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	//set color_texture_program as current program:
-	glUseProgram(color_texture_program.program);
+	//upload this frame's OBJECT_TO_CLIP to the shared uniform buffer (once, however many programs read it):
+	frame_uniforms.data.OBJECT_TO_CLIP = court_to_clip;
+	frame_uniforms.upload();
+
+	drawn_vertices = uint32_t(vertices.size());
+	uploaded_bytes = vertices.size() * sizeof(vertices[0]) + sizeof(frame_uniforms.data);
 
-	//upload OBJECT_TO_CLIP to the proper uniform location:
-	glUniformMatrix4fv(color_texture_program.OBJECT_TO_CLIP_mat4, 1, GL_FALSE, glm::value_ptr(court_to_clip));
+	//set color_texture_program as current program (the first frame waits for it to finish linking):
+	glUseProgram(color_texture_program.get());
+	if (!programs_reported) {
+		programs_reported = true;
+		std::cout << "Shader programs:\n";
+		programs.report(std::cout);
+	}
 
-	//use the mapping vertex_buffer_for_color_texture_program to fetch vertex data:
-	glBindVertexArray(vertex_buffer_for_color_texture_program);
+	//use the mapping vertex_buffer_for_color_texture_program to fetch vertex data from this slot's buffer:
+	glBindVertexArray(vertex_buffer_for_color_texture_program[frames.current_index]);
 
-	//bind the solid white texture to location zero so things will be drawn just with their colors:
+	//bind the sprite atlas to location zero; solid shapes sample its white sprite:
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, white_tex);
+	glBindTexture(GL_TEXTURE_2D, atlas_tex);
 
 	//run the OpenGL pipeline:
-	glDrawArrays(GL_TRIANGLES, 0, GLsizei(vertices.size()));
+	//the court: trails, then solid objects over them, in one draw call (or, to time them separately, two):
+	if (profile_court_passes) {
+		{
+			GPUProfiler::Scope scope(gpu_profiler, "trails");
+			glDrawArrays(GL_TRIANGLES, 0, GLsizei(trail_vertices));
+			hud_frame.draw_calls += 1;
+		}
+		{
+			GPUProfiler::Scope scope(gpu_profiler, "solids");
+			glDrawArrays(GL_TRIANGLES, GLint(trail_vertices), GLsizei(court_vertices - trail_vertices));
+			hud_frame.draw_calls += 1;
+		}
+	} else {
+		GPUProfiler::Scope scope(gpu_profiler, "court");
+		glDrawArrays(GL_TRIANGLES, 0, GLsizei(court_vertices));
+		hud_frame.draw_calls += 1;
+	}
 
-	//unbind the solid white texture:
+	if (turf_score.requested) { //read back the turf, to score it:
+		turf_score.requested = false;
+		turf_score.pending = true;
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, turf_framebuffer);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		frames.read_pixels_async(glm::uvec2(0), turf_size, [this](glm::uvec2 const &size, glm::u8vec4 const *pixels) {
+			score_turf(pixels, size_t(size.x) * size.y, &turf_score.player1, &turf_score.player2);
+			turf_score.size = size;
+			turf_score.pending = false;
+			turf_score.ready = true;
+		});
+	}
+
+	{ //copy the turf to the window:
+		GPUProfiler::Scope scope(gpu_profiler, "present");
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, turf_framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		glBlitFramebuffer(0, 0, turf_size.x, turf_size.y, 0, 0, turf_size.x, turf_size.y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	if (vertices.size() > court_vertices) { //...and the HUD over it:
+		GPUProfiler::Scope scope(gpu_profiler, "hud");
+		glDrawArrays(GL_TRIANGLES, GLint(court_vertices), GLsizei(vertices.size() - court_vertices));
+		hud_frame.draw_calls += 1;
+	}
+
+	//read back the finished frame for a screenshot (a frame slot holds one readback, so this may wait a frame for the turf's):
+	if (screenshot_requested && !frames.current().on_readback) {
+		screenshot_requested = false;
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glReadBuffer(GL_BACK);
+		frames.read_pixels_async(glm::uvec2(0), drawable_size, [](glm::uvec2 const &size, glm::u8vec4 const *pixels) {
+			std::string filename = "screenshot.png";
+			std::cout << "Saving screenshot to '" << filename << "'." << std::endl;
+			std::vector< glm::u8vec4 > data(pixels, pixels + size_t(size.x) * size.y);
+			for (auto &px : data) {
+				px.a = 0xff;
+			}
+			save_png(filename, size, data.data(), LowerLeftOrigin);
+		});
+	}
+
+	//unbind the sprite atlas:
 	glBindTexture(GL_TEXTURE_2D, 0);
 
 	//reset vertex array to none:
@@ -531,8 +527,32 @@ void PongMode::draw(glm::uvec2 const &drawable_size) {
 
 	//reset current program to none:
 	glUseProgram(0);
-	
+
+	gpu_profiler.pop(); //draw
+
+	//mark the end of this slot's commands:
+	frames.end_frame();
+
+	//remember this frame for the overlay:
+	// (GPU time is from the most recently retired frame, since this one hasn't run yet)
+	hud_frame.gpu_ms = gpu_profiler.latest("draw");
+	hud_frame.vertices = drawn_vertices;
+	#ifdef ENABLE_ALLOC_TRACKING
+	//(counts are for the previous complete frame; main ends frames after the swap)
+	hud_frame.allocations_tracked = true;
+	hud_frame.allocations = AllocTracker::last_frame().allocations;
+	hud_frame.allocated_bytes = AllocTracker::last_frame().allocated_bytes;
+	#endif
+	hud_frame.draw_ms = std::chrono::duration< float, std::milli >(std::chrono::steady_clock::now() - draw_start).count();
+	hud.push(hud_frame);
 
 	GL_ERRORS(); //PARANOIA: print errors just in case we did something wrong.
 
 }
+
+void PongMode::record_telemetry(Telemetry &telemetry) {
+	telemetry.sample("balls", balls.size());
+	telemetry.sample("vertices", drawn_vertices);
+	telemetry.sample("upload_bytes", uploaded_bytes);
+	telemetry.sample("fence_wait_us", uint64_t(frames.last_wait * 1.0e6f));
+}
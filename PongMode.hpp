@@ -1,4 +1,16 @@
 #include "ColorTextureProgram.hpp"
+#include "gl_compile_program.hpp"
+#include "TextureAtlas.hpp"
+#include "FrameUniforms.hpp"
+#include "FramesInFlight.hpp"
+#include "GPUProfiler.hpp"
+#include "Telemetry.hpp"
+#include "PerfHUD.hpp"
+#include "PongSim.hpp"
+#include "Replay.hpp"
+#include "NetClient.hpp"
+#include "Rollback.hpp"
+#include "AssetLoader.hpp"
 
 #include "Mode.hpp"
 #include "GL.hpp"
@@ -6,84 +18,125 @@
 #include <glm/glm.hpp>
 
 #include <vector>
-#include <deque>
-
-struct Ball {
-	glm::vec2 ball_radius;
-	glm::vec2 ball;
-	glm::vec2 ball_velocity;
-	glm::u8vec4 trail_color;
-	float alive;
-	std::deque< glm::vec3 > ball_trail;
-};
+#include <chrono>
+#include <memory>
 
 /*
  * PongMode is a game mode that implements a single-player game of Pong.
+ * (The game itself -- state and simulation -- is PongSim; PongMode adds input and OpenGL drawing.)
  */
 
-struct PongMode : Mode {
-	PongMode();
+struct PongMode : Mode, PongSim {
+	PongMode(Scenario const &scenario = Scenario());
 	virtual ~PongMode();
 
 	//functions called by main loop:
 	virtual bool handle_event(SDL_Event const &, glm::uvec2 const &window_size) override;
 	virtual void update(float elapsed) override;
 	virtual void draw(glm::uvec2 const &drawable_size) override;
-	virtual void newBall();
-
-	//----- game state -----
-
-	glm::vec2 court_radius = glm::vec2(7.0f, 5.0f);
-	glm::vec2 paddle_radius = glm::vec2(0.2f, 1.0f);
-	glm::vec2 ball_radius = glm::vec2(0.2f, 0.2f);
-
-	glm::vec2 left_paddle = glm::vec2(-court_radius.x + 0.5f, 0.0f);
-	glm::vec2 right_paddle = glm::vec2( court_radius.x - 0.5f, 0.0f);
-
-	float time = 0.0;
-	float threshold = 6.0f;
-
-	int startingW = 640;
-	int startingH = 480;
-
-	std::vector<Ball*> balls;
-
-	uint32_t left_score = 0;
-	uint32_t right_score = 0;
-
-	float ai_offset = 0.0f;
-	float ai_offset_update = 0.0f;
-
-	//----- pretty rainbow trails -----
-
-	float trail_length = 0.04f;
-	const glm::u8vec4 player1_trail = (glm::u8vec4((0x00ACF4ff >> 24) & 0xff, (0x00ACF4ff >> 16) & 0xff, (0x00ACF4ff >> 8) & 0xff, (0x00ACF4ff) & 0xff ));
-	const glm::u8vec4 player2_trail = (glm::u8vec4((0xF50064ff >> 24) & 0xff, (0xF50064ff >> 16) & 0xff, (0xF50064ff >> 8) & 0xff, (0xF50064ff) & 0xff ));
-	//std::deque< glm::vec3 > ball_trail; //stores (x,y,age), oldest elements first
+	virtual void record_telemetry(Telemetry &) override;
+
+	//----- replays -----
+
+	//if set, every update step is recorded (and the file finished when the mode is destroyed):
+	std::unique_ptr< ReplayWriter > recorder;
+	//if set, the game is played back from a replay instead of from input
+	// (space pauses / resumes, right / left arrow step one frame forward / back, '[' / ']' skip 5 seconds,
+	//  tab toggles max-speed playback):
+	std::unique_ptr< ReplayPlayer > player;
+	//clear the turf next frame (the turf isn't part of the simulation state, so seeking can't restore it):
+	bool clear_turf = false;
+	//a replay's turf is scored when it plays to its end -- unless it was seeked, since the seek cleared the
+	// turf and what's painted since isn't the whole game (a note is printed instead of the score):
+	bool replay_seeked = false;
+	bool replay_scored = false; //printed the replay's turf score (or the note) yet?
+
+	//----- networking -----
+
+	//if set, the game is played on a server (see NetServer.hpp): the mouse moves 'net_paddle_y', which is
+	// sent to the server, and the game shown is the server's (with our own paddle drawn where the mouse is):
+	std::unique_ptr< NetClient > net;
+	float net_paddle_y = 0.0f;
+	//...or played peer to peer with rollback (see Rollback.hpp), also with the mouse moving 'net_paddle_y':
+	std::unique_ptr< NetLink > peer_link;
+	std::unique_ptr< RollbackSession > rollback;
 
 	//----- opengl assets / helpers ------
 
-	//draw functions will work on vectors of vertices, defined as follows:
-	struct Vertex {
-		Vertex(glm::vec3 const &Position_, glm::u8vec4 const &Color_, glm::vec2 const &TexCoord_) :
-			Position(Position_), Color(Color_), TexCoord(TexCoord_) { }
-		glm::vec3 Position;
-		glm::u8vec4 Color;
-		glm::vec2 TexCoord;
-	};
-	static_assert(sizeof(Vertex) == 4*3 + 1*4 + 4*2, "PongMode::Vertex should be packed");
+	//(vertices are PongSim::Vertex, built by PongSim::build_vertices)
 
-	//Shader program that draws transformed, vertices tinted with vertex colors:
-	ColorTextureProgram color_texture_program;
+	//Shader programs are compiled in one batch, submitted when the mode is made and claimed at first draw,
+	// so the driver compiles them while the rest of the mode is set up (timings are printed after the first frame):
+	GLProgramBatch programs;
+	bool programs_reported = false;
 
-	//Buffer used to hold vertex data during drawing:
-	GLuint vertex_buffer = 0;
-
-	//Vertex Array Object that maps buffer locations to color_texture_program attribute locations:
-	GLuint vertex_buffer_for_color_texture_program = 0;
-
-	//Solid white texture:
-	GLuint white_tex = 0;
+	//Shader program that draws transformed, vertices tinted with vertex colors:
+	ColorTextureProgram color_texture_program{programs};
+
+	//Per-frame constants (court-to-clip transform) shared by all programs:
+	FrameUniforms frame_uniforms;
+
+	//Per-frame transient resources (including the vertex buffer used during drawing), fenced so that
+	// the CPU can build the next frame while the GPU draws this one:
+	FramesInFlight frames;
+
+	//Vertex Array Objects that map buffer locations to color_texture_program attribute locations
+	// (one per frame slot, since each slot has its own vertex buffer):
+	std::vector< GLuint > vertex_buffer_for_color_texture_program;
+
+	//what the last draw() did, for telemetry:
+	uint32_t drawn_vertices = 0;
+	uint64_t uploaded_bytes = 0;
+
+	//The court is drawn into 'turf_tex' (through 'turf_framebuffer'), which is never cleared: the trails painted
+	// over the whole game are the turf, scored at the end. Each frame, the turf is copied to the window and the
+	// performance overlay is drawn over the copy, so the overlay never becomes part of the turf:
+	GLuint turf_framebuffer = 0;
+	GLuint turf_tex = 0;
+	glm::uvec2 turf_size = glm::uvec2(0);
+	//(re)make the turf at 'size', keeping what has been painted (scaled to fit):
+	void resize_turf(glm::uvec2 const &size);
+
+	//----- readbacks -----
+	//(both read through 'frames' without stalling, so they arrive a few frames after they are asked for)
+
+	//set 'requested' to have the turf scored (see PongSim::score_turf) from the next frame drawn:
+	struct TurfScore {
+		bool requested = false;
+		bool pending = false; //read back, but not arrived yet
+		bool ready = false; //the counts below are in
+		glm::uvec2 size = glm::uvec2(0); //of the turf, in pixels
+		uint32_t player1 = 0, player2 = 0; //pixels painted in each player's trail color
+	} turf_score;
+	//set by the screenshot key; the next frame drawn is saved to 'screenshot.png':
+	bool screenshot_requested = false;
+
+	//performance overlay (F3 toggles), drawn from the frame's vertex buffer over the copied turf:
+	PerfHUD hud;
+	float last_update_ms = 0.0f;
+	std::chrono::steady_clock::time_point last_draw_start = std::chrono::steady_clock::now();
+
+	//GPU timings for the passes in draw() (F9 prints them and writes 'gpu-profile.tsv'):
+	GPUProfiler gpu_profiler{frames};
+	//time trails and solid objects separately (F8 toggles); this splits the court's draw call in two, so it's off by default:
+	bool profile_court_passes = false;
+
+	//Sprite atlas; every sprite is drawn from this one texture, so the whole court is one draw call (plus one for the HUD, if shown).
+	// always contains a solid "white" sprite, used for untextured (vertex-color-only) geometry:
+	TextureAtlas atlas = TextureAtlas(glm::uvec2(512, 512));
+	GLuint atlas_tex = 0;
+	//the atlas sprites the court is drawn with (see PongSim::build_vertices):
+	Sprites sprites;
+
+	//----- skins -----
+
+	//start loading the sprites in a skin: a directory holding 'ball.png' and/or 'paddle.png' (or a
+	// 'pack-assets' archive of them, if 'path' ends in ".pak"). They are decoded in the background and
+	// added to the atlas a few per frame, so the game starts right away and is drawn with plain
+	// rectangles until they arrive; throws if the archive can't be opened:
+	void load_skin(std::string const &path);
+	std::unique_ptr< AssetArchive > skin_archive;
+	std::unique_ptr< AssetLoader > skin_loader;
 
 	//matrix that maps from clip coordinates to court-space coordinates:
 	glm::mat3x2 clip_to_court = glm::mat3x2(1.0f);
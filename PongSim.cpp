@@ -0,0 +1,626 @@
+#include "PongSim.hpp"
+
+#include "AllocTracker.hpp"
+#include "Fixed.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+//The physics is written once, for a number type 'Real' (float or Fixed), and instantiated for both.
+// State is kept in the sim's floats either way: in fixed point it is loaded as Fixed (rounding it to the
+// Q16.16 grid) and stored back exactly, so snapshots, replays, and drawing work the same in both modes.
+namespace {
+	//ball speed multiplier after 'alive' seconds:
+	float speed_ramp(float alive) {
+		return std::min(4.0f * std::pow(2.0f, alive / 5.0f), 10.0f);
+	}
+	Fixed speed_ramp(Fixed alive) {
+		return min(Fixed(4.0f) * exp2(alive / Fixed(5.0f)), Fixed(10.0f));
+	}
+
+	//how far a ball is from a paddle, for the ai picking one to chase (only ever compared):
+	double chase_distance(float dx, float dy) {
+		return std::sqrt(std::pow(dx, 2) + std::pow(dy, 2));
+	}
+	int64_t chase_distance(Fixed dx, Fixed dy) {
+		return int64_t(dx.raw) * dx.raw + int64_t(dy.raw) * dy.raw;
+	}
+
+	float mix(float a, float b, float t) {
+		return glm::mix(a, b, t);
+	}
+
+	//a random number in [0,1) (for Fixed, made with integer math only, so fast-math can't change it):
+	float random01(Rng &rng, float) {
+		return rng.next_float();
+	}
+	Fixed random01(Rng &rng, Fixed) {
+		return Fixed::from_raw(int32_t(rng.next_u32() >> 16));
+	}
+
+	//a scripted paddle's height at 'time' (see PaddleScript::scripted_y; for Fixed, made with integer math only):
+	float scripted_y(PaddleScript const &script, float time) {
+		return script.scripted_y(time);
+	}
+	Fixed scripted_y(PaddleScript const &script, Fixed time) {
+		if (script.kind == PaddleScript::Hold) {
+			return Fixed(script.y);
+		} else if (script.kind == PaddleScript::Sine) {
+			//(a period too short for Q16.16 rounds up to the shortest it has, rather than to zero)
+			Fixed period = max(Fixed(script.period), Fixed::from_raw(1));
+			return Fixed(script.amplitude) * sin_turns(time / period);
+		} else if (script.kind == PaddleScript::Keys && !script.keys.empty()) {
+			if (time <= Fixed(script.keys.front().x)) return Fixed(script.keys.front().y);
+			for (size_t i = 1; i < script.keys.size(); ++i) {
+				Fixed a_time = Fixed(script.keys[i-1].x), b_time = Fixed(script.keys[i].x);
+				if (time < b_time) {
+					Fixed amt = (time - a_time) / (b_time - a_time);
+					return mix(Fixed(script.keys[i-1].y), Fixed(script.keys[i].y), amt);
+				}
+			}
+			return Fixed(script.keys.back().y);
+		}
+		return Fixed();
+	}
+
+	//a new ball's radius, 0.2 +/- [0.03,0.1):
+	template< typename Real >
+	float random_ball_radius(Rng &rng) {
+		Real lo = Real(0.03f);
+		Real hi = Real(0.1f);
+		Real r = lo + random01(rng, Real()) * (hi - lo);
+		if (rng.next_u32() % 2 == 1) {
+			return float(Real(0.2f) + r);
+		} else {
+			return float(Real(0.2f) - r);
+		}
+	}
+}
+
+PongSim::PongSim(Scenario const &scenario) {
+	ALLOC_SCOPE("balls");
+
+	court_radius = scenario.court_radius;
+	left_paddle = glm::vec2(-court_radius.x + 0.5f, 0.0f);
+	right_paddle = glm::vec2( court_radius.x - 0.5f, 0.0f);
+	trail_length = scenario.trail_length;
+	fixed_point = scenario.fixed_point;
+
+	threshold = scenario.spawn_first;
+	spawn_period = scenario.spawn_period;
+	spawn_count = scenario.spawn_count;
+	max_balls = scenario.max_balls;
+	bursts = scenario.bursts;
+
+	left_script = scenario.left;
+	right_script = scenario.right;
+
+	rng.seed(scenario.seed);
+
+	for (Scenario::Ball const &start : scenario.balls) {
+		balls.emplace_back();
+		Ball *b = &balls.back();
+		b->ball = start.position;
+		b->ball_velocity = start.velocity;
+		b->ball_radius = glm::vec2(start.radius);
+		b->alive = start.age;
+		if (start.player == 1) {
+			b->trail_color = player1_trail;
+		} else if (start.player == 2) {
+			b->trail_color = player2_trail;
+		} else {
+			b->trail_color = (glm::u8vec4((0x000000ff >> 24) & 0xff, (0x000000ff >> 16) & 0xff, (0x000000ff >> 8) & 0xff, (0x000000ff) & 0xff ));
+		}
+
+		//set up trail as if ball has been here for 'forever':
+		b->ball_trail.emplace_back(b->ball, trail_length);
+		b->ball_trail.emplace_back(b->ball, 0.0f);
+	}
+	for (uint32_t i = 0; i < scenario.random_balls; ++i) {
+		newBall();
+	}
+}
+
+void PongSim::newBall() {
+	ALLOC_SCOPE("balls");
+	float radius = (fixed_point ? random_ball_radius< Fixed >(rng) : random_ball_radius< float >(rng));
+	balls.emplace_back();
+	Ball *b = &balls.back();
+	b->ball_radius = glm::vec2(radius, radius);
+	if (rng.next_u32() % 2 == 1) {
+		b->ball_velocity = glm::vec2(-1.0f, 0.0f);
+		b->trail_color = player1_trail;
+	} else {
+		b->ball_velocity = glm::vec2(1.0f, 0.0f);
+		b->trail_color = player2_trail;
+	}
+	b->ball = glm::vec2(0.0f, 0.0f);
+	b->ball_trail.clear();
+	b->ball_trail.emplace_back(b->ball, trail_length);
+	b->ball_trail.emplace_back(b->ball, 0.0f);
+}
+
+void PongSim::update(float elapsed) {
+
+	time += elapsed;
+	if (time > threshold && balls.size() < max_balls) {
+		for (uint32_t i = 0; i < spawn_count && balls.size() < max_balls; ++i) {
+			newBall();
+		}
+		threshold += spawn_period;
+	}
+	while (next_burst < bursts.size() && time >= bursts[next_burst].time) {
+		for (uint32_t i = 0; i < bursts[next_burst].count; ++i) {
+			newBall();
+		}
+		++next_burst;
+	}
+
+	//----- paddles, balls, and collisions -----
+	//(in float, or -- for results that are the same bits on every machine -- in fixed point)
+	if (fixed_point) {
+		step_physics< Fixed >(elapsed);
+	} else {
+		step_physics< float >(elapsed);
+	}
+
+	//----- rainbow trails -----
+	update_trails(elapsed);
+}
+
+template< typename Real >
+void PongSim::step_physics(float elapsed_) {
+	using std::abs;
+	using std::max;
+	using std::min;
+
+	Real const elapsed = Real(elapsed_);
+	Real const court_x = Real(court_radius.x);
+	Real const court_y = Real(court_radius.y);
+	Real const paddle_rx = Real(paddle_radius.x);
+	Real const paddle_ry = Real(paddle_radius.y);
+	Real const zero = Real(0.0f);
+
+	//----- paddle update -----
+
+	drive_paddle< Real >(0, elapsed);
+	drive_paddle< Real >(1, elapsed);
+
+	//clamp paddles to court:
+	for (glm::vec2 *paddle : {&right_paddle, &left_paddle}) {
+		Real y = Real(paddle->y);
+		y = max(y, -court_y + paddle_ry);
+		y = min(y,  court_y - paddle_ry);
+		paddle->y = float(y);
+	}
+
+	Real const left_x = Real(left_paddle.x), left_y = Real(left_paddle.y);
+	Real const right_x = Real(right_paddle.x), right_y = Real(right_paddle.y);
+
+	//----- ball update -----
+	//(each ball is moved, then collided with the paddles, then with the walls; balls don't
+	// interact, so this is done in one pass, keeping each ball in registers)
+	for (Ball &b : balls) {
+		Real alive = Real(b.alive) + elapsed;
+		Real x = Real(b.ball.x), y = Real(b.ball.y);
+		Real vx = Real(b.ball_velocity.x), vy = Real(b.ball_velocity.y);
+		Real const rx = Real(b.ball_radius.x), ry = Real(b.ball_radius.y);
+
+		Real step = elapsed * speed_ramp(alive);
+		x += step * vx;
+		y += step * vy;
+
+		//---- collision handling ----
+
+		//paddles:
+		auto paddle_vs_ball = [&](Real px, Real py, glm::u8vec4 const &new_color) {
+			//compute area of overlap:
+			Real min_x = max(px - paddle_rx, x - rx), min_y = max(py - paddle_ry, y - ry);
+			Real max_x = min(px + paddle_rx, x + rx), max_y = min(py + paddle_ry, y + ry);
+			//if no overlap, no collision:
+			if (min_x > max_x || min_y > max_y) {
+				return;
+			}
+
+			if (max_x - min_x > max_y - min_y) {
+				//wider overlap in x => bounce in y direction:
+				if (y > py) {
+					y = py + paddle_ry + ry;
+					vy = abs(vy);
+				} else {
+					y = py - paddle_ry - ry;
+					vy = -abs(vy);
+				}
+			} else {
+				//wider overlap in y => bounce in x direction:
+				if (x > px) {
+					x = px + paddle_rx + rx;
+					vx = abs(vx);
+				} else {
+					x = px - paddle_rx - rx;
+					vx = -abs(vx);
+				}
+				//warp y velocity based on offset from paddle center:
+				Real vel = (y - py) / (paddle_ry + ry);
+				vy = mix(vy, vel, Real(0.75f));
+			}
+			b.trail_color = new_color;
+		};
+		paddle_vs_ball(left_x, left_y, player1_trail);
+		paddle_vs_ball(right_x, right_y, player2_trail);
+
+		//court walls:
+		if (y > court_y - ry) {
+			y = court_y - ry;
+			if (vy > zero) {
+				vy = -vy;
+			}
+		}
+		if (y < -court_y + ry) {
+			y = -court_y + ry;
+			if (vy < zero) {
+				vy = -vy;
+			}
+		}
+
+		if (x > court_x - rx) {
+			x = court_x - rx;
+			if (vx > zero) {
+				vx = -vx;
+			}
+		}
+		if (x < -court_x + rx) {
+			x = -court_x + rx;
+			if (vx < zero) {
+				vx = -vx;
+			}
+		}
+
+		b.alive = float(alive);
+		b.ball = glm::vec2(float(x), float(y));
+		b.ball_velocity = glm::vec2(float(vx), float(vy));
+	}
+}
+
+template< typename Real >
+void PongSim::drive_paddle(uint32_t side, Real elapsed) {
+	using std::max;
+	using std::min;
+
+	PaddleScript const &script = (side == 0 ? left_script : right_script);
+	glm::vec2 &paddle = (side == 0 ? left_paddle : right_paddle);
+
+	if (script.kind == PaddleScript::Player) {
+		//moved by input, elsewhere
+	} else if (script.kind == PaddleScript::AI || script.kind == PaddleScript::Track) {
+		Real offset = Real(0.0f);
+		if (script.kind == PaddleScript::AI) {
+			Real offset_update = Real(ai_offset_update[side]) - elapsed;
+			ai_offset_update[side] = float(offset_update);
+			if (offset_update < elapsed) {
+				//update again in [0.5,1.0) seconds:
+				ai_offset_update[side] = float(random01(rng, Real()) * Real(0.5f) + Real(0.5f));
+				ai_offset[side] = float(random01(rng, Real()) * Real(2.5f) - Real(1.25f));
+			}
+			offset = Real(ai_offset[side]);
+		}
+		if (balls.empty()) return;
+		//chase the closest ball headed this way that the other player hit last:
+		Real const px = Real(paddle.x);
+		Real py = Real(paddle.y);
+		float toward = (side == 0 ? -1.0f : 1.0f);
+		glm::u8vec4 const &opponent_trail = (side == 0 ? player2_trail : player1_trail);
+		uint32_t closest = 0;
+		auto dist = std::numeric_limits< decltype(chase_distance(px, py)) >::max();
+		for (uint32_t i = 0; i < balls.size(); i++) {
+			if (balls[i].ball_velocity.x * toward > 0 && balls[i].trail_color == opponent_trail) {
+				auto new_dist = chase_distance(px - Real(balls[i].ball.x), py - Real(balls[i].ball.y));
+				if (new_dist < dist) {
+					dist = new_dist;
+					closest = i;
+				}
+			}
+		}
+		Real target = Real(balls[closest].ball.y) + offset;
+		if (script.kind == PaddleScript::Track) {
+			py = target;
+		} else if (py < target) {
+			py = min(target, py + Real(10.0f) * elapsed);
+		} else {
+			py = max(target, py - Real(10.0f) * elapsed);
+		}
+		paddle.y = float(py);
+	} else {
+		paddle.y = float(scripted_y(script, Real(time)));
+	}
+}
+
+//----- snapshots -----
+//A snapshot is one flat block: a StateHeader, the StateScalars, the balls (as an array of Ball),
+// then the random generator. It holds no pointers (sections are found by offset), so it can be copied,
+// stored, or sent anywhere, and restored with a handful of memcpys.
+
+namespace {
+	struct StateHeader {
+		char magic[4]; //"sim0"
+		uint32_t version;
+		uint32_t size; //of the whole snapshot
+		uint32_t ball_size; //sizeof(Ball), as a check that the layout matches
+		uint32_t ball_count;
+		uint32_t balls_offset;
+		uint32_t rng_offset;
+		uint32_t rng_size;
+	};
+	static_assert(sizeof(StateHeader) == 32, "StateHeader should be packed");
+
+	struct StateScalars {
+		glm::vec2 left_paddle;
+		glm::vec2 right_paddle;
+		float time;
+		float threshold;
+		uint32_t next_burst;
+		uint32_t left_score;
+		uint32_t right_score;
+		float ai_offset[2];
+		float ai_offset_update[2];
+		uint32_t reserved;
+	};
+	static_assert(sizeof(StateScalars) == 56, "StateScalars should be packed");
+
+	static_assert(std::is_trivially_copyable< Rng >::value, "the random generator is copied into snapshots as bytes");
+
+	StateScalars state_scalars(PongSim const &sim) {
+		StateScalars scalars;
+		scalars.left_paddle = sim.left_paddle;
+		scalars.right_paddle = sim.right_paddle;
+		scalars.time = sim.time;
+		scalars.threshold = sim.threshold;
+		scalars.next_burst = sim.next_burst;
+		scalars.left_score = sim.left_score;
+		scalars.right_score = sim.right_score;
+		std::memcpy(scalars.ai_offset, sim.ai_offset, sizeof(sim.ai_offset));
+		std::memcpy(scalars.ai_offset_update, sim.ai_offset_update, sizeof(sim.ai_offset_update));
+		scalars.reserved = 0;
+		return scalars;
+	}
+
+	//sections start on 16-byte boundaries:
+	uint32_t align16(size_t offset) {
+		return uint32_t((offset + 15) & ~size_t(15));
+	}
+}
+
+constexpr uint32_t PongSim::StateVersion;
+constexpr float Trail::SampleRate;
+constexpr uint32_t Trail::Capacity;
+
+size_t PongSim::state_size() const {
+	return align16(align16(sizeof(StateHeader) + sizeof(StateScalars)) + balls.size() * sizeof(Ball)) + sizeof(rng);
+}
+
+void PongSim::save_state(std::vector< uint8_t > *to) const {
+	size_t base = to->size();
+	to->resize(base + state_size());
+	uint8_t *out = to->data() + base;
+
+	StateHeader header;
+	std::memcpy(header.magic, "sim0", 4);
+	header.version = StateVersion;
+	header.size = uint32_t(state_size());
+	header.ball_size = sizeof(Ball);
+	header.ball_count = uint32_t(balls.size());
+	header.balls_offset = align16(sizeof(StateHeader) + sizeof(StateScalars));
+	header.rng_offset = align16(header.balls_offset + balls.size() * sizeof(Ball));
+	header.rng_size = sizeof(rng);
+
+	StateScalars scalars = state_scalars(*this);
+
+	std::memcpy(out, &header, sizeof(header));
+	std::memcpy(out + sizeof(header), &scalars, sizeof(scalars));
+	if (!balls.empty()) std::memcpy(out + header.balls_offset, balls.data(), balls.size() * sizeof(Ball));
+	std::memcpy(out + header.rng_offset, &rng, sizeof(rng));
+}
+
+void PongSim::restore_state(uint8_t const *data, size_t size) {
+	StateHeader header;
+	if (size < sizeof(header) + sizeof(StateScalars)) throw std::runtime_error("Sim state is truncated.");
+	std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.magic, "sim0", 4) != 0 || header.version != StateVersion) {
+		throw std::runtime_error("Sim state has the wrong magic or version.");
+	}
+	if (header.ball_size != sizeof(Ball) || header.rng_size != sizeof(rng)) {
+		throw std::runtime_error("Sim state was saved by a build with a different layout.");
+	}
+	if (header.size != size
+	 || header.balls_offset < sizeof(header) + sizeof(StateScalars)
+	 || header.balls_offset > size || (size - header.balls_offset) / sizeof(Ball) < header.ball_count
+	 || header.rng_offset < header.balls_offset + uint64_t(header.ball_count) * sizeof(Ball)
+	 || header.rng_offset > size || size - header.rng_offset < sizeof(rng)) {
+		throw std::runtime_error("Sim state is malformed.");
+	}
+
+	StateScalars scalars;
+	std::memcpy(&scalars, data + sizeof(header), sizeof(scalars));
+	if (scalars.next_burst > bursts.size()) throw std::runtime_error("Sim state doesn't match its scenario.");
+	left_paddle = scalars.left_paddle;
+	right_paddle = scalars.right_paddle;
+	time = scalars.time;
+	threshold = scalars.threshold;
+	next_burst = scalars.next_burst;
+	left_score = scalars.left_score;
+	right_score = scalars.right_score;
+	std::memcpy(ai_offset, scalars.ai_offset, sizeof(ai_offset));
+	std::memcpy(ai_offset_update, scalars.ai_offset_update, sizeof(ai_offset_update));
+
+	//(resize only allocates if the snapshot has more balls than ever before)
+	balls.resize(header.ball_count);
+	if (!balls.empty()) std::memcpy(balls.data(), data + header.balls_offset, balls.size() * sizeof(Ball));
+	std::memcpy(&rng, data + header.rng_offset, sizeof(rng));
+}
+
+uint64_t PongSim::state_hash() const {
+	//hashes the same sections a snapshot holds, straight from the sim's own arrays (no copy, no allocation):
+	StateScalars scalars = state_scalars(*this);
+	Hash64 hash(StateVersion);
+	hash.update(&scalars, sizeof(scalars));
+	if (!balls.empty()) hash.update(balls.data(), balls.size() * sizeof(Ball));
+	hash.update(&rng, sizeof(rng));
+	return hash.digest();
+}
+
+void PongSim::update_trails(float elapsed) {
+	//age up all locations in ball trail:
+	for (uint32_t i = 0; i < balls.size(); i++) {
+		Trail &trail = balls[i].ball_trail;
+		for (uint32_t t = 0; t < trail.size(); ++t) {
+			trail[t].z += elapsed;
+		}
+		//store fresh location at back of ball trail -- or, if the back point is less than a sample after the one
+		// before it, move the back point there instead (so points stay at least 1 / Trail::SampleRate apart):
+		if (trail.size() >= 2 && trail[trail.size() - 2].z - trail[trail.size() - 1].z < 1.0f / Trail::SampleRate) {
+			trail[trail.size() - 1] = glm::vec3(balls[i].ball, 0.0f);
+		} else {
+			trail.emplace_back(balls[i].ball, 0.0f);
+		}
+
+		//trim any too-old locations from back of trail:
+		//NOTE: since trail drawing interpolates between points, only removes back element if second-to-back element is too old:
+		while (balls[i].ball_trail.size() >= 2 && balls[i].ball_trail[1].z > trail_length) {
+			balls[i].ball_trail.pop_front();
+		}
+	}
+}
+
+void PongSim::push_sprite(std::vector< Vertex > *vertices, glm::vec2 const &center, glm::vec2 const &radius, TextureAtlas::Sprite const &sprite, glm::u8vec4 const &color) {
+	vertices->emplace_back(glm::vec3(center.x-radius.x, center.y-radius.y, 0.0f), color, sprite.uv(glm::vec2(0.0f, 0.0f)));
+	vertices->emplace_back(glm::vec3(center.x+radius.x, center.y-radius.y, 0.0f), color, sprite.uv(glm::vec2(1.0f, 0.0f)));
+	vertices->emplace_back(glm::vec3(center.x+radius.x, center.y+radius.y, 0.0f), color, sprite.uv(glm::vec2(1.0f, 1.0f)));
+
+	vertices->emplace_back(glm::vec3(center.x-radius.x, center.y-radius.y, 0.0f), color, sprite.uv(glm::vec2(0.0f, 0.0f)));
+	vertices->emplace_back(glm::vec3(center.x+radius.x, center.y+radius.y, 0.0f), color, sprite.uv(glm::vec2(1.0f, 1.0f)));
+	vertices->emplace_back(glm::vec3(center.x-radius.x, center.y+radius.y, 0.0f), color, sprite.uv(glm::vec2(0.0f, 1.0f)));
+}
+
+size_t PongSim::build_vertices(Sprites const &sprites, std::vector< Vertex > *vertices) const {
+	//some nice colors from the course web page:
+	#define HEX_TO_U8VEC4( HX ) (glm::u8vec4( (HX >> 24) & 0xff, (HX >> 16) & 0xff, (HX >> 8) & 0xff, (HX) & 0xff ))
+	const glm::u8vec4 fg_color = HEX_TO_U8VEC4(0xffffffff);
+	const glm::u8vec4 player1_color = HEX_TO_U8VEC4(0x008DECff);
+	const glm::u8vec4 player2_color = HEX_TO_U8VEC4(0xEC0040ff);
+	static const std::vector< glm::u8vec4 > rainbow_colors = {
+		HEX_TO_U8VEC4(0x604d29ff), HEX_TO_U8VEC4(0x624f29fc), HEX_TO_U8VEC4(0x69542df2),
+		HEX_TO_U8VEC4(0x6a552df1), HEX_TO_U8VEC4(0x6b562ef0), HEX_TO_U8VEC4(0x6b562ef0),
+		HEX_TO_U8VEC4(0x6d572eed), HEX_TO_U8VEC4(0x6f592feb), HEX_TO_U8VEC4(0x725b31e7),
+		HEX_TO_U8VEC4(0x745d31e3), HEX_TO_U8VEC4(0x755e32e0), HEX_TO_U8VEC4(0x765f33de),
+		HEX_TO_U8VEC4(0x7a6234d8), HEX_TO_U8VEC4(0x826838ca), HEX_TO_U8VEC4(0x977840a4),
+		HEX_TO_U8VEC4(0x96773fa5), HEX_TO_U8VEC4(0xa07f4493), HEX_TO_U8VEC4(0xa1814590),
+		HEX_TO_U8VEC4(0x9e7e4496), HEX_TO_U8VEC4(0xa6844887), HEX_TO_U8VEC4(0xa9864884),
+		HEX_TO_U8VEC4(0xad8a4a7c),
+	};
+	#undef HEX_TO_U8VEC4
+
+	//inline helper function for sprite drawing; maps the sprite's texture coordinates onto the rectangle:
+	auto draw_sprite = [vertices](glm::vec2 const &center, glm::vec2 const &radius, TextureAtlas::Sprite const &sprite, glm::u8vec4 const &color) {
+		push_sprite(vertices, center, radius, sprite, color);
+	};
+
+	//inline helper function for rectangle drawing:
+	//(the white sprite is a single texel, so every corner samples solid white)
+	TextureAtlas::Sprite const &white_sprite = sprites.white;
+	auto draw_rectangle = [&draw_sprite, &white_sprite](glm::vec2 const &center, glm::vec2 const &radius, glm::u8vec4 const &color) {
+		draw_sprite(center, radius, white_sprite, color);
+	};
+
+	//shadows for everything (except the trail):
+
+	/*
+	const glm::u8vec4 shadow_color = HEX_TO_U8VEC4(0x604d29ff);
+	const float shadow_offset = 0.07f;
+	glm::vec2 s = glm::vec2(0.0f,-shadow_offset);
+
+	draw_rectangle(glm::vec2(-court_radius.x-wall_radius, 0.0f)+s, glm::vec2(wall_radius, court_radius.y + 2.0f * wall_radius), shadow_color);
+	draw_rectangle(glm::vec2( court_radius.x+wall_radius, 0.0f)+s, glm::vec2(wall_radius, court_radius.y + 2.0f * wall_radius), shadow_color);
+	draw_rectangle(glm::vec2( 0.0f,-court_radius.y-wall_radius)+s, glm::vec2(court_radius.x, wall_radius), shadow_color);
+	draw_rectangle(glm::vec2( 0.0f, court_radius.y+wall_radius)+s, glm::vec2(court_radius.x, wall_radius), shadow_color);
+	draw_rectangle(left_paddle+s, paddle_radius, shadow_color);
+	draw_rectangle(right_paddle+s, paddle_radius, shadow_color);
+	draw_rectangle(ball+s, ball_radius, shadow_color);
+	*/
+	
+	//ball's trail:
+	for (uint32_t j = 0; j < balls.size(); j++) {
+		if (balls[j].ball_trail.size() >= 2) {
+			//start ti at second element so there is always something before it to interpolate from:
+			Trail const &trail = balls[j].ball_trail;
+			uint32_t ti = 1;
+			//draw trail from oldest-to-newest:
+			for (uint32_t i = uint32_t(rainbow_colors.size())-1; i < rainbow_colors.size(); --i) {
+				//time at which to draw the trail element:
+				float t = (i + 1) / float(rainbow_colors.size()) * trail_length;
+				//advance ti until 'just before' t:
+				while (ti < trail.size() && trail[ti].z > t) ++ti;
+				//if we ran out of tail, stop drawing:
+				if (ti == trail.size()) break;
+				//interpolate between previous and current trail point to the correct time:
+				glm::vec3 a = trail[ti-1];
+				glm::vec3 b = trail[ti];
+				glm::vec2 at = (t - a.z) / (b.z - a.z) * (glm::vec2(b) - glm::vec2(a)) + glm::vec2(a);
+				//draw:
+				draw_rectangle(at, balls[j].ball_radius, balls[j].trail_color);
+				//draw_rectangle(at, ball_radius, rainbow_colors[7]);
+			}
+		}
+	}
+	//(trails are drawn as their own pass so the profiler can time them separately)
+	size_t trail_vertices = vertices->size();
+
+	//solid objects:
+
+	//walls:
+	draw_rectangle(glm::vec2(-court_radius.x-wall_radius, 0.0f), glm::vec2(wall_radius, court_radius.y + 2.0f * wall_radius), fg_color);
+	draw_rectangle(glm::vec2( court_radius.x+wall_radius, 0.0f), glm::vec2(wall_radius, court_radius.y + 2.0f * wall_radius), fg_color);
+	draw_rectangle(glm::vec2( 0.0f,-court_radius.y-wall_radius), glm::vec2(court_radius.x, wall_radius), fg_color);
+	draw_rectangle(glm::vec2( 0.0f, court_radius.y+wall_radius), glm::vec2(court_radius.x, wall_radius), fg_color);
+
+	//paddles:
+	draw_sprite(left_paddle, paddle_radius, sprites.paddle, player1_color);
+	draw_sprite(right_paddle, paddle_radius, sprites.paddle, player2_color);
+	
+
+	//ball:
+	for (uint32_t i = 0; i < balls.size(); i++) {
+		draw_sprite(balls[i].ball, balls[i].ball_radius, sprites.ball, fg_color);
+	}
+
+	//scores:
+	for (uint32_t i = 0; i < left_score; ++i) {
+		draw_rectangle(glm::vec2( -court_radius.x + (2.0f + 3.0f * i) * score_radius.x, court_radius.y + 2.0f * wall_radius + 2.0f * score_radius.y), score_radius, fg_color);
+	}
+	for (uint32_t i = 0; i < right_score; ++i) {
+		draw_rectangle(glm::vec2( court_radius.x - (2.0f + 3.0f * i) * score_radius.x, court_radius.y + 2.0f * wall_radius + 2.0f * score_radius.y), score_radius, fg_color);
+	}
+
+	return trail_vertices;
+}
+
+void PongSim::score_turf(glm::u8vec4 const *pixels, size_t count, uint32_t *player1, uint32_t *player2) const {
+	uint32_t p1 = 0;
+	uint32_t p2 = 0;
+	for (size_t i = 0; i < count; ++i) {
+		glm::u8vec4 const &px = pixels[i];
+		if (px.r == player1_trail.r && px.g == player1_trail.g && px.b == player1_trail.b) {
+			p1 += 1;
+		}
+		if (px.r == player2_trail.r && px.g == player2_trail.g && px.b == player2_trail.b) {
+			p2 += 1;
+		}
+	}
+	*player1 = p1;
+	*player2 = p2;
+}
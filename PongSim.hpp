@@ -0,0 +1,162 @@
+#pragma once
+
+#include "TextureAtlas.hpp"
+#include "Scenario.hpp"
+#include "Rng.hpp"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+
+//a ball's trail, (x,y,age) oldest first; a fixed-size ring, so a Ball holds no pointers and can be copied with memcpy.
+// Points are kept at most SampleRate per second (see PongSim::update_trails), however fast the game steps, so
+// the longest trail a Scenario allows always fits:
+struct Trail {
+	static constexpr float SampleRate = 240.0f;
+	static constexpr uint32_t Capacity = 64; //(power of two, so the modulo is a mask)
+	//(trimming keeps one point older than the trail length, and the newest two and the one just added may be closer than 1 / SampleRate)
+	static_assert(Scenario::MaxTrailLength * SampleRate + 4.0f <= float(Capacity), "Trail::Capacity should hold the longest trail");
+	glm::vec3 points[Capacity];
+	uint32_t first = 0;
+	uint32_t count = 0;
+
+	uint32_t size() const { return count; }
+	glm::vec3 &operator[](uint32_t i) { return points[(first + i) % Capacity]; }
+	glm::vec3 const &operator[](uint32_t i) const { return points[(first + i) % Capacity]; }
+	void clear() { first = 0; count = 0; }
+	void pop_front() { first = (first + 1) % Capacity; count -= 1; }
+	void emplace_back(glm::vec2 const &at, float age) {
+		assert(count < Capacity);
+		count += 1;
+		(*this)[count - 1] = glm::vec3(at, age);
+	}
+};
+
+struct Ball {
+	glm::vec2 ball_radius;
+	glm::vec2 ball;
+	glm::vec2 ball_velocity;
+	glm::u8vec4 trail_color;
+	float alive;
+	Trail ball_trail;
+};
+static_assert(std::is_trivially_copyable< Ball >::value, "Ball should be trivially copyable (for snapshots)");
+
+/*
+ * PongSim is the game's state and simulation, plus the (court-space) geometry used to draw it.
+ * It doesn't touch OpenGL or SDL, so it can also be stepped headless (e.g., by the 'bench' tool).
+ * Everything about how a game starts and plays out (balls, spawns, paddle control, seed) comes from a Scenario.
+ */
+
+struct PongSim {
+	PongSim(Scenario const &scenario = Scenario());
+
+	//advance the game by 'elapsed' seconds:
+	void update(float elapsed);
+	//the part of update() that ages and trims ball trails:
+	void update_trails(float elapsed);
+	void newBall();
+	//the part of update() that moves the paddles and balls and handles collisions, with Real = float or Fixed:
+	template< typename Real > void step_physics(float elapsed);
+	//move a paddle (0 = left, 1 = right) as its script says:
+	template< typename Real > void drive_paddle(uint32_t side, Real elapsed);
+
+	//----- snapshots -----
+	//a snapshot is everything that changes during play (not the scenario's fixed setup), as one flat,
+	// pointer-free block; saving and restoring are a few memcpys, and restoring allocates nothing
+	// unless 'balls' must grow. Snapshots are only valid for the same build (layout is checked).
+
+	//append a snapshot (of state_size() bytes) to 'to':
+	void save_state(std::vector< uint8_t > *to) const;
+	size_t state_size() const;
+	//restore a snapshot saved by a PongSim set up from the same scenario; throws if malformed:
+	void restore_state(uint8_t const *data, size_t size);
+	static constexpr uint32_t StateVersion = 3; //2: Rng instead of std::mt19937; 3: 64-point trails, sampled at most Trail::SampleRate
+	//hash of everything a snapshot holds (equal states hash equal, in this build); cheap enough to take every
+	// step, so two runs of the same game can be compared step by step to find where they stop agreeing:
+	uint64_t state_hash() const;
+
+	//----- game state -----
+
+	glm::vec2 court_radius = glm::vec2(7.0f, 5.0f);
+	glm::vec2 paddle_radius = glm::vec2(0.2f, 1.0f);
+	glm::vec2 ball_radius = glm::vec2(0.2f, 0.2f);
+
+	glm::vec2 left_paddle = glm::vec2(-court_radius.x + 0.5f, 0.0f);
+	glm::vec2 right_paddle = glm::vec2( court_radius.x - 0.5f, 0.0f);
+
+	float time = 0.0;
+
+	//do physics in Q16.16 fixed point (see Fixed.hpp), for results that are bit-exact across machines:
+	bool fixed_point = false;
+
+	//ball spawning (see Scenario):
+	float threshold = 6.0f; //time of next scheduled spawn
+	float spawn_period = 6.0f;
+	uint32_t spawn_count = 1;
+	uint32_t max_balls = 6;
+	std::vector< Scenario::Burst > bursts;
+	uint32_t next_burst = 0;
+
+	PaddleScript left_script = PaddleScript(PaddleScript::Player);
+	PaddleScript right_script = PaddleScript(PaddleScript::AI);
+
+	int startingW = 640;
+	int startingH = 480;
+
+	std::vector<Ball> balls;
+
+	uint32_t left_score = 0;
+	uint32_t right_score = 0;
+
+	//ai paddle state (per paddle, left then right):
+	float ai_offset[2] = {0.0f, 0.0f};
+	float ai_offset_update[2] = {0.0f, 0.0f};
+
+	//----- pretty rainbow trails -----
+
+	float trail_length = 0.04f;
+	const glm::u8vec4 player1_trail = (glm::u8vec4((0x00ACF4ff >> 24) & 0xff, (0x00ACF4ff >> 16) & 0xff, (0x00ACF4ff >> 8) & 0xff, (0x00ACF4ff) & 0xff ));
+	const glm::u8vec4 player2_trail = (glm::u8vec4((0xF50064ff >> 24) & 0xff, (0xF50064ff >> 16) & 0xff, (0xF50064ff >> 8) & 0xff, (0xF50064ff) & 0xff ));
+
+	Rng rng; //this game's own random numbers (drive ball spawns and the ai); seeded from the scenario
+
+	//----- court layout -----
+
+	float wall_radius = 0.05f;
+	glm::vec2 score_radius = glm::vec2(0.1f, 0.1f);
+
+	//----- drawing -----
+
+
+	//draw functions will work on vectors of vertices, defined as follows:
+	struct Vertex {
+		Vertex(glm::vec3 const &Position_, glm::u8vec4 const &Color_, glm::vec2 const &TexCoord_) :
+			Position(Position_), Color(Color_), TexCoord(TexCoord_) { }
+		glm::vec3 Position;
+		glm::u8vec4 Color;
+		glm::vec2 TexCoord;
+	};
+	static_assert(sizeof(Vertex) == 4*3 + 1*4 + 4*2, "PongSim::Vertex should be packed");
+
+	//append a rectangle showing 'sprite', as two CCW-oriented triangles:
+	static void push_sprite(std::vector< Vertex > *vertices, glm::vec2 const &center, glm::vec2 const &radius, TextureAtlas::Sprite const &sprite, glm::u8vec4 const &color);
+
+	//the sprites build_vertices draws with (the caller looks them up in its atlas, so the sim only needs
+	// their texture coordinates -- not the atlas, or the png code behind it):
+	struct Sprites {
+		TextureAtlas::Sprite white; //a solid white texel, for plain colored rectangles
+		TextureAtlas::Sprite ball; //(tinted with the ball's color)
+		TextureAtlas::Sprite paddle; //(tinted with the player's color)
+	};
+
+	//append everything in the court (trails first, then solid objects), in court coordinates;
+	// returns how many of the vertices are trails:
+	size_t build_vertices(Sprites const &sprites, std::vector< Vertex > *vertices) const;
+
+	//count the pixels painted in each player's trail color (the end-of-game "turf" score):
+	void score_turf(glm::u8vec4 const *pixels, size_t count, uint32_t *player1, uint32_t *player2) const;
+};
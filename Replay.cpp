@@ -0,0 +1,364 @@
+#include "Replay.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+constexpr uint32_t ReplayFormat::Version;
+constexpr uint32_t ReplayFormat::TicksPerChunk;
+
+namespace {
+	//does the mask say step 'i' moved the paddle?
+	bool moved_at(uint8_t const *mask, uint32_t i) {
+		return (mask[i / 8] & (1 << (i % 8))) != 0;
+	}
+}
+
+ReplayFormat::End ReplayFormat::end_state(PongSim const &sim, uint32_t steps) {
+	End end;
+	end.steps = steps;
+	end.balls = uint32_t(sim.balls.size());
+	end.left_score = sim.left_score;
+	end.right_score = sim.right_score;
+	end.time = sim.time;
+	end.left_paddle_y = sim.left_paddle.y;
+	end.right_paddle_y = sim.right_paddle.y;
+	end.reserved = 0;
+	end.hash = sim.state_hash();
+	return end;
+}
+
+//----- ReplayWriter -----
+
+ReplayWriter::ReplayWriter(std::string const &filename_, Scenario const &scenario) : filename(filename_), out(filename_, std::ios::binary) {
+	if (!out) {
+		throw std::runtime_error("Failed to open replay '" + filename + "' for writing.");
+	}
+	ReplayFormat::Header header;
+	std::memcpy(header.magic, "rpl0", 4);
+	header.version = ReplayFormat::Version;
+	out.write(reinterpret_cast< char const * >(&header), sizeof(header));
+
+	std::ostringstream text;
+	scenario.write(text);
+	std::string str = text.str();
+	write_chunk('S', std::vector< uint8_t >(str.begin(), str.end()));
+}
+
+ReplayWriter::~ReplayWriter() {
+	if (!finished) flush_ticks();
+}
+
+void ReplayWriter::step(float elapsed_, PongSim const &sim) {
+	if (finished) return;
+	if (steps % keyframe_interval == 0) {
+		//(ticks before the keyframe go first, so chunks stay in step order)
+		flush_ticks();
+		std::vector< uint8_t > data(sizeof(ReplayFormat::Keyframe), 0);
+		ReplayFormat::Keyframe keyframe;
+		keyframe.step = steps;
+		keyframe.reserved = 0;
+		std::memcpy(data.data(), &keyframe, sizeof(keyframe));
+		sim.save_state(&data);
+		write_chunk('K', data);
+	}
+	float left_paddle_y = sim.left_paddle.y;
+	elapsed.emplace_back(elapsed_);
+	hashes.emplace_back(sim.state_hash());
+	moved.emplace_back(left_paddle_y != last_paddle_y);
+	if (moved.back()) paddle_y.emplace_back(left_paddle_y);
+	last_paddle_y = left_paddle_y;
+	steps += 1;
+	if (elapsed.size() == ReplayFormat::TicksPerChunk) flush_ticks();
+}
+
+void ReplayWriter::finish(PongSim const &sim) {
+	if (finished) return;
+	flush_ticks();
+	ReplayFormat::End end = ReplayFormat::end_state(sim, steps);
+	uint8_t const *bytes = reinterpret_cast< uint8_t const * >(&end);
+	write_chunk('E', std::vector< uint8_t >(bytes, bytes + sizeof(end)));
+	out.flush();
+	finished = true;
+	if (!out) {
+		std::cerr << "WARNING: failed to write replay '" << filename << "'." << std::endl;
+	}
+}
+
+void ReplayWriter::write_chunk(char tag, std::vector< uint8_t > const &data) {
+	ReplayFormat::Chunk chunk;
+	chunk.tag = tag;
+	std::memset(chunk.reserved, 0, sizeof(chunk.reserved));
+	chunk.size = uint32_t(data.size());
+	out.write(reinterpret_cast< char const * >(&chunk), sizeof(chunk));
+	out.write(reinterpret_cast< char const * >(data.data()), data.size());
+	//(so readers see whole chunks as soon as possible)
+	out.flush();
+}
+
+void ReplayWriter::flush_ticks() {
+	if (elapsed.empty()) return;
+	ReplayFormat::Ticks ticks;
+	ticks.first = first;
+	ticks.count = uint32_t(elapsed.size());
+
+	std::vector< uint8_t > data(sizeof(ticks) + ReplayFormat::TicksPerChunk / 8 + (elapsed.size() + paddle_y.size()) * sizeof(float), 0);
+	uint8_t *at = data.data();
+	std::memcpy(at, &ticks, sizeof(ticks));
+	at += sizeof(ticks);
+	for (uint32_t i = 0; i < moved.size(); ++i) {
+		if (moved[i]) at[i / 8] |= uint8_t(1 << (i % 8));
+	}
+	at += ReplayFormat::TicksPerChunk / 8;
+	std::memcpy(at, elapsed.data(), elapsed.size() * sizeof(float));
+	at += elapsed.size() * sizeof(float);
+	std::memcpy(at, paddle_y.data(), paddle_y.size() * sizeof(float));
+	write_chunk('T', data);
+
+	data.assign(sizeof(ticks) + hashes.size() * sizeof(uint64_t), 0);
+	std::memcpy(data.data(), &ticks, sizeof(ticks));
+	std::memcpy(data.data() + sizeof(ticks), hashes.data(), hashes.size() * sizeof(uint64_t));
+	write_chunk('H', data);
+
+	first += ticks.count;
+	elapsed.clear();
+	moved.clear();
+	paddle_y.clear();
+	hashes.clear();
+}
+
+//----- Replay -----
+
+Replay::Replay(std::string const &filename_) : filename(filename_) {
+	file.reset(new MappedFile(filename));
+	if (file->size < sizeof(ReplayFormat::Header)) {
+		throw std::runtime_error("Replay '" + filename + "' is too small to be valid.");
+	}
+	ReplayFormat::Header header;
+	std::memcpy(&header, file->data, sizeof(header));
+	if (std::memcmp(header.magic, "rpl0", 4) != 0 || header.version != ReplayFormat::Version) {
+		throw std::runtime_error("Replay '" + filename + "' has the wrong magic or version.");
+	}
+	parsed = sizeof(header);
+	scan();
+	if (keyframes.empty() && !steps.empty()) {
+		throw std::runtime_error("Replay '" + filename + "' has no keyframes.");
+	}
+}
+
+bool Replay::refresh() {
+	size_t old_steps = steps.size();
+	std::unique_ptr< MappedFile > remapped(new MappedFile(filename));
+	if (remapped->size < parsed) {
+		throw std::runtime_error("Replay '" + filename + "' got shorter while being read.");
+	}
+	//keyframe states point into the old mapping; move them to the new one:
+	for (Keyframe &keyframe : keyframes) {
+		keyframe.state = remapped->data + (keyframe.state - file->data);
+	}
+	file = std::move(remapped);
+	scan();
+	return steps.size() != old_steps;
+}
+
+void Replay::scan() {
+	uint8_t const *bytes = file->data;
+	size_t size = file->size;
+	auto malformed = [this](std::string const &why) {
+		return std::runtime_error("Replay '" + filename + "' is malformed (" + why + ").");
+	};
+
+	while (parsed < size) {
+		//a partial chunk at the end is one still being written; stop before it:
+		if (size - parsed < sizeof(ReplayFormat::Chunk)) break;
+		ReplayFormat::Chunk chunk;
+		std::memcpy(&chunk, bytes + parsed, sizeof(chunk));
+		if (size - parsed - sizeof(chunk) < chunk.size) break;
+		uint8_t const *data = bytes + parsed + sizeof(chunk);
+		parsed += sizeof(chunk) + chunk.size;
+
+		if (chunk.tag == 'S') {
+			std::istringstream text(std::string(reinterpret_cast< char const * >(data), chunk.size));
+			scenario.parse(text, filename);
+			has_scenario = true;
+		} else if (chunk.tag == 'T') {
+			ReplayFormat::Ticks ticks;
+			size_t const mask_size = ReplayFormat::TicksPerChunk / 8;
+			if (chunk.size < sizeof(ticks) + mask_size) throw malformed("short 'T' chunk");
+			std::memcpy(&ticks, data, sizeof(ticks));
+			if (ticks.first != steps.size()) throw malformed("steps out of order");
+			if (ticks.count > ReplayFormat::TicksPerChunk) throw malformed("too many steps in 'T' chunk");
+			uint8_t const *mask = data + sizeof(ticks);
+			uint32_t moves = 0;
+			for (uint32_t i = 0; i < ticks.count; ++i) {
+				if (moved_at(mask, i)) moves += 1;
+			}
+			if (chunk.size != sizeof(ticks) + mask_size + (ticks.count + moves) * sizeof(float)) throw malformed("'T' chunk has the wrong size");
+			uint8_t const *elapsed = mask + mask_size;
+			uint8_t const *move = elapsed + ticks.count * sizeof(float);
+			for (uint32_t i = 0; i < ticks.count; ++i) {
+				Step step;
+				std::memcpy(&step.elapsed, elapsed + i * sizeof(float), sizeof(float));
+				if (moved_at(mask, i)) {
+					std::memcpy(&paddle_y, move, sizeof(float));
+					move += sizeof(float);
+				}
+				step.left_paddle_y = paddle_y;
+				steps.emplace_back(step);
+			}
+		} else if (chunk.tag == 'H') {
+			ReplayFormat::Ticks ticks;
+			if (chunk.size < sizeof(ticks)) throw malformed("short 'H' chunk");
+			std::memcpy(&ticks, data, sizeof(ticks));
+			if (ticks.first != hashes.size() || uint64_t(ticks.first) + ticks.count > steps.size()) throw malformed("hashes out of order");
+			if (chunk.size != sizeof(ticks) + ticks.count * sizeof(uint64_t)) throw malformed("'H' chunk has the wrong size");
+			hashes.resize(ticks.first + ticks.count);
+			std::memcpy(hashes.data() + ticks.first, data + sizeof(ticks), ticks.count * sizeof(uint64_t));
+		} else if (chunk.tag == 'K') {
+			ReplayFormat::Keyframe keyframe;
+			if (chunk.size < sizeof(keyframe)) throw malformed("short 'K' chunk");
+			std::memcpy(&keyframe, data, sizeof(keyframe));
+			if (keyframe.step != steps.size()) throw malformed("keyframe out of order");
+			keyframes.emplace_back(Keyframe{keyframe.step, data + sizeof(keyframe), uint32_t(chunk.size - sizeof(keyframe))});
+		} else if (chunk.tag == 'E') {
+			if (chunk.size != sizeof(end)) throw malformed("'E' chunk has the wrong size");
+			std::memcpy(&end, data, sizeof(end));
+			has_end = true;
+		}
+		//(other chunks are skipped)
+	}
+	if (!has_scenario) throw malformed("no scenario");
+}
+
+uint32_t Replay::restore(uint32_t step, PongSim &sim) const {
+	auto after = std::upper_bound(keyframes.begin(), keyframes.end(), step, [](uint32_t s, Keyframe const &k) {
+		return s < k.step;
+	});
+	if (after == keyframes.begin()) {
+		throw std::runtime_error("Replay '" + filename + "' has no keyframe before step " + std::to_string(step) + ".");
+	}
+	Keyframe const &keyframe = *(after - 1);
+	sim.restore_state(keyframe.state, keyframe.size);
+	return keyframe.step;
+}
+
+std::string Replay::check_end(PongSim const &sim) const {
+	if (!has_end) return "";
+	ReplayFormat::End now = ReplayFormat::end_state(sim, uint32_t(steps.size()));
+	std::ostringstream diff;
+	auto compare = [&diff](char const *what, auto recorded, auto played) {
+		if (recorded != played) diff << " " << what << " " << recorded << " (recorded) vs " << played << " (played);";
+	};
+	compare("steps", end.steps, now.steps);
+	compare("balls", end.balls, now.balls);
+	compare("left score", end.left_score, now.left_score);
+	compare("right score", end.right_score, now.right_score);
+	compare("time", end.time, now.time);
+	compare("left paddle", end.left_paddle_y, now.left_paddle_y);
+	compare("right paddle", end.right_paddle_y, now.right_paddle_y);
+	if (diff.str().empty() && end.hash != now.hash) {
+		diff << std::hex << " state hash " << end.hash << " (recorded) vs " << now.hash << " (played);";
+	}
+	return diff.str();
+}
+
+uint32_t Replay::first_divergence(Replay const &other) const {
+	uint32_t count = uint32_t(std::min(hashes.size(), other.hashes.size()));
+	if (count == 0 || hashes[count - 1] == other.hashes[count - 1]) return UINT32_MAX;
+	//invariant: hashes match before 'lo' (if lo > 0, step lo-1 matched) and differ at 'hi':
+	uint32_t lo = 0, hi = count - 1;
+	while (lo < hi) {
+		uint32_t mid = lo + (hi - lo) / 2;
+		if (hashes[mid] == other.hashes[mid]) lo = mid + 1;
+		else hi = mid;
+	}
+	return hi;
+}
+
+//----- ReplayPlayer -----
+
+void ReplayPlayer::step(PongSim &sim) {
+	if (done()) return;
+	replay.apply_input(next, sim);
+	if (verify && diverged_at == UINT32_MAX && next < replay.hashes.size() && sim.state_hash() != replay.hashes[next]) {
+		diverged_at = next;
+		std::cout << "WARNING: replay '" << replay.filename << "' diverged from the recording at step " << next << " (time " << sim.time << ")." << std::endl;
+	}
+	sim.update(replay.steps[next].elapsed);
+	next += 1;
+	if (done() && !reported && replay.has_end) {
+		reported = true;
+		std::string diff = replay.check_end(sim);
+		if (diff.empty()) {
+			std::cout << "Replay '" << replay.filename << "' finished (" << next << " steps)." << std::endl;
+		} else {
+			std::cout << "WARNING: replay '" << replay.filename << "' diverged from the recording:" << diff << std::endl;
+		}
+	}
+}
+
+void ReplayPlayer::seek(PongSim &sim, uint32_t index) {
+	index = std::min(index, uint32_t(replay.steps.size()));
+	if (index == next) return;
+	//restore a keyframe unless playing forward from here is no more work:
+	auto after = std::upper_bound(replay.keyframes.begin(), replay.keyframes.end(), index, [](uint32_t s, Replay::Keyframe const &k) {
+		return s < k.step;
+	});
+	if (index < next || (after != replay.keyframes.begin() && (after - 1)->step > next)) {
+		next = replay.restore(index, sim);
+	}
+	while (next < index) {
+		replay.apply(next, sim);
+		next += 1;
+	}
+	banked = 0.0f;
+}
+
+void ReplayPlayer::skip(PongSim &sim, float seconds) {
+	uint32_t index = next;
+	float left = std::abs(seconds);
+	if (seconds < 0.0f) {
+		while (index > 0 && left > 0.0f) {
+			index -= 1;
+			left -= replay.steps[index].elapsed;
+		}
+	} else {
+		while (index < replay.steps.size() && left > 0.0f) {
+			left -= replay.steps[index].elapsed;
+			index += 1;
+		}
+	}
+	seek(sim, index);
+}
+
+uint32_t ReplayPlayer::advance(PongSim &sim, float elapsed) {
+	uint32_t played = 0;
+	if (speed == Realtime) {
+		//play the recorded steps that fit in the time that has passed:
+		banked += elapsed;
+		while (!done() && replay.steps[next].elapsed <= banked) {
+			banked -= replay.steps[next].elapsed;
+			step(sim);
+			played += 1;
+		}
+		if (done()) banked = 0.0f;
+	} else if (speed == MaxSpeed) {
+		auto start = std::chrono::steady_clock::now();
+		while (!done() && std::chrono::steady_clock::now() - start < max_speed_budget) {
+			step(sim);
+			played += 1;
+		}
+	}
+	//caught up with a replay that is still being recorded? check for more now and then:
+	if (done() && !replay.has_end && speed != Paused) {
+		refresh_timer += elapsed;
+		if (refresh_timer > 0.5f) {
+			refresh_timer = 0.0f;
+			replay.refresh();
+		}
+	}
+	return played;
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "PongSim.hpp"
+#include "Scenario.hpp"
+#include "MappedFile.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Replays record a game as its scenario plus, for every PongSim::update() step, the elapsed time and
+ *  the (input-driven) left paddle position. Since the simulation is deterministic given those, playing
+ *  the steps back reproduces the game exactly -- e.g., to look at a performance problem again and again.
+ * The turf (the trails painted over the game, which decide who won) isn't simulation state, so it isn't
+ *  in keyframes: seeking clears it, and a replay that was seeked doesn't have its turf scored at the end.
+ *
+ * File format (little-endian): a Header, then chunks, each a Chunk header followed by 'size' bytes:
+ *  'S' the scenario, as text (see Scenario::write)
+ *  'T' a run of up to TicksPerChunk steps: a Ticks header, a bitmask of which steps moved the paddle,
+ *      every step's elapsed time (float), then the new paddle position (float) for each step that moved it
+ *  'H' state hashes for the steps of the 'T' chunk before it: a Ticks header, then PongSim::state_hash()
+ *      (uint64) from just before each step (input applied), so playback can tell exactly which step stopped matching
+ *  'K' a keyframe: a Keyframe header, then the sim's full state (PongSim::save_state) just before that step;
+ *      written every 'keyframe_interval' steps (starting at step 0), so seeking never re-simulates more than that
+ *  'E' End: the final state (and its hash), so playback can check that it reproduced the game
+ * Unknown chunks are skipped, so later versions can add more.
+ *
+ * Chunks are flushed as they are written, and a reader stops quietly at a partially-written chunk,
+ *  so a replay can be opened (and refresh()'d) while the game recording it is still running.
+ * There is no index chunk: the reader indexes keyframes while it walks the chunk headers, which works
+ *  just as well for a file that is still growing.
+ */
+
+struct ReplayFormat {
+	struct Header {
+		char magic[4]; //"rpl0"
+		uint32_t version;
+	};
+	static_assert(sizeof(Header) == 8, "ReplayFormat::Header should be packed");
+	static constexpr uint32_t Version = 5; //2: keyframes are flat PongSim snapshots; 3: state hashes; 4: sims use Rng; 5: 64-point trails
+
+	struct Chunk {
+		char tag;
+		uint8_t reserved[3];
+		uint32_t size; //bytes following this header
+	};
+	static_assert(sizeof(Chunk) == 8, "ReplayFormat::Chunk should be packed");
+
+	struct Ticks {
+		uint32_t first; //index of first step in chunk
+		uint32_t count;
+	};
+	static_assert(sizeof(Ticks) == 8, "ReplayFormat::Ticks should be packed");
+	static constexpr uint32_t TicksPerChunk = 256;
+
+	struct Keyframe {
+		uint32_t step; //state is from just before this step
+		uint32_t reserved;
+	};
+	static_assert(sizeof(Keyframe) == 8, "ReplayFormat::Keyframe should be packed");
+
+	struct End {
+		uint32_t steps;
+		uint32_t balls;
+		uint32_t left_score;
+		uint32_t right_score;
+		float time;
+		float left_paddle_y;
+		float right_paddle_y;
+		uint32_t reserved;
+		uint64_t hash; //PongSim::state_hash()
+	};
+	static_assert(sizeof(End) == 40, "ReplayFormat::End should be packed");
+
+	static End end_state(PongSim const &sim, uint32_t steps);
+};
+
+//writes a replay as the game is played:
+struct ReplayWriter {
+	//throws if the file can't be opened:
+	ReplayWriter(std::string const &filename, Scenario const &scenario);
+	//writes any buffered steps (but not an End chunk -- call finish() for that):
+	~ReplayWriter();
+
+	//record one update() step of 'sim', given just before it is taken
+	// (the left paddle's position and the state hash are recorded from 'sim'; a keyframe of 'sim' is written if one is due):
+	void step(float elapsed, PongSim const &sim);
+
+	//steps between keyframes:
+	uint32_t keyframe_interval = 240;
+
+	//write buffered steps plus 'sim's final state; nothing more is recorded after this:
+	void finish(PongSim const &sim);
+
+	//----- internals -----
+	void write_chunk(char tag, std::vector< uint8_t > const &data);
+	void flush_ticks();
+
+	std::string filename;
+	std::ofstream out;
+	bool finished = false;
+	uint32_t steps = 0;
+	float last_paddle_y = 0.0f;
+	//buffered steps, not yet written:
+	uint32_t first = 0;
+	std::vector< float > elapsed;
+	std::vector< bool > moved;
+	std::vector< float > paddle_y;
+	std::vector< uint64_t > hashes;
+};
+
+//a replay, read from a memory-mapped file:
+struct Replay {
+	//throws if the file can't be read or is malformed:
+	Replay(std::string const &filename);
+
+	//map the file again and read anything added since (for replays still being recorded);
+	// returns true if there are new steps:
+	bool refresh();
+
+	std::string filename;
+	Scenario scenario;
+
+	struct Step {
+		float elapsed;
+		float left_paddle_y;
+	};
+	std::vector< Step > steps;
+	//PongSim::state_hash() from just before each step, with its paddle input applied
+	// (can trail 'steps' while the replay is being recorded):
+	std::vector< uint64_t > hashes;
+
+	bool has_end = false; //(a replay cut short -- e.g., by a crash -- has no End)
+	ReplayFormat::End end;
+
+	//keyframe index, in step order; states point into the mapped file:
+	struct Keyframe {
+		uint32_t step;
+		uint8_t const *state;
+		uint32_t size;
+	};
+	std::vector< Keyframe > keyframes;
+
+	//restore 'sim' (set up from 'scenario') to the last keyframe at or before 'step'; returns that keyframe's step:
+	uint32_t restore(uint32_t step, PongSim &sim) const;
+
+	//apply step 'index' to 'sim' (in two parts: its input, then the update):
+	void apply(uint32_t index, PongSim &sim) const {
+		apply_input(index, sim);
+		sim.update(steps[index].elapsed);
+	}
+	void apply_input(uint32_t index, PongSim &sim) const {
+		sim.left_paddle.y = steps[index].left_paddle_y;
+	}
+
+	//compare 'sim' (which has played every step) against the recorded end state;
+	// returns a description of the differences, or "" if it matches (or there is no End):
+	std::string check_end(PongSim const &sim) const;
+
+	//first step from which this replay's and 'other's state hashes differ (of the steps both have hashes for),
+	// or UINT32_MAX if they never do. Runs that diverge stay diverged (any difference is carried forward in
+	// the state), so this bisects, comparing O(log n) hashes:
+	uint32_t first_divergence(Replay const &other) const;
+
+	//----- internals -----
+	void scan(); //read chunks from 'parsed' on
+	std::unique_ptr< MappedFile > file;
+	size_t parsed = 0; //bytes of file read so far (always at a chunk boundary)
+	bool has_scenario = false;
+	float paddle_y = 0.0f; //paddle position as of the last step read
+};
+
+//plays a replay back into a simulation, in real time, paused, or as fast as possible:
+struct ReplayPlayer {
+	ReplayPlayer(std::string const &filename) : replay(filename) { }
+
+	enum Speed {
+		Realtime,
+		Paused,
+		MaxSpeed,
+	} speed = Realtime;
+
+	//advance 'sim' as 'speed' says for 'elapsed' seconds of wall-clock time; returns steps played
+	// (at the end of a replay that is still being recorded, this waits for more):
+	uint32_t advance(PongSim &sim, float elapsed);
+	//play one step (if any are left):
+	void step(PongSim &sim);
+	//jump to just before step 'index' (clamped to the end), via the closest keyframe if that's faster:
+	void seek(PongSim &sim, uint32_t index);
+	//jump by 'seconds' of game time (backward if negative):
+	void skip(PongSim &sim, float seconds);
+
+	bool done() const { return next >= replay.steps.size(); }
+
+	//compare the sim's state hash with the recorded one before every step, and warn at the first that differs:
+	bool verify = true;
+	uint32_t diverged_at = UINT32_MAX; //first step found to differ (UINT32_MAX if none has)
+
+	Replay replay;
+	uint32_t next = 0; //next step to play
+	float banked = 0.0f; //wall-clock time not yet played (Realtime)
+	//wall-clock time MaxSpeed may use per advance(), so the window stays responsive:
+	std::chrono::duration< float > max_speed_budget = std::chrono::milliseconds(15);
+	bool reported = false; //printed the end-of-replay check yet?
+	float refresh_timer = 0.0f; //time since checking a growing replay for more steps
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Rng is a xoshiro256** pseudo-random number generator: 32 bytes of plain state and a handful of
+ *  instructions per number, with jump() to skip ahead 2^128 numbers, so split() can hand out streams
+ *  that never overlap (e.g., one per match or per subsystem, all from one seed).
+ * Nothing is shared between instances, so any number of them can be used at once, from any threads.
+ * It is trivially copyable, so it can be saved and restored (e.g., in sim snapshots) with memcpy.
+ */
+
+struct Rng {
+	Rng(uint64_t seed_ = 0) { seed(seed_); }
+
+	//reset to the stream for 'seed' (any seed is fine; it is spread over the state with splitmix64):
+	void seed(uint64_t seed_) {
+		uint64_t x = seed_;
+		for (uint64_t &word : state) {
+			x += 0x9E3779B97F4A7C15ULL;
+			uint64_t z = x;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			word = z ^ (z >> 31);
+		}
+	}
+
+	uint64_t next() {
+		uint64_t result = rotl(state[1] * 5, 7) * 9;
+		uint64_t t = state[1] << 17;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = rotl(state[3], 45);
+		return result;
+	}
+	//(the high bits are the best ones, so smaller results use those)
+	uint32_t next_u32() { return uint32_t(next() >> 32); }
+	//uniform in [0,1):
+	float next_float() { return float(next() >> 40) * (1.0f / 16777216.0f); }
+
+	//skip ahead 2^128 numbers:
+	void jump() {
+		static constexpr uint64_t Jump[4] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+		uint64_t jumped[4] = { 0, 0, 0, 0 };
+		for (uint64_t bits : Jump) {
+			for (uint32_t b = 0; b < 64; ++b) {
+				if (bits & (1ULL << b)) {
+					for (uint32_t i = 0; i < 4; ++i) jumped[i] ^= state[i];
+				}
+				next();
+			}
+		}
+		for (uint32_t i = 0; i < 4; ++i) state[i] = jumped[i];
+	}
+	//a generator for the next 2^128 numbers of this stream; this one jumps past them:
+	Rng split() {
+		Rng ret = *this;
+		jump();
+		return ret;
+	}
+
+	//----- internals -----
+	static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+	uint64_t state[4];
+};
@@ -0,0 +1,186 @@
+#include "Rollback.hpp"
+
+#include "NetSnapshot.hpp"
+#include "BitPack.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+constexpr uint32_t RollbackSession::Window;
+constexpr uint32_t RollbackSession::MaxPrediction;
+
+RollbackSession::RollbackSession(PongSim &sim_, NetLink &link_, uint8_t side_, float tick_rate_)
+	: sim(sim_), link(link_), side(side_), tick_rate(tick_rate_) {
+	sim.left_script = PaddleScript(PaddleScript::Player);
+	sim.right_script = PaddleScript(PaddleScript::Player);
+
+	local_inputs.fill(0);
+	remote_inputs.fill(0);
+	used_remote.fill(0);
+	hashes.fill(0);
+	hash_ticks.fill(UINT32_MAX);
+	initial_remote = NetView::quantize(side == 1 ? sim.right_paddle.y : sim.left_paddle.y);
+	//(so saving states doesn't allocate during play, unless there come to be more balls than now)
+	for (std::vector< uint8_t > &state : states) {
+		state.reserve(sim.state_size());
+	}
+}
+
+int16_t RollbackSession::remote_input(uint32_t tick) const {
+	if (tick < remote_count) return remote_inputs[tick % Window];
+	else if (remote_count > 0) return remote_inputs[(remote_count - 1) % Window];
+	else return initial_remote;
+}
+
+uint32_t RollbackSession::advance(float elapsed, float paddle_y) {
+	float const dt = 1.0f / tick_rate;
+	//(at most four ticks of catching up per call)
+	banked = std::min(banked + elapsed, 4.0f * dt);
+
+	receive();
+	roll_back();
+
+	uint32_t ran = 0;
+	uint32_t const most_ahead = std::min(max_prediction, MaxPrediction);
+	while (banked >= dt) {
+		//(these are differences between tick counts, which may be negative)
+		int32_t local_advantage = int32_t(current - remote_count);
+		int32_t remote_advantage = int32_t(peer_current - peer_remote_count);
+		if (local_advantage - remote_advantage >= 2 && ticks_since_wait >= 10) {
+			//this peer's clock is ahead of the other's; skip a tick to let it catch up:
+			banked -= dt;
+			ticks_since_wait = 0;
+			stats.waits += 1;
+			continue;
+		}
+		if (local_advantage >= int32_t(most_ahead)) {
+			//too far ahead to keep predicting; wait for inputs (keeping the banked time, to catch up later):
+			stats.stalls += 1;
+			break;
+		}
+		banked -= dt;
+		local_inputs[current % Window] = NetView::quantize(paddle_y);
+		simulate(current);
+		current += 1;
+		ran += 1;
+		ticks_since_wait += 1;
+		stats.ticks += 1;
+	}
+
+	send();
+	return ran;
+}
+
+void RollbackSession::simulate(uint32_t tick) {
+	uint32_t slot = tick % Window;
+	std::vector< uint8_t > &state = states[slot];
+	state.clear();
+	sim.save_state(&state);
+
+	int16_t remote = remote_input(tick);
+	used_remote[slot] = remote;
+	float local_y = NetView::dequantize(local_input(tick));
+	float remote_y = NetView::dequantize(remote);
+	sim.left_paddle.y = (side == 1 ? local_y : remote_y);
+	sim.right_paddle.y = (side == 1 ? remote_y : local_y);
+
+	if (tick < remote_count) {
+		//(this tick's inputs are all real, and so are all before it, so this state is final)
+		hashes[slot] = sim.state_hash();
+		hash_ticks[slot] = tick;
+		final_tick = tick;
+	}
+	sim.update(1.0f / tick_rate);
+}
+
+void RollbackSession::roll_back() {
+	if (rollback_to >= current) {
+		rollback_to = UINT32_MAX;
+		return;
+	}
+	auto before = std::chrono::steady_clock::now();
+
+	std::vector< uint8_t > const &state = states[rollback_to % Window];
+	sim.restore_state(state.data(), state.size());
+	uint32_t depth = current - rollback_to;
+	for (uint32_t tick = rollback_to; tick < current; ++tick) {
+		simulate(tick);
+	}
+	rollback_to = UINT32_MAX;
+
+	float ms = std::chrono::duration< float, std::milli >(std::chrono::steady_clock::now() - before).count();
+	stats.rollbacks += 1;
+	stats.resimulated += depth;
+	stats.deepest = std::max(stats.deepest, depth);
+	stats.rollback_ms += ms;
+	stats.worst_rollback_ms = std::max(stats.worst_rollback_ms, ms);
+}
+
+//PeerInputs packet: the sender's current and remote_count (which acknowledges inputs), the first tick and
+// count of the inputs that follow, the sender's final_tick and its state hash, then the inputs (16 bits each).
+
+void RollbackSession::receive() {
+	while (size_t size = link.receive(buffer.data(), buffer.size())) {
+		if (NetPacket::type(buffer.data(), size) != NetPacket::PeerInputs) continue;
+		BitReader bits(buffer.data(), size);
+		bits.skip(16); //(protocol and packet type)
+		uint32_t their_current = bits.read(32);
+		uint32_t their_remote_count = bits.read(32);
+		uint32_t first = bits.read(32);
+		uint32_t count = bits.read(6);
+		uint32_t hash_tick = bits.read(32);
+		uint64_t hash = bits.read(32);
+		hash |= uint64_t(bits.read(32)) << 32;
+		if (bits.failed) continue;
+
+		//(packets may arrive out of order, so only newer news counts)
+		if (their_current >= peer_current) {
+			peer_current = their_current;
+			peer_remote_count = their_remote_count;
+		}
+		peer_count = std::max(peer_count, std::min(their_remote_count, current));
+
+		for (uint32_t i = 0; i < count; ++i) {
+			int16_t input = int16_t(uint16_t(bits.read(16)));
+			if (bits.failed) break;
+			uint32_t tick = first + i;
+			//only the next input is new (earlier ones are known, later ones can wait for a resend); and inputs
+			// further ahead than a well-behaved peer could send would overwrite ring slots still in use:
+			if (tick != remote_count || tick > current + MaxPrediction) continue;
+			remote_inputs[tick % Window] = input;
+			remote_count += 1;
+			//a tick simulated with a prediction that turned out wrong must be re-simulated:
+			if (tick < current && used_remote[tick % Window] != input) {
+				rollback_to = std::min(rollback_to, tick);
+			}
+		}
+
+		if (hash_tick != UINT32_MAX && hash_ticks[hash_tick % Window] == hash_tick
+		 && hashes[hash_tick % Window] != hash && desync_at == UINT32_MAX) {
+			desync_at = hash_tick;
+			std::cout << "WARNING: rollback peers disagree on the state at tick " << hash_tick << " (desync)." << std::endl;
+		}
+	}
+}
+
+void RollbackSession::send() {
+	//every input the peer hasn't acknowledged (which always fits the window; see MaxPrediction):
+	uint32_t first = std::max(peer_count, current >= Window ? current - (Window - 1) : 0);
+	uint32_t count = current - first;
+
+	BitWriter bits(buffer.data(), buffer.size());
+	bits.write(NetPacket::Protocol, 8);
+	bits.write(NetPacket::PeerInputs, 8);
+	bits.write(current, 32);
+	bits.write(remote_count, 32);
+	bits.write(first, 32);
+	bits.write(count, 6);
+	uint64_t hash = (final_tick != UINT32_MAX ? hashes[final_tick % Window] : 0);
+	bits.write(final_tick, 32);
+	bits.write(uint32_t(hash), 32);
+	bits.write(uint32_t(hash >> 32), 32);
+	for (uint32_t tick = first; tick < current; ++tick) {
+		bits.write(uint16_t(local_input(tick)), 16);
+	}
+	if (!bits.overflowed) link.send(buffer.data(), bits.bytes());
+}
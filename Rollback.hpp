@@ -0,0 +1,94 @@
+#pragma once
+
+#include "PongSim.hpp"
+#include "NetLink.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/*
+ * RollbackSession plays a two-player game peer to peer, GGPO-style: both peers run the whole simulation,
+ *  exchanging only paddle inputs, and neither waits for the other's input to arrive. A tick whose remote
+ *  input hasn't arrived yet is simulated with a prediction (the newest remote input received, held steady);
+ *  when the real input turns out to differ, the session restores its snapshot of the state from before that
+ *  tick (PongSim::restore_state) and re-simulates up to the present -- within the same frame.
+ *
+ * Inputs are paddle heights quantized to 1/512ths (as in NetSnapshot.hpp), so both peers feed the
+ *  simulation bit-identical values; every packet resends all of this peer's inputs the other hasn't
+ *  acknowledged, so lost packets cost nothing but latency. The simulation itself has to be deterministic
+ *  across the two peers' builds and machines (the scenario's 'physics fixed' mode is made for this).
+ *
+ * A peer may only predict 'max_prediction' ticks ahead of the newest remote input; past that, it stalls
+ *  until inputs arrive. A peer that finds itself further ahead than the other also drops an occasional
+ *  tick, so the two clocks drift together instead of one peer predicting (and rolling back) all the time.
+ *
+ * Each packet also carries the state hash (PongSim::state_hash) of the sender's newest tick simulated
+ *  with real inputs on both sides, so a desync -- peers that disagree on a state both consider final --
+ *  is noticed (and reported once) right away.
+ */
+
+struct RollbackSession {
+	//plays the paddle on 'side' (1 = left, 2 = right) of 'sim' (both paddles become Player paddles),
+	// talking to the peer on 'link'; both must outlive the session:
+	RollbackSession(PongSim &sim, NetLink &link, uint8_t side, float tick_rate = 60.0f);
+
+	//run the ticks 'elapsed' seconds of wall-clock time pay for (catching up at most a few per call),
+	// with 'paddle_y' as this side's input; returns the ticks run (not counting re-simulated ones):
+	uint32_t advance(float elapsed, float paddle_y);
+
+	//(the ring of saved states and inputs; the newest remote input can be at most this far back)
+	static constexpr uint32_t Window = 32;
+	//upper limit for max_prediction (inputs not yet acknowledged must fit the window):
+	static constexpr uint32_t MaxPrediction = (Window - 2) / 2;
+
+	PongSim &sim;
+	NetLink &link;
+	uint8_t side;
+	float tick_rate;
+	uint32_t max_prediction = 8; //ticks this peer may run past the newest remote input (at most MaxPrediction)
+
+	uint32_t current = 0; //next tick to simulate ('sim' holds the state before it)
+	uint32_t remote_count = 0; //remote inputs received (ticks [0, remote_count) are known)
+	uint32_t peer_count = 0; //local inputs the peer has acknowledged
+	uint32_t peer_current = 0; //the peer's 'current', as of its newest packet
+	uint32_t peer_remote_count = 0; //the peer's 'remote_count', as of its newest packet
+	float banked = 0.0f; //wall-clock time not yet simulated
+
+	uint32_t desync_at = UINT32_MAX; //first tick the peers were found to disagree on (UINT32_MAX if none)
+
+	//statistics (reset by whoever reports them):
+	struct Stats {
+		uint32_t ticks = 0;
+		uint32_t stalls = 0; //ticks not run because of max_prediction
+		uint32_t waits = 0; //ticks dropped to let the peer catch up
+		uint32_t rollbacks = 0;
+		uint32_t resimulated = 0; //ticks re-simulated by rollbacks
+		uint32_t deepest = 0; //most ticks re-simulated by one rollback
+		float rollback_ms = 0.0f; //time spent rolling back (restoring and re-simulating)
+		float worst_rollback_ms = 0.0f;
+	} stats;
+
+	//----- internals -----
+	int16_t local_input(uint32_t tick) const { return local_inputs[tick % Window]; }
+	//the remote input used for 'tick': the real one if known, otherwise the prediction:
+	int16_t remote_input(uint32_t tick) const;
+
+	std::array< int16_t, Window > local_inputs;
+	std::array< int16_t, Window > remote_inputs;
+	std::array< int16_t, Window > used_remote; //remote input each simulated tick used (real or predicted)
+	std::array< std::vector< uint8_t >, Window > states; //state before each tick (buffers reused as the ring turns)
+	std::array< uint64_t, Window > hashes; //state hash before each tick simulated with real inputs...
+	std::array< uint32_t, Window > hash_ticks; //...and which tick that was (UINT32_MAX if none)
+	uint32_t final_tick = UINT32_MAX; //newest tick simulated with real inputs (UINT32_MAX if none)
+	int16_t initial_remote = 0; //prediction before any remote input arrives
+	uint32_t rollback_to = UINT32_MAX; //earliest tick whose prediction turned out wrong
+	uint32_t ticks_since_wait = 0;
+	std::array< uint8_t, 128 > buffer;
+
+	void receive();
+	void roll_back();
+	void simulate(uint32_t tick);
+	void send();
+};
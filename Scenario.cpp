@@ -0,0 +1,223 @@
+#include "Scenario.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+constexpr float Scenario::MaxTrailLength;
+
+float PaddleScript::scripted_y(float time) const {
+	if (kind == Hold) {
+		return y;
+	} else if (kind == Sine) {
+		return amplitude * std::sin(2.0f * 3.14159265f * time / period);
+	} else if (kind == Keys && !keys.empty()) {
+		if (time <= keys.front().x) return keys.front().y;
+		for (size_t i = 1; i < keys.size(); ++i) {
+			if (time < keys[i].x) {
+				float amt = (time - keys[i-1].x) / (keys[i].x - keys[i-1].x);
+				return glm::mix(keys[i-1].y, keys[i].y, amt);
+			}
+		}
+		return keys.back().y;
+	}
+	return 0.0f;
+}
+
+void Scenario::load(std::string const &filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open scenario '" + filename + "'.");
+	}
+	parse(file, filename);
+}
+
+void Scenario::parse(std::istream &from, std::string const &source) {
+	*this = Scenario();
+	bool default_ball = true;
+
+	std::string line;
+	uint32_t line_number = 0;
+	while (std::getline(from, line)) {
+		++line_number;
+		auto malformed = [&](std::string const &why) {
+			return std::runtime_error("Malformed line " + std::to_string(line_number) + " '" + line + "' in scenario '" + source + "' (" + why + ").");
+		};
+		line = line.substr(0, line.find('#'));
+		std::istringstream str(line);
+		std::string tag;
+		if (!(str >> tag)) continue;
+
+		if (tag == "name") {
+			str >> name;
+		} else if (tag == "seed") {
+			str >> seed;
+		} else if (tag == "duration") {
+			str >> duration;
+		} else if (tag == "court") {
+			str >> court_radius.x >> court_radius.y;
+			if (str && (court_radius.x <= 1.0f || court_radius.y <= 1.0f)) throw malformed("court is too small for the paddles");
+		} else if (tag == "trail") {
+			str >> trail_length;
+			if (str && trail_length <= 0.0f) throw malformed("trail length must be positive");
+			if (str && trail_length > MaxTrailLength) {
+				std::ostringstream max;
+				max << MaxTrailLength;
+				throw malformed("trail length must be at most " + max.str() + " seconds");
+			}
+		} else if (tag == "physics") {
+			std::string type;
+			str >> type;
+			if (type == "float") fixed_point = false;
+			else if (type == "fixed") fixed_point = true;
+			else if (str) throw malformed("physics must be 'float' or 'fixed'");
+		} else if (tag == "ball") {
+			if (default_ball) balls.clear();
+			default_ball = false;
+			if ((str >> std::ws).peek() == 'n') {
+				std::string none;
+				str >> none;
+				if (none != "none") throw malformed("expected <x> <y> <vx> <vy> or 'none'");
+				continue;
+			}
+			Ball ball;
+			if (!(str >> ball.position.x >> ball.position.y >> ball.velocity.x >> ball.velocity.y)) throw malformed("expected <x> <y> <vx> <vy>");
+			std::string option;
+			while (str >> option) {
+				if (option == "radius") {
+					str >> ball.radius;
+				} else if (option == "player") {
+					uint32_t player = 0;
+					str >> player;
+					if (str && player > 2) throw malformed("player must be 0, 1, or 2");
+					ball.player = uint8_t(player);
+				} else if (option == "age") {
+					str >> ball.age;
+				} else {
+					throw malformed("unknown ball option '" + option + "'");
+				}
+				if (!str) throw malformed("expected a number after '" + option + "'");
+			}
+			str.clear();
+			balls.emplace_back(ball);
+		} else if (tag == "random-balls") {
+			str >> random_balls;
+		} else if (tag == "spawn") {
+			if ((str >> std::ws).peek() == 'n') {
+				std::string none;
+				str >> none;
+				if (none != "none") throw malformed("expected <first> <period> or 'none'");
+				spawn_first = std::numeric_limits< float >::infinity();
+				continue;
+			}
+			if (!(str >> spawn_first >> spawn_period)) throw malformed("expected <first> <period>");
+			if (spawn_period <= 0.0f) throw malformed("spawn period must be positive");
+			std::string option;
+			while (str >> option) {
+				if (option == "count") str >> spawn_count;
+				else if (option == "max") str >> max_balls;
+				else throw malformed("unknown spawn option '" + option + "'");
+				if (!str) throw malformed("expected a number after '" + option + "'");
+			}
+			str.clear();
+		} else if (tag == "burst") {
+			Burst burst;
+			str >> burst.time >> burst.count;
+			bursts.emplace_back(burst);
+		} else if (tag == "paddle") {
+			std::string side, kind;
+			str >> side >> kind;
+			if (side != "left" && side != "right") throw malformed("paddle must be 'left' or 'right'");
+			PaddleScript script;
+			if (kind == "player") {
+				if (side != "left") throw malformed("only the left paddle can be the player's");
+				script.kind = PaddleScript::Player;
+			} else if (kind == "ai") {
+				script.kind = PaddleScript::AI;
+			} else if (kind == "track") {
+				script.kind = PaddleScript::Track;
+			} else if (kind == "hold") {
+				script.kind = PaddleScript::Hold;
+				str >> script.y;
+			} else if (kind == "sine") {
+				script.kind = PaddleScript::Sine;
+				str >> script.amplitude >> script.period;
+				if (str && script.period <= 0.0f) throw malformed("sine period must be positive");
+			} else if (kind == "keys") {
+				script.kind = PaddleScript::Keys;
+				glm::vec2 key;
+				while (str >> key.x) {
+					if (!(str >> key.y)) throw malformed("expected <time> <y> pairs");
+					if (!script.keys.empty() && key.x < script.keys.back().x) throw malformed("keys must be in time order");
+					script.keys.emplace_back(key);
+				}
+				if (script.keys.empty() || !str.eof()) throw malformed("expected <time> <y> pairs");
+				str.clear();
+			} else {
+				throw malformed("unknown paddle script '" + kind + "'");
+			}
+			(side == "left" ? left : right) = script;
+		} else {
+			throw malformed("unknown record '" + tag + "'");
+		}
+		if (!str) {
+			throw malformed("expected more values");
+		}
+	}
+
+	std::stable_sort(bursts.begin(), bursts.end(), [](Burst const &a, Burst const &b) {
+		return a.time < b.time;
+	});
+}
+
+void Scenario::write(std::ostream &to) const {
+	std::ios::fmtflags flags = to.flags();
+	std::streamsize precision = to.precision();
+	to << std::setprecision(9);
+
+	to << "name " << name << "\n";
+	to << "seed " << seed << "\n";
+	to << "duration " << duration << "\n";
+	to << "court " << court_radius.x << " " << court_radius.y << "\n";
+	to << "trail " << trail_length << "\n";
+	to << "physics " << (fixed_point ? "fixed" : "float") << "\n";
+	for (Ball const &ball : balls) {
+		to << "ball " << ball.position.x << " " << ball.position.y << " " << ball.velocity.x << " " << ball.velocity.y
+		   << " radius " << ball.radius << " player " << uint32_t(ball.player) << " age " << ball.age << "\n";
+	}
+	if (balls.empty()) {
+		to << "ball none\n";
+	}
+	if (random_balls) to << "random-balls " << random_balls << "\n";
+	if (std::isinf(spawn_first)) {
+		to << "spawn none\n";
+	} else {
+		to << "spawn " << spawn_first << " " << spawn_period << " count " << spawn_count << " max " << max_balls << "\n";
+	}
+	for (Burst const &burst : bursts) {
+		to << "burst " << burst.time << " " << burst.count << "\n";
+	}
+	for (uint32_t side = 0; side < 2; ++side) {
+		PaddleScript const &script = (side == 0 ? left : right);
+		to << "paddle " << (side == 0 ? "left" : "right") << " ";
+		if (script.kind == PaddleScript::Player) to << "player";
+		else if (script.kind == PaddleScript::AI) to << "ai";
+		else if (script.kind == PaddleScript::Track) to << "track";
+		else if (script.kind == PaddleScript::Hold) to << "hold " << script.y;
+		else if (script.kind == PaddleScript::Sine) to << "sine " << script.amplitude << " " << script.period;
+		else if (script.kind == PaddleScript::Keys) {
+			to << "keys";
+			for (glm::vec2 const &key : script.keys) {
+				to << " " << key.x << " " << key.y;
+			}
+		}
+		to << "\n";
+	}
+
+	to.flags(flags);
+	to.precision(precision);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+/*
+ * A Scenario describes how a game starts and what happens in it -- court size, starting balls,
+ *  when new balls are spawned, how each paddle is moved, and the random seed -- so that a scene
+ *  (e.g., a heavy one seen in the wild) can be reproduced exactly, in the game or in 'bench'.
+ *
+ * A default-constructed Scenario is the normal game.
+ *
+ * Scenario files are text, one record per line ('#' starts a comment); anything not given keeps its default:
+ *  name <name>
+ *  seed <n>                                   random seed (ball spawns and the ai)
+ *  duration <seconds>                         length of the game
+ *  court <radius x> <radius y>
+ *  trail <seconds>                            length of ball trails (at most MaxTrailLength)
+ *  physics <float|fixed>                      number type for the physics; fixed point (Q16.16) gives the
+ *                                              same results on every compiler and machine (scripted paddles included)
+ *  ball <x> <y> <vx> <vy> [radius <r>] [player <0|1|2>] [age <seconds>]
+ *                                             a starting ball (the first 'ball' line replaces the default one);
+ *                                              'player' is who last hit it (0 = nobody), 'age' speeds it up
+ *  ball none                                  no starting balls (other than 'random-balls')
+ *  random-balls <n>                           n more starting balls, as if spawned
+ *  spawn <first> <period> [count <n>] [max <m>]
+ *                                             spawn 'count' balls at time 'first' and every 'period' seconds
+ *                                              after, while there are fewer than 'max' balls
+ *  spawn none                                 no scheduled spawns
+ *  burst <time> <count>                       spawn 'count' balls at 'time' (ignores 'max')
+ *  paddle <left|right> player                 moved by the mouse (left paddle only; default for left)
+ *  paddle <left|right> ai                     the computer opponent (default for right)
+ *  paddle <left|right> track                  follows the nearest incoming ball as fast as it can
+ *  paddle <left|right> hold <y>
+ *  paddle <left|right> sine <amplitude> <period>
+ *  paddle <left|right> keys <t> <y> [<t> <y> ...]
+ *                                             piecewise-linear path, holding the ends
+ */
+
+//how a paddle is moved:
+struct PaddleScript {
+	enum Kind : uint8_t {
+		Player,
+		AI,
+		Track,
+		Hold,
+		Sine,
+		Keys,
+	};
+	PaddleScript(Kind kind_ = Player) : kind(kind_) { }
+	Kind kind;
+	float y = 0.0f; //for Hold
+	float amplitude = 0.0f, period = 1.0f; //for Sine
+	std::vector< glm::vec2 > keys; //(time, y), in time order; for Keys
+
+	//paddle height at 'time' (for Hold, Sine and Keys):
+	float scripted_y(float time) const;
+};
+
+struct Scenario {
+	std::string name = "default";
+	uint32_t seed = 5489;
+	float duration = 40.0f;
+	glm::vec2 court_radius = glm::vec2(7.0f, 5.0f);
+	float trail_length = 0.04f;
+	static constexpr float MaxTrailLength = 0.25f; //(Trail::Capacity is sized for this)
+	bool fixed_point = false; //(physics)
+
+	struct Ball {
+		glm::vec2 position = glm::vec2(0.0f);
+		glm::vec2 velocity = glm::vec2(-1.0f, 0.0f);
+		float radius = 0.2f;
+		uint8_t player = 0; //who last hit the ball (sets its trail color); 0 = nobody
+		float age = 0.0f;
+	};
+	std::vector< Ball > balls = std::vector< Ball >(1);
+	uint32_t random_balls = 0;
+
+	float spawn_first = 6.0f;
+	float spawn_period = 6.0f;
+	uint32_t spawn_count = 1;
+	uint32_t max_balls = 6;
+
+	struct Burst {
+		float time;
+		uint32_t count;
+	};
+	std::vector< Burst > bursts; //in time order
+
+	PaddleScript left = PaddleScript(PaddleScript::Player);
+	PaddleScript right = PaddleScript(PaddleScript::AI);
+
+	//replace contents with a scenario read from a file / stream ('source' names it in errors); throws on error:
+	void load(std::string const &filename);
+	void parse(std::istream &from, std::string const &source);
+	//write in the format parse() reads (exactly -- floats round-trip):
+	void write(std::ostream &to) const;
+};
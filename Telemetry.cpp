@@ -0,0 +1,172 @@
+#include "Telemetry.hpp"
+
+#include <cerrno>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstring>
+#endif
+
+namespace {
+	bool ends_with(std::string const &str, std::string const &suffix) {
+		return str.size() >= suffix.size() && str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+	}
+
+	//the percentiles every report includes:
+	struct { char const *name; double percentile; } const Percentiles[] = {
+		{"p50", 50.0}, {"p95", 95.0}, {"p99", 99.0},
+	};
+}
+
+Telemetry::Telemetry(std::string const &destination_, std::string const &build_, float period_)
+	: destination(destination_), build(build_), period(period_), period_start(Clock::now()) {
+	//build goes verbatim into CSV and JSON, so keep it to characters neither needs escaped:
+	for (char &c : build) {
+		if (c == '"' || c == '\\' || c == ',' || uint8_t(c) < 0x20) c = '_';
+	}
+
+	if (destination.empty()) return;
+
+	std::string const unix_prefix = "unix:";
+	if (destination.compare(0, unix_prefix.size(), unix_prefix) == 0) {
+	#ifdef _WIN32
+		throw std::runtime_error("Telemetry to a Unix socket ('" + destination + "') isn't supported on Windows.");
+	#else
+		std::string path = destination.substr(unix_prefix.size());
+		sockaddr_un addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+			throw std::runtime_error("Telemetry socket path '" + path + "' is empty or too long.");
+		}
+		std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+		socket_fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+		if (socket_fd < 0) throw std::runtime_error("Failed to create telemetry socket: " + std::string(std::strerror(errno)));
+		//never let a slow (or absent) collector stall the game; reports are just dropped:
+		fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL) | O_NONBLOCK);
+		if (::connect(socket_fd, reinterpret_cast< sockaddr const * >(&addr), sizeof(addr)) != 0) {
+			std::string error = std::strerror(errno);
+			::close(socket_fd);
+			socket_fd = -1;
+			throw std::runtime_error("Failed to connect telemetry socket '" + path + "': " + error);
+		}
+		sink = UnixSocket;
+	#endif
+	} else {
+		sink = (ends_with(destination, ".csv") ? CSV : JSONLines);
+		file.open(destination, std::ios::binary | std::ios::app);
+		if (!file) throw std::runtime_error("Failed to open telemetry file '" + destination + "'.");
+		file.seekp(0, std::ios::end);
+		if (sink == CSV && file.tellp() == std::streampos(0)) {
+			file << "unix_time,build,period_s,name,count,p50,p95,p99,max\n";
+		}
+	}
+}
+
+Telemetry::~Telemetry() {
+	flush();
+#ifndef _WIN32
+	if (socket_fd >= 0) ::close(socket_fd);
+#endif
+}
+
+void Telemetry::sample(char const *name, uint64_t value) {
+	if (sink == None) return;
+	auto f = samples.find(name);
+	if (f == samples.end()) f = samples.emplace(name, Histogram()).first;
+	f->second.record(value);
+}
+
+void Telemetry::count(char const *name, uint64_t amount) {
+	if (sink == None) return;
+	counters[name] += amount;
+}
+
+void Telemetry::end_frame() {
+	if (sink == None) return;
+	if (std::chrono::duration< float >(Clock::now() - period_start).count() >= period) {
+		flush();
+	}
+}
+
+std::string Telemetry::report_json(double seconds) const {
+	std::ostringstream out;
+	out << "{\"unix_time\":" << std::time(nullptr) << ",\"build\":\"" << build << "\",\"period_s\":" << seconds;
+	out << ",\"samples\":{";
+	bool first = true;
+	for (auto const &s : samples) {
+		if (s.second.count() == 0) continue;
+		out << (first ? "" : ",") << "\"" << s.first << "\":{\"count\":" << s.second.count();
+		for (auto const &p : Percentiles) {
+			out << ",\"" << p.name << "\":" << s.second.percentile(p.percentile);
+		}
+		out << ",\"max\":" << s.second.max() << "}";
+		first = false;
+	}
+	out << "},\"counters\":{";
+	first = true;
+	for (auto const &c : counters) {
+		out << (first ? "" : ",") << "\"" << c.first << "\":" << c.second;
+		first = false;
+	}
+	out << "}}";
+	return out.str();
+}
+
+void Telemetry::flush() {
+	if (sink == None) return;
+
+	Clock::time_point now = Clock::now();
+	double seconds = std::chrono::duration< double >(now - period_start).count();
+	period_start = now;
+
+	bool any = !counters.empty();
+	for (auto const &s : samples) {
+		if (s.second.count()) any = true;
+	}
+	if (!any) return;
+
+	if (sink == CSV) {
+		std::time_t unix_time = std::time(nullptr);
+		for (auto const &s : samples) {
+			if (s.second.count() == 0) continue;
+			file << unix_time << ',' << build << ',' << seconds << ',' << s.first << ',' << s.second.count();
+			for (auto const &p : Percentiles) {
+				file << ',' << s.second.percentile(p.percentile);
+			}
+			file << ',' << s.second.max() << '\n';
+		}
+		//counters have only a total, which goes in the 'count' column:
+		for (auto const &c : counters) {
+			file << unix_time << ',' << build << ',' << seconds << ',' << c.first << ',' << c.second << ",,,,\n";
+		}
+		file.flush();
+	} else if (sink == JSONLines) {
+		file << report_json(seconds) << '\n';
+		file.flush();
+	} else if (sink == UnixSocket) {
+	#ifndef _WIN32
+		std::string report = report_json(seconds);
+		if (::send(socket_fd, report.data(), report.size(), 0) < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+			std::cerr << "WARNING: failed to send telemetry: " << std::strerror(errno) << std::endl;
+		}
+	#endif
+	}
+	if (file.is_open() && !file) {
+		std::cerr << "WARNING: failed to write telemetry to '" << destination << "'." << std::endl;
+		file.clear();
+	}
+
+	for (auto &s : samples) {
+		s.second.clear();
+	}
+	counters.clear();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Histogram.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+
+/*
+ * Telemetry accumulates per-frame measurements and periodically writes a summary to a sink.
+ *
+ * Two kinds of measurements:
+ *  - samples, e.g. sample("draw_us", 1234), go into a Histogram per name and are summarized
+ *    as count / p50 / p95 / p99 / max;
+ *  - counters, e.g. count("frames"), are summed.
+ * Both are reset after every flush, so each report covers one period.
+ *
+ * The destination picks the sink:
+ *  - "unix:/path/to/socket" sends each report as one JSON datagram to a local Unix socket;
+ *  - "*.csv" appends one row per measurement per report;
+ *  - anything else appends one JSON object per line (JSON Lines);
+ *  - "" disables telemetry (every call returns immediately).
+ */
+
+struct Telemetry {
+	//'build' is written into every report, to tell captures from different builds apart:
+	Telemetry(std::string const &destination, std::string const &build, float period = 10.0f);
+	~Telemetry();
+
+	Telemetry(Telemetry const &) = delete;
+	Telemetry &operator=(Telemetry const &) = delete;
+
+	bool enabled() const { return sink != None; }
+
+	void sample(char const *name, uint64_t value);
+	void count(char const *name, uint64_t amount = 1);
+
+	//call once per frame; flushes once 'period' seconds have passed since the last flush:
+	void end_frame();
+	//write a report now (does nothing if nothing was recorded):
+	void flush();
+
+	//----- internals -----
+	using Clock = std::chrono::steady_clock;
+
+	enum Sink { None, CSV, JSONLines, UnixSocket } sink = None;
+	std::string destination;
+	std::string build;
+	float period;
+
+	std::map< std::string, Histogram > samples;
+	std::map< std::string, uint64_t > counters;
+	Clock::time_point period_start;
+
+	std::ofstream file; //for CSV / JSONLines
+	int socket_fd = -1; //for UnixSocket
+
+	std::string report_json(double seconds) const;
+};
@@ -0,0 +1,178 @@
+#include "TextureAtlas.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+TextureAtlas::TextureAtlas(glm::uvec2 size_, uint32_t padding_) : size(size_), padding(padding_) {
+	pixels.assign(size.x * size.y, glm::u8vec4(0x00, 0x00, 0x00, 0x00));
+	skyline.emplace_back(Segment{0, 0, size.x});
+}
+
+bool TextureAtlas::find_position(glm::uvec2 const &rect, glm::uvec2 *at, size_t *segment_index) const {
+	bool found = false;
+	uint32_t best_y = ~0U;
+	uint32_t best_width = ~0U;
+	for (size_t i = 0; i < skyline.size(); ++i) {
+		uint32_t x = skyline[i].x;
+		if (x + rect.x > size.x) break;
+
+		//the rectangle rests on the highest segment it spans:
+		uint32_t y = 0;
+		uint32_t spanned = 0;
+		for (size_t j = i; j < skyline.size() && spanned < rect.x; ++j) {
+			y = std::max(y, skyline[j].y);
+			spanned += skyline[j].width;
+		}
+		if (y + rect.y > size.y) continue;
+
+		//prefer lowest placement, then the narrowest supporting segment (less wasted space):
+		if (y < best_y || (y == best_y && skyline[i].width < best_width)) {
+			found = true;
+			best_y = y;
+			best_width = skyline[i].width;
+			*at = glm::uvec2(x, y);
+			*segment_index = i;
+		}
+	}
+	return found;
+}
+
+void TextureAtlas::place(glm::uvec2 const &rect, glm::uvec2 const &at, size_t segment_index) {
+	skyline.insert(skyline.begin() + segment_index, Segment{at.x, at.y + rect.y, rect.x});
+
+	//trim or remove the segments now covered by the new one:
+	for (size_t i = segment_index + 1; i < skyline.size(); ) {
+		Segment &prev = skyline[i-1];
+		Segment &seg = skyline[i];
+		uint32_t prev_end = prev.x + prev.width;
+		if (seg.x >= prev_end) break;
+		uint32_t shrink = prev_end - seg.x;
+		if (shrink >= seg.width) {
+			skyline.erase(skyline.begin() + i);
+		} else {
+			seg.x += shrink;
+			seg.width -= shrink;
+			break;
+		}
+	}
+
+	//merge neighbors at the same height:
+	for (size_t i = 1; i < skyline.size(); ) {
+		if (skyline[i-1].y == skyline[i].y) {
+			skyline[i-1].width += skyline[i].width;
+			skyline.erase(skyline.begin() + i);
+		} else {
+			++i;
+		}
+	}
+}
+
+TextureAtlas::Sprite TextureAtlas::make_sprite(glm::uvec2 const &min_px, glm::uvec2 const &size_px) const {
+	Sprite sprite;
+	sprite.min_px = min_px;
+	sprite.size_px = size_px;
+	//inset to texel centers so bilinear filtering never reaches past the sprite's padding:
+	sprite.min_uv = (glm::vec2(min_px) + glm::vec2(0.5f)) / glm::vec2(size);
+	sprite.max_uv = (glm::vec2(min_px + size_px) - glm::vec2(0.5f)) / glm::vec2(size);
+	return sprite;
+}
+
+bool TextureAtlas::add(std::string const &name, glm::uvec2 const &image_size, glm::u8vec4 const *image) {
+	if (sprites.count(name)) {
+		throw std::runtime_error("Atlas already contains a sprite named '" + name + "'.");
+	}
+
+	glm::uvec2 rect = image_size + glm::uvec2(2 * padding);
+	glm::uvec2 at;
+	size_t segment_index;
+	if (!find_position(rect, &at, &segment_index)) return false;
+	place(rect, at, segment_index);
+
+	//copy image, replicating its edge pixels into the padding:
+	for (uint32_t y = 0; y < rect.y; ++y) {
+		uint32_t sy = uint32_t(std::min(std::max(int32_t(y) - int32_t(padding), 0), int32_t(image_size.y) - 1));
+		for (uint32_t x = 0; x < rect.x; ++x) {
+			uint32_t sx = uint32_t(std::min(std::max(int32_t(x) - int32_t(padding), 0), int32_t(image_size.x) - 1));
+			pixels[(at.y + y) * size.x + (at.x + x)] = image[sy * image_size.x + sx];
+		}
+	}
+
+	sprites.emplace(name, make_sprite(at + glm::uvec2(padding), image_size));
+	return true;
+}
+
+void TextureAtlas::add_png(std::string const &name, std::string const &filename) {
+	glm::uvec2 image_size;
+	std::vector< glm::u8vec4 > image;
+	load_png(filename, &image_size, &image, LowerLeftOrigin);
+	if (!add(name, image_size, image.data())) {
+		throw std::runtime_error("Image '" + filename + "' does not fit in atlas.");
+	}
+}
+
+TextureAtlas::Sprite const &TextureAtlas::lookup(std::string const &name) const {
+	auto f = sprites.find(name);
+	if (f == sprites.end()) {
+		throw std::runtime_error("Atlas has no sprite named '" + name + "'.");
+	}
+	return f->second;
+}
+
+//index format, one record per line:
+// atlas <width> <height> <padding>
+// sprite <name> <x> <y> <width> <height>
+void TextureAtlas::save(std::string const &png_filename, std::string const &index_filename) const {
+	save_png(png_filename, size, pixels.data(), LowerLeftOrigin);
+
+	std::ofstream index(index_filename, std::ios::binary);
+	index << "atlas " << size.x << " " << size.y << " " << padding << "\n";
+	for (auto const &ns : sprites) {
+		Sprite const &s = ns.second;
+		index << "sprite " << ns.first << " " << s.min_px.x << " " << s.min_px.y << " " << s.size_px.x << " " << s.size_px.y << "\n";
+	}
+	if (!index) {
+		throw std::runtime_error("Failed to write atlas index '" + index_filename + "'.");
+	}
+}
+
+void TextureAtlas::load(std::string const &png_filename, std::string const &index_filename) {
+	std::ifstream index(index_filename, std::ios::binary);
+	if (!index) {
+		throw std::runtime_error("Failed to open atlas index '" + index_filename + "'.");
+	}
+
+	glm::uvec2 index_size(0);
+	std::map< std::string, glm::uvec4 > rects;
+	std::string line;
+	while (std::getline(index, line)) {
+		std::istringstream str(line);
+		std::string tag;
+		if (!(str >> tag)) continue;
+		if (tag == "atlas") {
+			str >> index_size.x >> index_size.y >> padding;
+		} else if (tag == "sprite") {
+			std::string name;
+			glm::uvec4 rect;
+			str >> name >> rect.x >> rect.y >> rect.z >> rect.w;
+			rects[name] = rect;
+		}
+		if (!str) {
+			throw std::runtime_error("Malformed line '" + line + "' in atlas index '" + index_filename + "'.");
+		}
+	}
+
+	load_png(png_filename, &size, &pixels, LowerLeftOrigin);
+	if (size != index_size) {
+		throw std::runtime_error("Atlas image '" + png_filename + "' does not match its index.");
+	}
+
+	sprites.clear();
+	for (auto const &nr : rects) {
+		sprites.emplace(nr.first, make_sprite(glm::uvec2(nr.second.x, nr.second.y), glm::uvec2(nr.second.z, nr.second.w)));
+	}
+
+	//a loaded atlas is treated as full:
+	skyline.assign(1, Segment{0, size.y, size.x});
+}
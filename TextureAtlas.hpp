@@ -0,0 +1,70 @@
+#pragma once
+
+#include "load_save_png.hpp"
+
+#include <glm/glm.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ * TextureAtlas packs many small images into one large image (skyline bottom-left packing),
+ *  so sprites from different source images can share one texture bind and one draw call.
+ *
+ * Atlases can be packed at runtime (add / add_png) or offline with the 'pack-atlas' tool,
+ *  which writes a .png plus a text index that load() reads back.
+ *
+ * TextureAtlas does not touch OpenGL; upload 'pixels' (size 'size', lower-left origin) yourself.
+ */
+
+struct TextureAtlas {
+	//'padding' pixels of border are replicated around each sprite to avoid filtering bleed:
+	TextureAtlas(glm::uvec2 size = glm::uvec2(1024, 1024), uint32_t padding = 1);
+
+	struct Sprite {
+		glm::uvec2 min_px = glm::uvec2(0); //lower-left pixel in the atlas
+		glm::uvec2 size_px = glm::uvec2(0);
+		//texture coordinates of the sprite's outer texel centers:
+		glm::vec2 min_uv = glm::vec2(0.0f);
+		glm::vec2 max_uv = glm::vec2(0.0f);
+
+		//map a coordinate in [0,1]^2 within the sprite to atlas texture coordinates:
+		glm::vec2 uv(glm::vec2 const &t) const { return min_uv + t * (max_uv - min_uv); }
+		glm::vec2 center_uv() const { return 0.5f * (min_uv + max_uv); }
+	};
+
+	//add an image (lower-left origin); returns false (and changes nothing) if it doesn't fit:
+	bool add(std::string const &name, glm::uvec2 const &image_size, glm::u8vec4 const *image);
+
+	//load a png with load_png and add it; throws if it can't be loaded or doesn't fit:
+	void add_png(std::string const &name, std::string const &filename);
+
+	//look up a sprite by name; throws if missing:
+	Sprite const &lookup(std::string const &name) const;
+
+	//write atlas image + text index (used by the offline packer):
+	void save(std::string const &png_filename, std::string const &index_filename) const;
+	//replace contents with a previously saved atlas; throws on error:
+	void load(std::string const &png_filename, std::string const &index_filename);
+
+	//----- atlas contents -----
+	glm::uvec2 size;
+	uint32_t padding;
+	std::vector< glm::u8vec4 > pixels;
+	std::map< std::string, Sprite > sprites;
+
+	//----- skyline packer state -----
+	//the top edge of the packed area, as a list of horizontal segments sorted by x:
+	struct Segment {
+		uint32_t x, y, width;
+	};
+	std::vector< Segment > skyline;
+
+	//find a spot for a (padded) rectangle; returns false if none:
+	bool find_position(glm::uvec2 const &rect, glm::uvec2 *at, size_t *segment_index) const;
+	//update the skyline after placing a rectangle:
+	void place(glm::uvec2 const &rect, glm::uvec2 const &at, size_t segment_index);
+
+	Sprite make_sprite(glm::uvec2 const &min_px, glm::uvec2 const &size_px) const;
+};
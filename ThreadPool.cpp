@@ -0,0 +1,61 @@
+#include "ThreadPool.hpp"
+
+#include "CPUProfiler.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t count) {
+	if (count == 0) {
+		//hardware_concurrency() may return zero if it can't tell:
+		uint32_t hw = std::thread::hardware_concurrency();
+		count = std::max(1U, hw > 1 ? hw - 1 : 1U);
+	}
+	workers.reserve(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		workers.emplace_back([this](){
+			PROFILE_THREAD_NAME("pool worker");
+			std::unique_lock< std::mutex > lock(mutex);
+			while (true) {
+				job_cv.wait(lock, [this](){ return quit || !jobs.empty(); });
+				if (jobs.empty()) break; //only happens when quitting
+				std::function< void() > job = std::move(jobs.front());
+				jobs.pop_front();
+				running += 1;
+
+				lock.unlock();
+				{
+					PROFILE_ZONE("job");
+					job();
+				}
+				lock.lock();
+
+				running -= 1;
+				done_cv.notify_all();
+			}
+		});
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		quit = true;
+	}
+	job_cv.notify_all();
+	for (auto &worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::run(std::function< void() > const &job) {
+	{
+		std::unique_lock< std::mutex > lock(mutex);
+		jobs.emplace_back(job);
+	}
+	job_cv.notify_one();
+}
+
+void ThreadPool::wait() {
+	std::unique_lock< std::mutex > lock(mutex);
+	done_cv.wait(lock, [this](){ return jobs.empty() && running == 0; });
+}
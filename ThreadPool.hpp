@@ -0,0 +1,42 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <cstdint>
+
+/*
+ * ThreadPool runs queued jobs on a fixed set of worker threads.
+ */
+
+struct ThreadPool {
+	//spawn 'count' worker threads;
+	// count == 0 means "one per hardware thread, leaving one for the main thread":
+	ThreadPool(uint32_t count = 0);
+	//finishes all queued jobs before joining workers:
+	~ThreadPool();
+
+	ThreadPool(ThreadPool const &) = delete;
+	ThreadPool &operator=(ThreadPool const &) = delete;
+
+	//queue a job; jobs are started in the order they are queued:
+	void run(std::function< void() > const &job);
+
+	//block until every queued job has finished:
+	void wait();
+
+	uint32_t size() const { return uint32_t(workers.size()); }
+
+	//----- internals -----
+	std::vector< std::thread > workers;
+	std::deque< std::function< void() > > jobs;
+	uint32_t running = 0; //jobs currently executing
+	bool quit = false;
+
+	std::mutex mutex;
+	std::condition_variable job_cv; //signalled when a job is queued (or on quit)
+	std::condition_variable done_cv; //signalled when a job finishes
+};
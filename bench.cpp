@@ -0,0 +1,470 @@
+//bench: microbenchmarks for the game's hot paths.
+// usage: bench [--filter <substring>] [--samples <n>] [--sample-ms <ms>] [--json <out.json>] [--csv <out.csv>] [--png <file>]... [--scenario <file>]... [--replay <file>]...
+//
+// Every benchmark is deterministic (fixed seeds, synthetic inputs), warms up, then takes
+//  'samples' timed samples of enough iterations to last about 'sample-ms' each.
+// Results are printed as a table; --json writes every sample (for compare-bench.py), --csv a summary.
+// Each --scenario file (see Scenario.hpp) adds a benchmark that plays the whole scenario at 60 fps
+//  (update plus vertex generation each frame); each --replay file (see Replay.hpp) one that plays back
+//  the whole recorded game as fast as possible (after checking that it reproduces the recording).
+// (--png and --replay benchmarks are named by the file's basename, not its path.)
+
+#include "PongSim.hpp"
+#include "Replay.hpp"
+#include "Rng.hpp"
+#include "TextureAtlas.hpp"
+#include "load_save_png.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	struct Options {
+		std::string filter;
+		uint32_t samples = 20;
+		double sample_ms = 10.0;
+		double warmup_ms = 100.0;
+		std::string json;
+		std::string csv;
+		std::vector< std::string > pngs;
+		std::vector< std::string > scenarios;
+		std::vector< std::string > replays;
+	};
+
+	struct Result {
+		std::string name;
+		uint64_t iterations = 0; //per sample
+		std::vector< double > samples; //nanoseconds per iteration
+		double min = 0.0, median = 0.0, mean = 0.0, stddev = 0.0, p95 = 0.0;
+	};
+
+	//results are accumulated here so the optimizer can't discard benchmarked work:
+	volatile uint64_t sink = 0;
+
+	//time 'iterations' calls of 'fn', in nanoseconds per call:
+	double time_batch(std::function< void() > const &fn, uint64_t iterations) {
+		Clock::time_point before = Clock::now();
+		for (uint64_t i = 0; i < iterations; ++i) {
+			fn();
+		}
+		Clock::time_point after = Clock::now();
+		return std::chrono::duration< double, std::nano >(after - before).count() / double(iterations);
+	}
+
+	Result measure(Options const &options, std::string const &name, std::function< void() > const &fn) {
+		Result result;
+		result.name = name;
+
+		//warm up, while growing the batch until it lasts about a sample:
+		uint64_t iterations = 1;
+		Clock::time_point warmup_start = Clock::now();
+		while (true) {
+			double ns = time_batch(fn, iterations);
+			double batch_ms = ns * iterations * 1.0e-6;
+			double warmed_ms = std::chrono::duration< double, std::milli >(Clock::now() - warmup_start).count();
+			if (batch_ms < options.sample_ms) {
+				iterations = std::max(iterations + 1, uint64_t(iterations * std::min(10.0, options.sample_ms / std::max(batch_ms, 1.0e-3))));
+			} else if (warmed_ms >= options.warmup_ms) {
+				break;
+			}
+			if (warmed_ms >= 10.0 * options.warmup_ms) break; //very slow benchmark; take what we have
+		}
+		result.iterations = iterations;
+
+		for (uint32_t s = 0; s < options.samples; ++s) {
+			result.samples.emplace_back(time_batch(fn, iterations));
+		}
+
+		std::vector< double > sorted = result.samples;
+		std::sort(sorted.begin(), sorted.end());
+		result.min = sorted.front();
+		result.median = (sorted.size() % 2 ? sorted[sorted.size() / 2] : 0.5 * (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]));
+		double sum = 0.0;
+		for (double ns : sorted) sum += ns;
+		result.mean = sum / sorted.size();
+		double variance = 0.0;
+		for (double ns : sorted) variance += (ns - result.mean) * (ns - result.mean);
+		result.stddev = (sorted.size() > 1 ? std::sqrt(variance / (sorted.size() - 1)) : 0.0);
+		result.p95 = sorted[std::min(sorted.size() - 1, size_t(std::ceil(0.95 * sorted.size())) - 1)];
+		return result;
+	}
+
+	//a court with 'count' balls, stepped for a while so the balls are spread out and have trails:
+	std::unique_ptr< PongSim > make_sim(uint32_t count, bool fixed_point = false) {
+		Scenario scenario;
+		scenario.fixed_point = fixed_point;
+		scenario.seed = count;
+		scenario.random_balls = count - 1;
+		scenario.spawn_first = std::numeric_limits< float >::infinity(); //no new balls while benchmarking
+		std::unique_ptr< PongSim > sim(new PongSim(scenario));
+		//(stagger the balls so they aren't all in the same place)
+		for (uint32_t i = 0; i < sim->balls.size(); ++i) {
+			Ball *ball = &sim->balls[i];
+			ball->ball_velocity.y = ((i * 37) % 101) / 50.0f - 1.0f;
+			ball->alive = (i % 50) * 0.1f;
+		}
+		for (uint32_t step = 0; step < 60; ++step) {
+			sim->update(1.0f / 60.0f);
+		}
+		return sim;
+	}
+
+	//sprites from an atlas with a white sprite, as PongMode's has:
+	PongSim::Sprites make_sprites() {
+		TextureAtlas atlas(glm::uvec2(16, 16));
+		std::vector< glm::u8vec4 > white(1, glm::u8vec4(0xff, 0xff, 0xff, 0xff));
+		atlas.add("white", glm::uvec2(1, 1), white.data());
+		PongSim::Sprites sprites;
+		sprites.white = sprites.ball = sprites.paddle = atlas.lookup("white");
+		return sprites;
+	}
+
+	//a screen-like image: flat background, large regions of each player's trail color, some noise:
+	std::vector< glm::u8vec4 > make_screen(glm::uvec2 const &size, PongSim const &sim) {
+		std::vector< glm::u8vec4 > pixels(size.x * size.y, glm::u8vec4(0x17, 0x17, 0x14, 0xff));
+		uint32_t state = 12345;
+		for (uint32_t y = 0; y < size.y; ++y) {
+			for (uint32_t x = 0; x < size.x; ++x) {
+				glm::u8vec4 &px = pixels[y * size.x + x];
+				state = state * 1664525u + 1013904223u;
+				if ((x / 37 + y / 29) % 3 == 0) px = sim.player1_trail;
+				else if ((x / 37 + y / 29) % 3 == 1) px = sim.player2_trail;
+				if ((state >> 24) < 8) px = glm::u8vec4(uint8_t(state), uint8_t(state >> 8), uint8_t(state >> 16), 0xff);
+			}
+		}
+		return pixels;
+	}
+
+	//benchmark names come from file names and scenario files, so may hold anything:
+	void write_json_string(std::ostream &out, std::string const &str) {
+		out << '"';
+		for (char c : str) {
+			if (c == '"' || c == '\\') {
+				out << '\\' << c;
+			} else if (uint8_t(c) < 0x20) {
+				char escape[8];
+				std::snprintf(escape, sizeof(escape), "\\u%04x", unsigned(uint8_t(c)));
+				out << escape;
+			} else {
+				out << c;
+			}
+		}
+		out << '"';
+	}
+	void write_csv_field(std::ostream &out, std::string const &str) {
+		if (str.find_first_of(",\"\r\n") == std::string::npos) {
+			out << str;
+			return;
+		}
+		out << '"';
+		for (char c : str) {
+			if (c == '"') out << '"';
+			out << c;
+		}
+		out << '"';
+	}
+
+	//file benchmarks are named by the file's basename, so results recorded in different checkouts match:
+	std::string basename(std::string const &path) {
+		size_t slash = path.find_last_of("/\\");
+		return (slash == std::string::npos ? path : path.substr(slash + 1));
+	}
+
+	void write_json(std::string const &filename, std::vector< Result > const &results) {
+		std::ofstream out(filename, std::ios::binary);
+		if (!out) throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+		out << "{\n\t\"format\": \"bench-1\",\n";
+		out << "\t\"build\": \"" << __DATE__ << " " << __TIME__ << "\",\n";
+	#if defined(_MSC_VER)
+		out << "\t\"compiler\": \"msvc " << _MSC_VER << "\",\n";
+	#elif defined(__VERSION__)
+		out << "\t\"compiler\": ";
+		write_json_string(out, __VERSION__);
+		out << ",\n";
+	#endif
+		out << "\t\"results\": [";
+		out.precision(9);
+		for (size_t i = 0; i < results.size(); ++i) {
+			Result const &r = results[i];
+			out << (i ? ",\n" : "\n");
+			out << "\t\t{\"name\": ";
+			write_json_string(out, r.name);
+			out << ", \"iterations\": " << r.iterations
+			    << ", \"min_ns\": " << r.min << ", \"median_ns\": " << r.median << ", \"mean_ns\": " << r.mean
+			    << ", \"stddev_ns\": " << r.stddev << ", \"p95_ns\": " << r.p95 << ", \"samples_ns\": [";
+			for (size_t s = 0; s < r.samples.size(); ++s) {
+				out << (s ? ", " : "") << r.samples[s];
+			}
+			out << "]}";
+		}
+		out << "\n\t]\n}\n";
+		if (!out) throw std::runtime_error("Failed to write '" + filename + "'.");
+	}
+
+	void write_csv(std::string const &filename, std::vector< Result > const &results) {
+		std::ofstream out(filename, std::ios::binary);
+		if (!out) throw std::runtime_error("Failed to open '" + filename + "' for writing.");
+		out << "name,iterations,samples,min_ns,median_ns,mean_ns,stddev_ns,p95_ns\n";
+		out.precision(9);
+		for (auto const &r : results) {
+			write_csv_field(out, r.name);
+			out << ',' << r.iterations << ',' << r.samples.size() << ',' << r.min << ',' << r.median
+			    << ',' << r.mean << ',' << r.stddev << ',' << r.p95 << '\n';
+		}
+		if (!out) throw std::runtime_error("Failed to write '" + filename + "'.");
+	}
+}
+
+int main(int argc, char **argv) {
+	Options options;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		auto value = [&]() -> std::string {
+			if (i + 1 >= argc) {
+				std::cerr << "Missing value for '" << arg << "'." << std::endl;
+				std::exit(1);
+			}
+			return argv[++i];
+		};
+		if (arg == "--filter") options.filter = value();
+		else if (arg == "--samples") options.samples = std::max(1, std::atoi(value().c_str()));
+		else if (arg == "--sample-ms") options.sample_ms = std::max(0.1, std::atof(value().c_str()));
+		else if (arg == "--json") options.json = value();
+		else if (arg == "--csv") options.csv = value();
+		else if (arg == "--png") options.pngs.emplace_back(value());
+		else if (arg == "--scenario") options.scenarios.emplace_back(value());
+		else if (arg == "--replay") options.replays.emplace_back(value());
+		else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--filter <substring>] [--samples <n>] [--sample-ms <ms>] [--json <out.json>] [--csv <out.csv>] [--png <file>]... [--scenario <file>]... [--replay <file>]..." << std::endl;
+			return 1;
+		}
+	}
+
+	try {
+		//---- benchmark registry ----
+		//each entry's setup runs only if the benchmark passes the filter, and returns the function to time:
+		std::vector< std::pair< std::string, std::function< std::function< void() >() > > > benchmarks;
+		auto add = [&](std::string const &name, std::function< std::function< void() >() > const &setup) {
+			benchmarks.emplace_back(name, setup);
+		};
+
+		for (uint32_t count : {1U, 6U, 100U, 10000U}) {
+			add("update/" + std::to_string(count), [count]() {
+				std::shared_ptr< PongSim > sim = make_sim(count);
+				return [sim]() { sim->update(1.0f / 60.0f); };
+			});
+		}
+		for (uint32_t count : {6U, 100U, 10000U}) {
+			add("update-fixed/" + std::to_string(count), [count]() {
+				std::shared_ptr< PongSim > sim = make_sim(count, true);
+				return [sim]() { sim->update(1.0f / 60.0f); };
+			});
+		}
+		for (uint32_t count : {6U, 100U, 10000U}) {
+			add("trails/" + std::to_string(count), [count]() {
+				std::shared_ptr< PongSim > sim = make_sim(count);
+				return [sim]() { sim->update_trails(1.0f / 60.0f); };
+			});
+		}
+		for (uint32_t count : {1U, 6U, 100U, 10000U}) {
+			add("vertices/" + std::to_string(count), [count]() {
+				std::shared_ptr< PongSim > sim = make_sim(count);
+				PongSim::Sprites sprites = make_sprites();
+				return [sim, sprites]() {
+					//(a fresh vector each time, as in PongMode::draw)
+					std::vector< PongSim::Vertex > vertices;
+					sink = sink + sim->build_vertices(sprites, &vertices) + vertices.size();
+				};
+			});
+		}
+		for (uint32_t count : {6U, 100U, 10000U}) {
+			add("snapshot/" + std::to_string(count), [count]() {
+				std::shared_ptr< PongSim > sim = make_sim(count);
+				std::shared_ptr< std::vector< uint8_t > > buffer = std::make_shared< std::vector< uint8_t > >();
+				return [sim, buffer]() {
+					//(clear keeps the buffer's capacity, as a save-state ring would)
+					buffer->clear();
+					sim->save_state(buffer.get());
+					sink = sink + buffer->size();
+				};
+			});
+			add("restore/" + std::to_string(count), [count]() {
+				std::shared_ptr< PongSim > sim = make_sim(count);
+				std::shared_ptr< std::vector< uint8_t > > buffer = std::make_shared< std::vector< uint8_t > >();
+				sim->save_state(buffer.get());
+				return [sim, buffer]() {
+					sim->restore_state(buffer->data(), buffer->size());
+					sink = sink + sim->balls.size();
+				};
+			});
+		}
+		//a worst-case rollback (see Rollback.hpp): restore the state from 8 ticks back, then re-simulate
+		// (saving each tick's state again, as RollbackSession does):
+		for (uint32_t count : {6U, 100U, 1000U}) {
+			add("rollback/8/" + std::to_string(count), [count]() {
+				std::shared_ptr< PongSim > sim = make_sim(count);
+				std::shared_ptr< std::vector< std::vector< uint8_t > > > states = std::make_shared< std::vector< std::vector< uint8_t > > >(8);
+				for (std::vector< uint8_t > &state : *states) {
+					sim->save_state(&state);
+				}
+				return [sim, states]() {
+					sim->restore_state((*states)[0].data(), (*states)[0].size());
+					for (std::vector< uint8_t > &state : *states) {
+						state.clear();
+						sim->save_state(&state);
+						sim->update(1.0f / 60.0f);
+					}
+					sink = sink + sim->balls.size();
+				};
+			});
+		}
+		//random numbers (per-sim generators must be cheap, since every match has one):
+		add("rng/1000", []() {
+			std::shared_ptr< Rng > rng = std::make_shared< Rng >(1);
+			return [rng]() {
+				uint64_t sum = 0;
+				for (uint32_t i = 0; i < 1000; ++i) sum += rng->next();
+				sink = sink + sum;
+			};
+		});
+		add("rng/split", []() {
+			std::shared_ptr< Rng > rng = std::make_shared< Rng >(1);
+			return [rng]() {
+				sink = sink + rng->split().next();
+			};
+		});
+		for (glm::uvec2 size : {glm::uvec2(640, 480), glm::uvec2(1920, 1080)}) {
+			std::string dims = std::to_string(size.x) + "x" + std::to_string(size.y);
+			add("score_turf/" + dims, [size]() {
+				std::shared_ptr< PongSim > sim = make_sim(1);
+				std::shared_ptr< std::vector< glm::u8vec4 > > pixels = std::make_shared< std::vector< glm::u8vec4 > >(make_screen(size, *sim));
+				return [sim, pixels]() {
+					uint32_t p1 = 0, p2 = 0;
+					sim->score_turf(pixels->data(), pixels->size(), &p1, &p2);
+					sink = sink + p1 + p2;
+				};
+			});
+		}
+
+		//png i/o on synthetic screen images (plus any --png files):
+		std::string const temp_png = "bench-temp.png";
+		for (glm::uvec2 size : {glm::uvec2(256, 256), glm::uvec2(640, 480)}) {
+			std::string dims = std::to_string(size.x) + "x" + std::to_string(size.y);
+			add("save_png/" + dims, [size, temp_png]() {
+				std::shared_ptr< PongSim > sim = make_sim(1);
+				std::shared_ptr< std::vector< glm::u8vec4 > > pixels = std::make_shared< std::vector< glm::u8vec4 > >(make_screen(size, *sim));
+				return [size, pixels, temp_png]() {
+					save_png(temp_png, size, pixels->data(), LowerLeftOrigin);
+				};
+			});
+			add("load_png/" + dims, [size, temp_png]() {
+				std::shared_ptr< PongSim > sim = make_sim(1);
+				std::vector< glm::u8vec4 > pixels = make_screen(size, *sim);
+				save_png(temp_png, size, pixels.data(), LowerLeftOrigin);
+				//decode from memory, so file system caching doesn't muddy the numbers:
+				std::ifstream in(temp_png, std::ios::binary);
+				std::shared_ptr< std::vector< char > > png = std::make_shared< std::vector< char > >(std::istreambuf_iterator< char >(in), std::istreambuf_iterator< char >());
+				return [png]() {
+					glm::uvec2 loaded_size;
+					std::vector< glm::u8vec4 > data;
+					load_png(png->data(), png->size(), "bench", &loaded_size, &data, LowerLeftOrigin);
+					sink = sink + data.size();
+				};
+			});
+		}
+		for (auto const &filename : options.pngs) {
+			add("load_png/" + basename(filename), [filename]() {
+				std::ifstream in(filename, std::ios::binary);
+				if (!in) throw std::runtime_error("Failed to open '" + filename + "'.");
+				std::shared_ptr< std::vector< char > > png = std::make_shared< std::vector< char > >(std::istreambuf_iterator< char >(in), std::istreambuf_iterator< char >());
+				return [png, filename]() {
+					glm::uvec2 loaded_size;
+					std::vector< glm::u8vec4 > data;
+					load_png(png->data(), png->size(), filename, &loaded_size, &data, LowerLeftOrigin);
+					sink = sink + data.size();
+				};
+			});
+		}
+
+		//whole scenarios:
+		for (auto const &filename : options.scenarios) {
+			std::shared_ptr< Scenario > scenario = std::make_shared< Scenario >();
+			scenario->load(filename);
+			add("scenario/" + scenario->name, [scenario]() {
+				PongSim::Sprites sprites = make_sprites();
+				return [scenario, sprites]() {
+					PongSim sim(*scenario);
+					std::vector< PongSim::Vertex > vertices;
+					uint32_t frames = uint32_t(std::ceil(scenario->duration * 60.0f));
+					for (uint32_t frame = 0; frame < frames; ++frame) {
+						sim.update(1.0f / 60.0f);
+						vertices.clear();
+						sink = sink + sim.build_vertices(sprites, &vertices);
+					}
+					sink = sink + sim.balls.size();
+				};
+			});
+		}
+
+		//recorded games:
+		for (auto const &filename : options.replays) {
+			add("replay/" + basename(filename), [filename]() {
+				std::shared_ptr< Replay > replay = std::make_shared< Replay >(filename);
+				{ //a replay that doesn't reproduce its game would be measuring something else:
+					PongSim sim(replay->scenario);
+					for (uint32_t i = 0; i < replay->steps.size(); ++i) {
+						replay->apply(i, sim);
+					}
+					std::string diff = replay->check_end(sim);
+					if (!diff.empty()) throw std::runtime_error("Replay '" + filename + "' diverged from the recording:" + diff);
+				}
+				return [replay]() {
+					PongSim sim(replay->scenario);
+					for (uint32_t i = 0; i < replay->steps.size(); ++i) {
+						replay->apply(i, sim);
+					}
+					sink = sink + sim.balls.size();
+				};
+			});
+		}
+
+		//---- run ----
+		std::vector< Result > results;
+		std::cout << std::left << std::setw(24) << "benchmark" << std::right
+		          << std::setw(10) << "iters" << std::setw(14) << "min ns" << std::setw(14) << "median ns"
+		          << std::setw(14) << "mean ns" << std::setw(10) << "stddev" << std::endl;
+		for (auto const &benchmark : benchmarks) {
+			if (benchmark.first.find(options.filter) == std::string::npos) continue;
+			std::function< void() > fn = benchmark.second();
+			results.emplace_back(measure(options, benchmark.first, fn));
+			Result const &r = results.back();
+			std::cout << std::left << std::setw(24) << r.name << std::right << std::fixed << std::setprecision(1)
+			          << std::setw(10) << r.iterations << std::setw(14) << r.min << std::setw(14) << r.median
+			          << std::setw(14) << r.mean << std::setw(9) << (r.mean > 0.0 ? 100.0 * r.stddev / r.mean : 0.0) << "%" << std::endl;
+		}
+		std::remove(temp_png.c_str());
+
+		if (!options.json.empty()) write_json(options.json, results);
+		if (!options.csv.empty()) write_csv(options.csv, results);
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,311 @@
+#!/usr/bin/env python3
+
+#compare-bench.py: performance regression gate for the 'bench' microbenchmarks (see bench.cpp).
+#
+#record a baseline (runs dist/bench; the baseline's version number is bumped each time it is recorded):
+#  ./compare-bench.py record [--bench dist/bench] [--baseline bench-baseline.json] [--runs N] [-- <bench options>]
+#check the current build against the baseline (exits with status 1 if anything regressed):
+#  ./compare-bench.py check [--bench dist/bench] [--baseline bench-baseline.json] [--runs N] [-- <bench options>]
+#compare two existing 'bench --json' result files (or baselines):
+#  ./compare-bench.py compare <old.json> <new.json>
+#
+#both 'record' and 'check' take '--json <file>' (repeatable) to use existing results instead of running the bench.
+#
+#a benchmark regresses if its median slowed by more than its threshold *and* a one-sided Mann-Whitney U test
+# over the per-sample timings says the slowdown is significant (p < alpha). Both conditions are needed: with
+# enough samples tiny, irrelevant slowdowns become significant, and noisy benchmarks move by a lot at random.
+#
+#thresholds live in the baseline file, so they are versioned along with the numbers they guard:
+# "default_threshold_pct" applies to everything, and "thresholds_pct" maps name prefixes to tighter (or looser)
+# thresholds -- the longest matching prefix wins. They are kept when the baseline is re-recorded.
+#
+#timings only mean something on the machine they were taken on; 'check' warns if the baseline came from elsewhere.
+
+import argparse
+import datetime
+import json
+import math
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+
+BASELINE_FORMAT = "bench-baseline-1"
+RESULTS_FORMAT = "bench-1"
+
+DEFAULT_THRESHOLD_PCT = 5.0
+#the per-frame simulation is the hot path we care most about:
+DEFAULT_THRESHOLDS_PCT = { "update/": 3.0 }
+DEFAULT_ALPHA = 0.01
+
+def default_bench():
+	return os.path.join("dist", "bench.exe" if os.name == "nt" else "bench")
+
+#------------------------------------------------
+#loading / running
+
+#returns { name : [samples_ns] } plus the file's metadata:
+def load_results(filename):
+	with open(filename, 'r') as f:
+		try:
+			data = json.load(f)
+		except ValueError as e:
+			raise RuntimeError("'" + filename + "' is not valid JSON (" + str(e) + ").")
+	if data.get("format") not in (RESULTS_FORMAT, BASELINE_FORMAT):
+		raise RuntimeError("'" + filename + "' is not a bench result or baseline file (format is " + repr(data.get("format")) + ").")
+	samples = {}
+	for result in data["results"]:
+		samples.setdefault(result["name"], []).extend(result["samples_ns"])
+	return samples, data
+
+#run the bench 'runs' times, pooling samples (separate processes catch some variance one run can't -- e.g. heap layout):
+def run_bench(bench, runs, bench_args):
+	if not os.path.exists(bench):
+		raise RuntimeError("No bench executable at '" + bench + "' (build it with 'jam bench', or pass --bench).")
+	pooled = {}
+	meta = {}
+	for run in range(runs):
+		fd, filename = tempfile.mkstemp(suffix=".json", prefix="bench-")
+		os.close(fd)
+		try:
+			print("running " + " ".join([bench] + bench_args) + (" (" + str(run + 1) + "/" + str(runs) + ")" if runs > 1 else ""), file=sys.stderr)
+			subprocess.run([bench, "--json", filename] + bench_args, check=True, stdout=subprocess.DEVNULL)
+			samples, meta = load_results(filename)
+		finally:
+			os.remove(filename)
+		for name, values in samples.items():
+			pooled.setdefault(name, []).extend(values)
+	return pooled, meta
+
+def gather(args):
+	if args.json:
+		pooled = {}
+		meta = {}
+		for filename in args.json:
+			samples, meta = load_results(filename)
+			for name, values in samples.items():
+				pooled.setdefault(name, []).extend(values)
+		return pooled, meta
+	return run_bench(args.bench, args.runs, args.bench_args)
+
+#------------------------------------------------
+#statistics
+
+def median(values):
+	s = sorted(values)
+	n = len(s)
+	return s[n // 2] if n % 2 else 0.5 * (s[n // 2 - 1] + s[n // 2])
+
+#ranks (1-based, ties get their average rank) of the pooled values:
+def ranks(values):
+	order = sorted(range(len(values)), key=lambda i: values[i])
+	r = [0.0] * len(values)
+	i = 0
+	while i < len(order):
+		j = i
+		while j + 1 < len(order) and values[order[j + 1]] == values[order[i]]:
+			j += 1
+		for k in range(i, j + 1):
+			r[order[k]] = 0.5 * (i + j) + 1.0
+		i = j + 1
+	return r
+
+#P(U >= u) for the Mann-Whitney U statistic with sample sizes m, n and no ties (exact; fine for small samples):
+def exact_upper_tail(u, m, n):
+	#counts[i][j][k]: number of arrangements of i x's and j y's with U = k
+	max_u = m * n
+	prev = [[1] + [0] * max_u for _ in range(n + 1)] #i = 0: U is always 0
+	for i in range(1, m + 1):
+		cur = [[0] * (max_u + 1) for _ in range(n + 1)]
+		cur[0][0] = 1
+		for j in range(1, n + 1):
+			#the largest value is either an x (beating all j y's) or a y:
+			for k in range(max_u + 1):
+				c = cur[j - 1][k]
+				if k >= j:
+					c += prev[j][k - j]
+				cur[j][k] = c
+		prev = cur
+	counts = prev[n]
+	total = sum(counts)
+	k = int(math.ceil(u - 1e-9))
+	return sum(counts[k:]) / total
+
+#one-sided Mann-Whitney U test: p-value for "values in 'new' tend to be larger than in 'old'":
+def mann_whitney_greater(old, new):
+	m = len(new)
+	n = len(old)
+	if m == 0 or n == 0:
+		return 1.0
+	pooled = new + old
+	r = ranks(pooled)
+	u = sum(r[:m]) - m * (m + 1) / 2.0
+	ties = len(set(pooled)) != len(pooled)
+	if not ties and m <= 25 and n <= 25:
+		return exact_upper_tail(u, m, n)
+	#normal approximation, with tie and continuity corrections:
+	mean_u = m * n / 2.0
+	N = m + n
+	tie_sum = 0.0
+	counts = {}
+	for v in pooled:
+		counts[v] = counts.get(v, 0) + 1
+	for t in counts.values():
+		tie_sum += t * t * t - t
+	var_u = m * n / 12.0 * ((N + 1) - tie_sum / (N * (N - 1)))
+	if var_u <= 0.0:
+		return 1.0
+	z = (u - mean_u - 0.5) / math.sqrt(var_u)
+	return 0.5 * math.erfc(z / math.sqrt(2.0))
+
+#------------------------------------------------
+#comparison
+
+def format_ns(ns):
+	if ns >= 1e9: return "%.3f s" % (ns * 1e-9)
+	if ns >= 1e6: return "%.3f ms" % (ns * 1e-6)
+	if ns >= 1e3: return "%.3f us" % (ns * 1e-3)
+	return "%.1f ns" % ns
+
+def threshold_for(name, baseline_meta):
+	threshold = baseline_meta.get("default_threshold_pct", DEFAULT_THRESHOLD_PCT)
+	best = -1
+	for prefix, pct in baseline_meta.get("thresholds_pct", {}).items():
+		if name.startswith(prefix) and len(prefix) > best:
+			threshold = pct
+			best = len(prefix)
+	return threshold
+
+#prints a table and returns the list of regressions, as (name, description):
+def compare(old, new, baseline_meta, alpha):
+	rows = []
+	regressions = []
+	#(in the order the bench ran them, then anything that didn't run)
+	for name in list(new.keys()) + [name for name in old.keys() if name not in new]:
+		if name not in new:
+			rows.append((name, format_ns(median(old[name])), "-", "", "", "missing (not run)"))
+			continue
+		if name not in old:
+			rows.append((name, "-", format_ns(median(new[name])), "", "", "new (no baseline)"))
+			continue
+		old_median = median(old[name])
+		new_median = median(new[name])
+		change = 100.0 * (new_median - old_median) / old_median if old_median > 0.0 else 0.0
+		threshold = threshold_for(name, baseline_meta)
+		p_slower = mann_whitney_greater(old[name], new[name])
+		p_faster = mann_whitney_greater(new[name], old[name])
+		if change > threshold and p_slower < alpha:
+			verdict = "REGRESSION"
+			regressions.append((name, "median %s -> %s (%+.1f%%, threshold %.1f%%, p=%.2g)" % (format_ns(old_median), format_ns(new_median), change, threshold, p_slower)))
+		elif change < -threshold and p_faster < alpha:
+			verdict = "faster"
+		elif p_slower < alpha or p_faster < alpha:
+			verdict = "within threshold"
+		else:
+			verdict = "no significant change"
+		p = p_slower if change >= 0.0 else p_faster
+		rows.append((name, format_ns(old_median), format_ns(new_median), "%+.1f%%" % change, "%.2g" % p, verdict))
+
+	header = ("benchmark", "baseline", "current", "change", "p", "")
+	widths = [max(len(row[c]) for row in rows + [header]) for c in range(len(header))]
+	def line(row):
+		cells = [row[0].ljust(widths[0])] + [row[c].rjust(widths[c]) for c in range(1, 5)] + [row[5]]
+		return "  ".join(cells).rstrip()
+	print(line(header))
+	for row in rows:
+		print(line(row))
+	return regressions
+
+def check_machine(baseline_meta):
+	host = baseline_meta.get("host")
+	if host and host != platform.node():
+		print("warning: baseline was recorded on '" + host + "', this is '" + platform.node() + "'; timings may not be comparable.", file=sys.stderr)
+
+#------------------------------------------------
+#commands
+
+def cmd_record(args):
+	samples, meta = gather(args)
+	if not samples:
+		raise RuntimeError("No benchmark results to record.")
+	previous = {}
+	if os.path.exists(args.baseline):
+		_, previous = load_results(args.baseline)
+	baseline = {
+		"format": BASELINE_FORMAT,
+		"version": previous.get("version", 0) + 1,
+		"recorded": datetime.datetime.now().isoformat(timespec="seconds"),
+		"host": platform.node(),
+		"machine": platform.machine() + " " + platform.system(),
+		"build": meta.get("build", ""),
+		"compiler": meta.get("compiler", ""),
+		"default_threshold_pct": previous.get("default_threshold_pct", DEFAULT_THRESHOLD_PCT),
+		"thresholds_pct": previous.get("thresholds_pct", DEFAULT_THRESHOLDS_PCT),
+		"results": [{ "name": name, "median_ns": median(samples[name]), "samples_ns": samples[name] } for name in samples.keys()],
+	}
+	with open(args.baseline, 'w') as f:
+		json.dump(baseline, f, indent='\t')
+		f.write('\n')
+	print("wrote " + args.baseline + " (version " + str(baseline["version"]) + ", " + str(len(samples)) + " benchmarks)")
+	return 0
+
+def cmd_check(args):
+	if not os.path.exists(args.baseline):
+		raise RuntimeError("No baseline at '" + args.baseline + "' (record one with 'compare-bench.py record').")
+	old, baseline_meta = load_results(args.baseline)
+	check_machine(baseline_meta)
+	new, _ = gather(args)
+	print("baseline: " + args.baseline + " version " + str(baseline_meta.get("version", "?")) + ", recorded " + baseline_meta.get("recorded", "?"))
+	return report(compare(old, new, baseline_meta, args.alpha))
+
+def cmd_compare(args):
+	old, old_meta = load_results(args.old)
+	new, _ = load_results(args.new)
+	return report(compare(old, new, old_meta, args.alpha))
+
+def report(regressions):
+	if not regressions:
+		print("\nOK: no regressions.")
+		return 0
+	print("\nFAILED: " + str(len(regressions)) + " benchmark(s) regressed:")
+	for name, description in regressions:
+		print("  " + name + ": " + description)
+	return 1
+
+def main():
+	#everything after '--' is passed to the bench:
+	argv = sys.argv[1:]
+	bench_args = []
+	if "--" in argv:
+		bench_args = argv[argv.index("--") + 1:]
+		argv = argv[:argv.index("--")]
+
+	parser = argparse.ArgumentParser(description="Record and check benchmark baselines.")
+	sub = parser.add_subparsers(dest="command")
+	for name in ("record", "check"):
+		p = sub.add_parser(name)
+		p.add_argument("--bench", default=default_bench(), help="bench executable (default: %(default)s)")
+		p.add_argument("--baseline", default="bench-baseline.json", help="baseline file (default: %(default)s)")
+		p.add_argument("--runs", type=int, default=1, help="bench runs to pool samples over (default: %(default)s)")
+		p.add_argument("--json", action="append", help="use these 'bench --json' results instead of running the bench")
+		p.add_argument("--alpha", type=float, default=DEFAULT_ALPHA, help="significance level (default: %(default)s)")
+	p = sub.add_parser("compare")
+	p.add_argument("old")
+	p.add_argument("new")
+	p.add_argument("--alpha", type=float, default=DEFAULT_ALPHA, help="significance level (default: %(default)s)")
+
+	args = parser.parse_args(argv)
+	args.bench_args = bench_args
+	try:
+		if args.command == "record": return cmd_record(args)
+		if args.command == "check": return cmd_check(args)
+		if args.command == "compare": return cmd_compare(args)
+		parser.print_help()
+		return 2
+	except (RuntimeError, OSError, ValueError, subprocess.CalledProcessError) as e:
+		print("error: " + str(e), file=sys.stderr)
+		return 2
+
+if __name__ == "__main__":
+	sys.exit(main())
@@ -1,62 +1,302 @@
 #include "gl_compile_program.hpp"
 
+#include "hash.hpp"
+
+#include <SDL.h>
+
 #include <vector>
 #include <string>
 #include <stdexcept>
 #include <iostream>
+#include <fstream>
+#include <iterator>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+std::string gl_program_cache_dir;
+
+//----- program binary cache -----
+namespace {
+
+struct ProgramBinaryCache {
+	bool enabled = false;
+	uint64_t driver_hash = 0;
+
+	//on-disk header, followed by the binary itself:
+	struct Header {
+		char magic[4]; //"glpb"
+		GLenum format;
+		uint64_t key;
+	};
+
+	ProgramBinaryCache() {
+		if (gl_program_cache_dir == "-") return;
+		if (!gl_caps.ARB_get_program_binary) return;
+
+		//some drivers advertise the extension but support no binary formats:
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		if (formats <= 0) return;
+
+		if (gl_program_cache_dir.empty()) {
+			char *pref = SDL_GetPrefPath("15-466", "game0");
+			if (!pref) return;
+			gl_program_cache_dir = pref;
+			SDL_free(pref);
+		}
+
+		//binaries are only valid for the driver that produced them:
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+			char const *str = reinterpret_cast< char const * >(glGetString(name));
+			if (str) driver_hash = hash_fnv1a(str, std::strlen(str), driver_hash);
+			driver_hash = hash_fnv1a("\n", 1, driver_hash);
+		}
+
+		enabled = true;
+	}
+
+	uint64_t key(std::string const &vertex_shader_source, std::string const &fragment_shader_source) const {
+		uint64_t h = hash_fnv1a(vertex_shader_source, driver_hash);
+		h = hash_fnv1a("\0", 1, h);
+		return hash_fnv1a(fragment_shader_source, h);
+	}
+
+	std::string filename(uint64_t key) const {
+		char hex[17];
+		std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)key);
+		return gl_program_cache_dir + "program-" + hex + ".bin";
+	}
+
+	//start loading a cached binary into 'program'; returns false on cache miss.
+	// (whether the driver accepted it is only known once link status is checked)
+	bool load(uint64_t key, GLuint program) const {
+		std::ifstream file(filename(key), std::ios::binary);
+		if (!file) return false;
+		Header header;
+		if (!file.read(reinterpret_cast< char * >(&header), sizeof(header))
+		 || std::memcmp(header.magic, "glpb", 4) != 0
+		 || header.key != key) {
+			return false;
+		}
+		std::vector< char > binary((std::istreambuf_iterator< char >(file)), std::istreambuf_iterator< char >());
+		glProgramBinary(program, header.format, binary.data(), GLsizei(binary.size()));
+		return true;
+	}
+
+	//a cached binary was rejected (e.g., driver updated without changing its version string):
+	void discard(uint64_t key) const {
+		std::remove(filename(key).c_str());
+	}
+
+	//call before linking so the driver keeps the binary around:
+	void prepare(GLuint program) const {
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	void store(uint64_t key, GLuint program) const {
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) return;
+		std::vector< char > binary(length);
+		Header header;
+		std::memcpy(header.magic, "glpb", 4);
+		header.key = key;
+		glGetProgramBinary(program, length, &length, &header.format, binary.data());
+
+		//write to a temporary file and rename, so a crash never leaves a truncated binary:
+		std::string final_name = filename(key);
+		std::string temp_name = final_name + ".tmp";
+		{
+			std::ofstream file(temp_name, std::ios::binary);
+			file.write(reinterpret_cast< char const * >(&header), sizeof(header));
+			file.write(binary.data(), length);
+			if (!file) {
+				std::cerr << "NOTE: failed to write program binary cache '" << temp_name << "'." << std::endl;
+				return;
+			}
+		}
+		std::remove(final_name.c_str()); //(rename won't replace on windows)
+		std::rename(temp_name.c_str(), final_name.c_str());
+	}
+};
+
+ProgramBinaryCache const &program_binary_cache() {
+	//created on first use, when a GL context is known to exist:
+	static ProgramBinaryCache cache;
+	return cache;
+}
+
+double now() {
+	static auto const start = std::chrono::high_resolution_clock::now();
+	return std::chrono::duration< double >(std::chrono::high_resolution_clock::now() - start).count();
+}
 
-static GLuint gl_compile_shader(GLenum type, std::string const &source) {
+} //namespace
+
+//issue compile commands without checking status:
+static GLuint gl_start_shader(GLenum type, std::string const &source) {
 	GLuint shader = glCreateShader(type);
 	GLchar const *str = source.c_str();
 	GLint length = GLint(source.size());
 	glShaderSource(shader, 1, &str, &length);
 	glCompileShader(shader);
+	return shader;
+}
+
+//check compile status (blocks until compiled), printing the log and throwing on error:
+static void gl_check_shader(GLuint shader, std::string const &name) {
 	GLint compile_status = GL_FALSE;
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_status);
 	if (compile_status != GL_TRUE) {
-		std::cerr << "Failed to compile shader." << std::endl;
+		std::cerr << "Failed to compile shader for '" << name << "'." << std::endl;
 		GLint info_log_length = 0;
 		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
 		std::vector< GLchar > info_log(info_log_length, 0);
 		GLsizei length = 0;
 		glGetShaderInfoLog(shader, GLint(info_log.size()), &length, &info_log[0]);
 		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
-		glDeleteShader(shader);
 		throw std::runtime_error("Failed to compile shader.");
 	}
-	return shader;
 }
 
-GLuint gl_compile_program(
-	std::string const &vertex_shader_source,
-	std::string const &fragment_shader_source
-	) {
+//issue compile+link commands for a program from source:
+static void gl_start_program(GLProgramBatch::Pending &p) {
+	p.vertex_shader = gl_start_shader(GL_VERTEX_SHADER, p.vertex_shader_source);
+	p.fragment_shader = gl_start_shader(GL_FRAGMENT_SHADER, p.fragment_shader_source);
 
-	GLuint vertex_shader = gl_compile_shader(GL_VERTEX_SHADER, vertex_shader_source);
-	GLuint fragment_shader = gl_compile_shader(GL_FRAGMENT_SHADER, fragment_shader_source);
+	glAttachShader(p.program, p.vertex_shader);
+	glAttachShader(p.program, p.fragment_shader);
 
-	GLuint program = glCreateProgram();
-	glAttachShader(program, vertex_shader);
-	glAttachShader(program, fragment_shader);
+	ProgramBinaryCache const &cache = program_binary_cache();
+	if (cache.enabled) cache.prepare(p.program);
 
-	//shaders are reference counted so this makes sure they are freed after program is deleted:
-	glDeleteShader(vertex_shader);
-	glDeleteShader(fragment_shader);
+	glLinkProgram(p.program);
+}
+
+GLProgramBatch::GLProgramBatch() {
+	//let the driver pick how many compiler threads to use (only needs doing once):
+	static bool threads_set = false;
+	if (!threads_set && gl_caps.KHR_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+	threads_set = true;
+}
+
+GLProgramBatch::~GLProgramBatch() {
+	for (auto &p : pending) {
+		if (p.claimed) continue;
+		glDeleteShader(p.vertex_shader);
+		glDeleteShader(p.fragment_shader);
+		glDeleteProgram(p.program);
+	}
+}
+
+uint32_t GLProgramBatch::submit(std::string const &name, std::string const &vertex_shader_source, std::string const &fragment_shader_source) {
+	pending.emplace_back();
+	Pending &p = pending.back();
+	p.name = name;
+	p.vertex_shader_source = vertex_shader_source;
+	p.fragment_shader_source = fragment_shader_source;
+	p.submitted_at = now();
+
+	p.program = glCreateProgram();
+
+	ProgramBinaryCache const &cache = program_binary_cache();
+	if (cache.enabled) {
+		p.key = cache.key(vertex_shader_source, fragment_shader_source);
+		p.from_cache = cache.load(p.key, p.program);
+	}
+	if (!p.from_cache) {
+		gl_start_program(p);
+	}
+
+	p.submit_time = float(now() - p.submitted_at);
+	return uint32_t(pending.size() - 1);
+}
+
+bool GLProgramBatch::ready(uint32_t index) const {
+	Pending const &p = pending.at(index);
+	if (p.claimed || !gl_caps.KHR_parallel_shader_compile) return true;
+	GLint complete = GL_FALSE;
+	glGetProgramiv(p.program, GL_COMPLETION_STATUS_KHR, &complete);
+	return complete == GL_TRUE;
+}
+
+GLuint GLProgramBatch::get(uint32_t index) {
+	Pending &p = pending.at(index);
+	if (p.claimed) return p.program;
+
+	double before = now();
 
-	//link the shader program and throw errors if linking fails:
-	glLinkProgram(program);
 	GLint link_status = GL_FALSE;
-	glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+	glGetProgramiv(p.program, GL_LINK_STATUS, &link_status);
+
+	ProgramBinaryCache const &cache = program_binary_cache();
+	if (link_status != GL_TRUE && p.from_cache) {
+		//stale cached binary; fall back to compiling from source:
+		cache.discard(p.key);
+		p.from_cache = false;
+		glDeleteProgram(p.program);
+		p.program = glCreateProgram();
+		gl_start_program(p);
+		glGetProgramiv(p.program, GL_LINK_STATUS, &link_status);
+	}
+
 	if (link_status != GL_TRUE) {
-		std::cerr << "Failed to link shader program." << std::endl;
+		//report shader errors first, since they are the usual cause of link failure:
+		gl_check_shader(p.vertex_shader, p.name);
+		gl_check_shader(p.fragment_shader, p.name);
+
+		std::cerr << "Failed to link shader program '" << p.name << "'." << std::endl;
 		GLint info_log_length = 0;
-		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_log_length);
+		glGetProgramiv(p.program, GL_INFO_LOG_LENGTH, &info_log_length);
 		std::vector< GLchar > info_log(info_log_length, 0);
 		GLsizei length = 0;
-		glGetProgramInfoLog(program, GLint(info_log.size()), &length, &info_log[0]);
+		glGetProgramInfoLog(p.program, GLint(info_log.size()), &length, &info_log[0]);
 		std::cerr << "Info log: " << std::string(info_log.begin(), info_log.begin() + length);
 		throw std::runtime_error("failed to link program");
 	}
 
-	return program;
+	//shaders are reference counted so this makes sure they are freed after program is deleted:
+	if (p.vertex_shader) glDeleteShader(p.vertex_shader);
+	if (p.fragment_shader) glDeleteShader(p.fragment_shader);
+	p.vertex_shader = p.fragment_shader = 0;
+
+	if (cache.enabled && !p.from_cache) cache.store(p.key, p.program);
+
+	double after = now();
+	p.wait_time = float(after - before);
+	p.total_time = float(after - p.submitted_at);
+	p.claimed = true;
+
+	//sources are no longer needed:
+	p.vertex_shader_source.clear();
+	p.vertex_shader_source.shrink_to_fit();
+	p.fragment_shader_source.clear();
+	p.fragment_shader_source.shrink_to_fit();
+
+	return p.program;
+}
+
+void GLProgramBatch::report(std::ostream &to) const {
+	for (auto const &p : pending) {
+		to << "  program '" << p.name << "'" << (p.from_cache ? " (cached binary)" : "")
+		   << ": submit " << p.submit_time * 1000.0f << "ms";
+		if (p.claimed) {
+			to << ", waited " << p.wait_time * 1000.0f << "ms, ready after " << p.total_time * 1000.0f << "ms";
+		} else {
+			to << ", not yet claimed";
+		}
+		to << "\n";
+	}
+	to.flush();
+}
+
+GLuint gl_compile_program(
+	std::string const &vertex_shader_source,
+	std::string const &fragment_shader_source
+	) {
+	GLProgramBatch batch;
+	return batch.get(batch.submit("program", vertex_shader_source, fragment_shader_source));
 }
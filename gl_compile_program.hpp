@@ -2,10 +2,71 @@
 
 #include "GL.hpp"
 
+#include <iostream>
 #include <string>
+#include <vector>
 
 //compiles+links an OpenGL shader program from source.
 // throws on compilation error.
+//
+//when gl_caps.ARB_get_program_binary is set, linked programs are cached on disk
+// (keyed by a hash of the sources and the driver's vendor/renderer/version strings)
+// and later launches load the cached binary instead of compiling.
 GLuint gl_compile_program(
 	std::string const &vertex_shader_source,
 	std::string const &fragment_shader_source);
+
+//directory for cached program binaries (including trailing separator).
+// if empty when the first program is compiled, it is set to SDL's per-user preference path.
+// set to "-" to disable the cache.
+extern std::string gl_program_cache_dir;
+
+//GLProgramBatch compiles several programs at once:
+// submit() issues all the compile/link commands without asking for results,
+// so the driver can work on them concurrently (on its own threads with KHR_parallel_shader_compile);
+// status is only checked -- and errors thrown -- when get() first asks for a program.
+//
+//  GLProgramBatch batch;
+//  uint32_t a = batch.submit("a", a_vs, a_fs);
+//  uint32_t b = batch.submit("b", b_vs, b_fs);
+//  ... other startup work ...
+//  GLuint program_a = batch.get(a);
+struct GLProgramBatch {
+	GLProgramBatch();
+	//deletes any programs that were never claimed with get():
+	~GLProgramBatch();
+
+	GLProgramBatch(GLProgramBatch const &) = delete;
+	GLProgramBatch &operator=(GLProgramBatch const &) = delete;
+
+	//start compiling+linking a program; 'name' is used in reports and errors:
+	uint32_t submit(std::string const &name, std::string const &vertex_shader_source, std::string const &fragment_shader_source);
+
+	//true if get() would not block. (always true without KHR_parallel_shader_compile, since there's no way to ask)
+	bool ready(uint32_t index) const;
+
+	//wait for a program to finish linking and hand it to the caller (who becomes responsible for deleting it).
+	// throws on compile or link error.
+	GLuint get(uint32_t index);
+
+	//per-program timings:
+	void report(std::ostream &to = std::cout) const;
+
+	//----- internals -----
+	struct Pending {
+		std::string name;
+		std::string vertex_shader_source, fragment_shader_source;
+		uint64_t key = 0; //program binary cache key
+		GLuint program = 0;
+		GLuint vertex_shader = 0, fragment_shader = 0;
+		bool from_cache = false;
+		bool claimed = false;
+
+		//timings, in seconds:
+		float submit_time = 0.0f; //issuing commands in submit()
+		float wait_time = 0.0f; //blocked on status in get()
+		float total_time = 0.0f; //from submit() to end of get()
+		double submitted_at = 0.0; //(seconds, on the batch's clock)
+	};
+	std::vector< Pending > pending;
+};
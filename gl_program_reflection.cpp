@@ -0,0 +1,97 @@
+#include "gl_program_reflection.hpp"
+
+#include <stdexcept>
+#include <vector>
+
+//strip the "[0]" GL appends to array names:
+static std::string base_name(std::vector< GLchar > const &buffer, GLsizei length) {
+	std::string name(buffer.begin(), buffer.begin() + length);
+	if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+		name.resize(name.size() - 3);
+	}
+	return name;
+}
+
+GLProgramReflection::GLProgramReflection(GLuint program) {
+	{ //attributes:
+		GLint count = 0, max_length = 0;
+		glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+		glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length);
+		std::vector< GLchar > buffer(max_length + 1, 0);
+		for (GLint i = 0; i < count; ++i) {
+			Variable var;
+			GLsizei length = 0;
+			glGetActiveAttrib(program, GLuint(i), GLsizei(buffer.size()), &length, &var.size, &var.type, buffer.data());
+			var.location = glGetAttribLocation(program, buffer.data());
+			attributes.emplace(base_name(buffer, length), var);
+		}
+	}
+
+	{ //uniforms:
+		GLint count = 0, max_length = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+		std::vector< GLchar > buffer(max_length + 1, 0);
+		for (GLint i = 0; i < count; ++i) {
+			Variable var;
+			GLsizei length = 0;
+			GLuint index = GLuint(i);
+			glGetActiveUniform(program, index, GLsizei(buffer.size()), &length, &var.size, &var.type, buffer.data());
+			glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &var.block);
+			if (var.block >= 0) {
+				glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_OFFSET, &var.offset);
+			} else {
+				var.location = glGetUniformLocation(program, buffer.data());
+			}
+			uniforms.emplace(base_name(buffer, length), var);
+		}
+	}
+
+	{ //uniform blocks:
+		GLint count = 0, max_length = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_length);
+		std::vector< GLchar > buffer(max_length + 1, 0);
+		for (GLint i = 0; i < count; ++i) {
+			Block block;
+			block.index = GLuint(i);
+			GLsizei length = 0;
+			glGetActiveUniformBlockName(program, block.index, GLsizei(buffer.size()), &length, buffer.data());
+			glGetActiveUniformBlockiv(program, block.index, GL_UNIFORM_BLOCK_DATA_SIZE, &block.data_size);
+			blocks.emplace(std::string(buffer.begin(), buffer.begin() + length), block);
+		}
+	}
+}
+
+GLuint GLProgramReflection::attribute(std::string const &name) const {
+	auto f = attributes.find(name);
+	return f == attributes.end() ? -1U : GLuint(f->second.location);
+}
+
+GLint GLProgramReflection::uniform(std::string const &name) const {
+	auto f = uniforms.find(name);
+	return f == uniforms.end() ? -1 : f->second.location;
+}
+
+GLuint GLProgramReflection::block(std::string const &name) const {
+	auto f = blocks.find(name);
+	return f == blocks.end() ? GL_INVALID_INDEX : f->second.index;
+}
+
+GLuint GLProgramReflection::require_attribute(std::string const &name) const {
+	auto f = attributes.find(name);
+	if (f == attributes.end()) throw std::runtime_error("Program has no active attribute '" + name + "'.");
+	return GLuint(f->second.location);
+}
+
+GLint GLProgramReflection::require_uniform(std::string const &name) const {
+	auto f = uniforms.find(name);
+	if (f == uniforms.end()) throw std::runtime_error("Program has no active uniform '" + name + "'.");
+	return f->second.location;
+}
+
+GLProgramReflection::Block const &GLProgramReflection::require_block(std::string const &name) const {
+	auto f = blocks.find(name);
+	if (f == blocks.end()) throw std::runtime_error("Program has no active uniform block '" + name + "'.");
+	return f->second;
+}
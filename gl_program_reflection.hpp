@@ -0,0 +1,41 @@
+#pragma once
+
+#include "GL.hpp"
+
+#include <map>
+#include <string>
+
+//GLProgramReflection enumerates a linked program's active attributes, uniforms, and uniform blocks once,
+// so callers can look locations up from a table instead of asking the driver by string each time.
+struct GLProgramReflection {
+	GLProgramReflection() = default;
+	explicit GLProgramReflection(GLuint program);
+
+	struct Variable {
+		GLint location = -1; //-1 for uniforms that live in a block
+		GLenum type = 0;
+		GLint size = 0; //array length (1 for non-arrays)
+		GLint block = -1; //uniform block index, or -1
+		GLint offset = -1; //byte offset within block, or -1
+	};
+	struct Block {
+		GLuint index = GL_INVALID_INDEX;
+		GLint data_size = 0; //bytes
+	};
+
+	//(array names are stored without their "[0]" suffix)
+	std::map< std::string, Variable > attributes;
+	std::map< std::string, Variable > uniforms;
+	std::map< std::string, Block > blocks;
+
+	//lookups that return -1U / -1 / GL_INVALID_INDEX for names that aren't active
+	// (same conventions as glGetAttribLocation / glGetUniformLocation / glGetUniformBlockIndex):
+	GLuint attribute(std::string const &name) const;
+	GLint uniform(std::string const &name) const;
+	GLuint block(std::string const &name) const;
+
+	//lookups that throw if the name isn't active:
+	GLuint require_attribute(std::string const &name) const;
+	GLint require_uniform(std::string const &name) const;
+	Block const &require_block(std::string const &name) const;
+};
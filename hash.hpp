@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//64-bit FNV-1a; cheap, stable across platforms, and good enough for naming/caching keys:
+inline uint64_t hash_fnv1a(void const *data, size_t size, uint64_t hash = 0xcbf29ce484222325ULL) {
+	uint8_t const *bytes = reinterpret_cast< uint8_t const * >(data);
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+inline uint64_t hash_fnv1a(std::string const &str, uint64_t hash = 0xcbf29ce484222325ULL) {
+	return hash_fnv1a(str.data(), str.size(), hash);
+}
+
+//64-bit xxHash (XXH64); several times faster than FNV-1a on large inputs, for hashing bulk data such as
+// simulation state. Hash64 hashes data given in pieces, with the same result as hashing it all at once.
+struct Hash64 {
+	Hash64(uint64_t seed = 0) { reset(seed); }
+
+	void reset(uint64_t seed = 0) {
+		lanes[0] = seed + Prime1 + Prime2;
+		lanes[1] = seed + Prime2;
+		lanes[2] = seed;
+		lanes[3] = seed - Prime1;
+		this->seed = seed;
+		total = 0;
+		buffered = 0;
+	}
+
+	void update(void const *data, size_t size) {
+		uint8_t const *at = reinterpret_cast< uint8_t const * >(data);
+		uint8_t const *end = at + size;
+		total += size;
+		if (buffered) {
+			//top up a partial stripe first:
+			while (buffered < 32 && at < end) buffer[buffered++] = *at++;
+			if (buffered < 32) return;
+			stripe(buffer);
+			buffered = 0;
+		}
+		while (end - at >= 32) {
+			stripe(at);
+			at += 32;
+		}
+		while (at < end) buffer[buffered++] = *at++;
+	}
+
+	uint64_t digest() const {
+		uint64_t hash;
+		if (total >= 32) {
+			hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+			for (uint64_t lane : lanes) {
+				hash = (hash ^ round(0, lane)) * Prime1 + Prime4;
+			}
+		} else {
+			hash = seed + Prime5;
+		}
+		hash += total;
+
+		uint8_t const *at = buffer;
+		uint8_t const *end = buffer + buffered;
+		for (; end - at >= 8; at += 8) {
+			hash = rotl(hash ^ round(0, read64(at)), 27) * Prime1 + Prime4;
+		}
+		if (end - at >= 4) {
+			hash = rotl(hash ^ (uint64_t(read32(at)) * Prime1), 23) * Prime2 + Prime3;
+			at += 4;
+		}
+		for (; at < end; ++at) {
+			hash = rotl(hash ^ (uint64_t(*at) * Prime5), 11) * Prime1;
+		}
+
+		hash ^= hash >> 33;
+		hash *= Prime2;
+		hash ^= hash >> 29;
+		hash *= Prime3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	//----- internals -----
+	static constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+	static constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+	static constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;
+	static constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+	static constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+	static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+	static uint64_t round(uint64_t lane, uint64_t input) { return rotl(lane + input * Prime2, 31) * Prime1; }
+	//(little-endian loads, written bytewise so they are alignment-safe; compilers turn them into plain loads)
+	static uint64_t read64(uint8_t const *p) {
+		return uint64_t(read32(p)) | (uint64_t(read32(p + 4)) << 32);
+	}
+	static uint32_t read32(uint8_t const *p) {
+		return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+	}
+	void stripe(uint8_t const *p) {
+		for (uint32_t i = 0; i < 4; ++i) {
+			lanes[i] = round(lanes[i], read64(p + 8 * i));
+		}
+	}
+
+	uint64_t lanes[4];
+	uint64_t seed;
+	uint64_t total;
+	uint8_t buffer[32];
+	uint32_t buffered;
+};
+
+inline uint64_t hash_xx64(void const *data, size_t size, uint64_t seed = 0) {
+	Hash64 hash(seed);
+	hash.update(data, size);
+	return hash.digest();
+}
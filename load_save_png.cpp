@@ -6,12 +6,14 @@
 #include <fstream>
 #include <cassert>
 #include <vector>
+#include <algorithm>
 
 #define LOG_ERROR( X ) std::cerr << X << std::endl
 
 using std::vector;
 
 bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin);
+static bool load_png(png_rw_ptr read_fn, void *io, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin);
 void save_png(std::ostream &to, unsigned int width, unsigned int height, glm::u8vec4 const *data, OriginLocation origin);
 
 void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin) {
@@ -26,6 +28,33 @@ void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 >
 	}
 }
 
+//read cursor for decoding from memory:
+struct MemoryReader {
+	png_const_bytep at;
+	png_const_bytep end;
+};
+
+static void user_read_memory(png_structp png_ptr, png_bytep data, png_size_t length) {
+	MemoryReader *from = reinterpret_cast< MemoryReader * >(png_get_io_ptr(png_ptr));
+	assert(from);
+	if (png_size_t(from->end - from->at) < length) {
+		png_error(png_ptr, "Error reading.");
+	}
+	std::copy(from->at, from->at + length, data);
+	from->at += length;
+}
+
+void load_png(void const *png_data, size_t png_size, std::string const &name, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin) {
+	assert(size);
+
+	MemoryReader from;
+	from.at = reinterpret_cast< png_const_bytep >(png_data);
+	from.end = from.at + png_size;
+	if (!load_png(user_read_memory, &from, &size->x, &size->y, data, origin)) {
+		throw std::runtime_error("Failed to read PNG image from '" + name + "'.");
+	}
+}
+
 void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin) {
 	std::ofstream file(filename.c_str(), std::ios::binary);
 	save_png(file, size.x, size.y, data, origin);
@@ -58,6 +87,10 @@ static void user_flush_data(png_structp png_ptr) {
 
 
 bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin) {
+	return load_png(user_read_data, &from, width, height, data, origin);
+}
+
+static bool load_png(png_rw_ptr read_fn, void *io, unsigned int *width, unsigned int *height, vector< glm::u8vec4 > *data, OriginLocation origin) {
 	assert(data);
 	uint32_t local_width, local_height;
 	if (width == nullptr) width = &local_width;
@@ -68,7 +101,7 @@ bool load_png(std::istream &from, unsigned int *width, unsigned int *height, vec
 	//Load a png file, as per the libpng docs:
 	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, (png_voidp)NULL, (png_error_ptr)NULL, (png_error_ptr)NULL);
 
-	png_set_read_fn(png, &from, user_read_data);
+	png_set_read_fn(png, io, read_fn);
 
 	if (!png) {
 		LOG_ERROR("  cannot alloc read struct.");
@@ -17,4 +17,6 @@ enum OriginLocation {
 
 //NOTE: load_png will throw on error
 void load_png(std::string filename, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin);
+//decode a png already in memory (e.g., a blob in a mapped AssetArchive); 'name' is used in error messages:
+void load_png(void const *png_data, size_t png_size, std::string const &name, glm::uvec2 *size, std::vector< glm::u8vec4 > *data, OriginLocation origin);
 void save_png(std::string filename, glm::uvec2 size, glm::u8vec4 const *data, OriginLocation origin);
@@ -10,11 +10,21 @@
 //for screenshots:
 #include "load_save_png.hpp"
 
+//for frame timeline captures:
+#include "CPUProfiler.hpp"
+
+//for frame-time statistics:
+#include "Telemetry.hpp"
+
+//for heap allocation counts:
+#include "AllocTracker.hpp"
+
 //Includes for libSDL:
 #include <SDL.h>
 
 //...and for c++ standard library functions:
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <stdexcept>
 #include <memory>
@@ -75,9 +85,27 @@ int main(int argc, char **argv) {
 		return 1;
 	}
 
-	//On windows, load OpenGL entrypoints: (does nothing on other platforms)
+	//On windows, load OpenGL entrypoints; everywhere, load optional extensions into gl_caps:
 	init_GL();
 
+	std::cout << "OpenGL " << gl_caps.major << "." << gl_caps.minor << " extensions:"
+		<< (gl_caps.ARB_buffer_storage ? " ARB_buffer_storage" : "")
+		<< (gl_caps.ARB_get_program_binary ? " ARB_get_program_binary" : "")
+		<< (gl_caps.KHR_debug ? " KHR_debug" : "")
+		<< (gl_caps.ARB_multi_draw_indirect ? " ARB_multi_draw_indirect" : "")
+		<< (gl_caps.KHR_parallel_shader_compile ? " KHR_parallel_shader_compile" : "")
+		<< std::endl;
+
+	//With KHR_debug, report driver messages as they happen (otherwise, GL_ERRORS() is all there is):
+	if (gl_caps.KHR_debug) {
+		glEnable(GL_DEBUG_OUTPUT);
+		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+		glDebugMessageCallback([](GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, GLchar const *message, void const *user) {
+			std::cerr << "GL debug: " << std::string(message, length) << std::endl;
+		}, nullptr);
+	}
+
 	//Set VSYNC + Late Swap (prevents crazy FPS):
 	if (SDL_GL_SetSwapInterval(-1) != 0) {
 		std::cerr << "NOTE: couldn't set vsync + late swap tearing (" << SDL_GetError() << ")." << std::endl;
@@ -90,7 +118,55 @@ int main(int argc, char **argv) {
 	//SDL_ShowCursor(SDL_DISABLE);
 
 	//------------ create game mode + make current --------------
-	Mode::set_current(std::make_shared< PongMode >());
+
+	//the game is set up by the scenario file in $PONG_SCENARIO (see Scenario.hpp), if set:
+	Scenario scenario;
+	if (char const *scenario_file = std::getenv("PONG_SCENARIO")) {
+		scenario.load(scenario_file);
+		std::cout << "Playing scenario '" << scenario.name << "' from '" << scenario_file << "'." << std::endl;
+	}
+	//...or $PONG_REPLAY names a replay (see Replay.hpp) to play back instead;
+	// otherwise, the game is recorded to $PONG_RECORD, if set:
+	std::unique_ptr< ReplayPlayer > player;
+	if (char const *replay_file = std::getenv("PONG_REPLAY")) {
+		player.reset(new ReplayPlayer(replay_file));
+		scenario = player->replay.scenario;
+		std::cout << "Playing back replay '" << replay_file << "' (" << player->replay.steps.size() << " steps)." << std::endl;
+	}
+	std::shared_ptr< PongMode > pong = std::make_shared< PongMode >(scenario);
+	if (player) {
+		pong->player = std::move(player);
+	} else if (char const *record_file = std::getenv("PONG_RECORD")) {
+		pong->recorder.reset(new ReplayWriter(record_file, scenario));
+		std::cout << "Recording replay to '" << record_file << "'." << std::endl;
+	}
+	//...or, with $PONG_CONNECT ("host:port"), the game is played on a server (see NetServer.hpp):
+	if (char const *server = std::getenv("PONG_CONNECT")) {
+		pong->net.reset(new NetClient(NetAddress::parse(server)));
+		std::cout << "Playing on server '" << server << "'." << std::endl;
+	}
+	//...or, with $PONG_PEER ("host:port"), against another player peer to peer with rollback (see Rollback.hpp),
+	// listening on $PONG_PORT (default 15214) and playing the $PONG_SIDE ("left", the default, or "right") paddle:
+	if (char const *peer = std::getenv("PONG_PEER")) {
+		NetAddress bind_to;
+		bind_to.port = 15214;
+		if (char const *port = std::getenv("PONG_PORT")) bind_to.port = uint16_t(std::atoi(port));
+		char const *side = std::getenv("PONG_SIDE");
+		bool right = (side && std::string(side) == "right");
+		pong->peer_link.reset(new UDPLink(bind_to, NetAddress::parse(peer)));
+		pong->rollback.reset(new RollbackSession(*pong, *pong->peer_link, right ? 2 : 1));
+		std::cout << "Playing " << (right ? "right" : "left") << " against '" << peer << "' (rollback)." << std::endl;
+	}
+	//the ball and paddles are drawn with the sprites in the skin named by $PONG_SKIN (a directory of pngs, or
+	// a 'pack-assets' archive of them), if set; they load in the background (see PongMode::load_skin):
+	if (char const *skin = std::getenv("PONG_SKIN")) {
+		pong->load_skin(skin);
+		std::cout << "Loading skin '" << skin << "'." << std::endl;
+	}
+	bool const replaying = bool(pong->player);
+	bool const networked = bool(pong->net) || bool(pong->rollback);
+	Mode::set_current(pong);
+	pong.reset();
 
 	//------------ main loop ------------
 
@@ -110,13 +186,39 @@ int main(int argc, char **argv) {
 	on_resize();
 
 	float time = 0.0f;
+	bool game_over = false; //time ran out (and the game is waiting for its turf score)
+
+	//frame-time statistics go to $PONG_TELEMETRY (a file or "unix:<socket>"; see Telemetry.hpp), if set,
+	// tagged with $PONG_BUILD (or, by default, the compile time):
+	char const *telemetry_destination = std::getenv("PONG_TELEMETRY");
+	char const *telemetry_build = std::getenv("PONG_BUILD");
+	Telemetry telemetry(
+		telemetry_destination ? telemetry_destination : "",
+		telemetry_build ? telemetry_build : __DATE__ " " __TIME__
+	);
+	auto microseconds_since = [](std::chrono::steady_clock::time_point const &before) {
+		return uint64_t(std::chrono::duration_cast< std::chrono::microseconds >(std::chrono::steady_clock::now() - before).count());
+	};
+	auto frame_start = std::chrono::steady_clock::now();
 
 	//This will loop until the current mode is set to null:
+	PROFILE_THREAD_NAME("main");
+
 	while (Mode::current) {
 		//every pass through the game loop creates one frame of output
 		//  by performing three steps:
+		PROFILE_ZONE("frame");
+		if (telemetry.enabled()) {
+			//wall time is measured start-to-start, so it includes everything (even time outside these blocks):
+			auto now = std::chrono::steady_clock::now();
+			telemetry.sample("wall_us", microseconds_since(frame_start));
+			telemetry.end_frame();
+			frame_start = now;
+		}
 
 		{ //(1) process any events that are pending
+			PROFILE_ZONE("events");
+			ALLOC_SCOPE("events");
 			static SDL_Event evt;
 			while (SDL_PollEvent(&evt) == 1) {
 				//handle resizing:
@@ -130,7 +232,7 @@ int main(int argc, char **argv) {
 					Mode::set_current(nullptr);
 					break;
 				} else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_PRINTSCREEN) {
-					// --- screenshot key ---
+					// --- screenshot key --- (for modes that don't read their own back without stalling, as PongMode does)
 					std::string filename = "screenshot.png";
 					std::cout << "Saving screenshot to '" << filename << "'." << std::endl;
 					glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
@@ -144,11 +246,21 @@ int main(int argc, char **argv) {
 					}
 					save_png(filename, glm::uvec2(w,h), data.data(), LowerLeftOrigin);
 				}
+				#ifdef ENABLE_PROFILER
+				else if (evt.type == SDL_KEYDOWN && evt.key.keysym.sym == SDLK_F10) {
+					// --- trace capture key ---
+					std::string filename = "trace.json";
+					std::cout << "Saving CPU trace to '" << filename << "'." << std::endl;
+					PROFILE_WRITE_TRACE(filename);
+				}
+				#endif
 			}
 			if (!Mode::current) break;
 		}
 
 		{ //(2) call the current mode's "update" function to deal with elapsed time:
+			PROFILE_ZONE("update");
+			ALLOC_SCOPE("update");
 			auto current_time = std::chrono::high_resolution_clock::now();
 			static auto previous_time = current_time;
 			float elapsed = std::chrono::duration< float >(current_time - previous_time).count();
@@ -159,49 +271,77 @@ int main(int argc, char **argv) {
 			elapsed = std::min(0.1f, elapsed);
 
 			time += elapsed;
-			if (time >= 40.0f) {
-				glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-					glReadBuffer(GL_FRONT);
-					int player1Score = 0;
-					int player2Score = 0;
-					int w,h;
-					SDL_GL_GetDrawableSize(window, &w, &h);
-					std::vector< glm::u8vec4 > data(w*h);
-					glReadPixels(0,0,w,h, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
-					for (auto &px : data) {
-						if (px.r == 0 && px.g == 172 && px.b == 244) {
-							player1Score += 1;
-						}
-						if (px.r == 245 && px.g == 0 && px.b == 100) {
-							player2Score += 1;
-						}
+			//(a replay stops at its last step instead, and a networked game when the server says)
+			if (time >= scenario.duration && !replaying && !networked) {
+				//time's up: the game stops, and its turf is scored from a readback that arrives a few frames later
+				// (PongMode reads it through its frames in flight, so asking doesn't stall the pipeline):
+				PongMode *pong = dynamic_cast< PongMode * >(Mode::current.get());
+				if (pong && !pong->turf_score.ready) {
+					if (!game_over) pong->turf_score.requested = true;
+					game_over = true;
+				} else {
+					uint32_t player1Score = 0;
+					uint32_t player2Score = 0;
+					uint32_t pixels = 1;
+					if (pong) {
+						player1Score = pong->turf_score.player1;
+						player2Score = pong->turf_score.player2;
+						pixels = std::max(1U, pong->turf_score.size.x * pong->turf_score.size.y);
 					}
-					printf("Player 1: %f\nPlayer 2: %f\n", (float)player1Score/(w*h), (float)player2Score/(w*h));
+					printf("Player 1: %f\nPlayer 2: %f\n", (float)player1Score/pixels, (float)player2Score/pixels);
 					if (player2Score > player1Score) {
 						cout << "Bot wins! Your suck!";
 					} else {
 						cout << "You're Winner!";
 					}
 					std::this_thread::sleep_for(std::chrono::seconds(200));
-				break;
+					break;
+				}
 			}
 
-			Mode::current->update(elapsed);
+			if (!game_over) {
+				auto before = std::chrono::steady_clock::now();
+				Mode::current->update(elapsed);
+				telemetry.sample("update_us", microseconds_since(before));
+			}
 			if (!Mode::current) break;
 		}
 
 		{ //(3) call the current mode's "draw" function to produce output:
-		
+			PROFILE_ZONE("draw");
+			ALLOC_SCOPE("draw");
+			auto before = std::chrono::steady_clock::now();
 			Mode::current->draw(drawable_size);
+			telemetry.sample("draw_us", microseconds_since(before));
+			Mode::current->record_telemetry(telemetry);
 		}
 
-		//Wait until the recently-drawn frame is shown before doing it all again:
-		SDL_GL_SwapWindow(window);
+		{ //Wait until the recently-drawn frame is shown before doing it all again:
+			PROFILE_ZONE("swap");
+			auto before = std::chrono::steady_clock::now();
+			SDL_GL_SwapWindow(window);
+			telemetry.sample("swap_us", microseconds_since(before));
+			telemetry.count("frames");
+		}
+
+		#ifdef ENABLE_ALLOC_TRACKING
+		AllocTracker::end_frame();
+		telemetry.sample("allocations", AllocTracker::last_frame().allocations);
+		telemetry.sample("allocated_bytes", AllocTracker::last_frame().allocated_bytes);
+		#endif
 	}
 
 
 	//------------  teardown ------------
 
+	//free the mode (and its OpenGL resources) while the context still exists:
+	Mode::set_current(nullptr);
+
+	#ifdef ENABLE_ALLOC_TRACKING
+	AllocTracker::report(std::cout);
+	AllocTracker::report_leaks(std::cout);
+	#endif
+
 	SDL_GL_DeleteContext(context);
 	context = 0;
 
@@ -1,10 +1,36 @@
 #!/usr/bin/env python3
 
 #create GL.hpp / GL.cpp by parsing everything from glcorearb.h (why not the regsistry xml, hmmmm?) and selecting only things that are core through version 3_3.
+#also emits runtime-loaded entry points for a few optional extensions, plus a capability struct (gl_caps) to check before using them.
 #get glcorearb.h from https://github.com/KhronosGroup/OpenGL-Registry/raw/master/api/GL/glcorearb.h
 
 import re
 
+#optional extensions, as (name, core version or None, entry points, enum name patterns).
+# an extension counts as available if the context version is at least its core version or it is advertised,
+# *and* all of its entry points can be found.
+# (core-promoted extensions use the unsuffixed names from the GL_VERSION_x_y block they were promoted in)
+extensions = [
+	("ARB_buffer_storage", (4,4),
+		["glBufferStorage"],
+		[r"GL_MAP_PERSISTENT_BIT", r"GL_MAP_COHERENT_BIT", r"GL_DYNAMIC_STORAGE_BIT", r"GL_CLIENT_STORAGE_BIT",
+		 r"GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT", r"GL_BUFFER_IMMUTABLE_STORAGE", r"GL_BUFFER_STORAGE_FLAGS"]),
+	("ARB_get_program_binary", (4,1),
+		["glGetProgramBinary", "glProgramBinary", "glProgramParameteri"],
+		[r"GL_PROGRAM_BINARY_RETRIEVABLE_HINT", r"GL_PROGRAM_BINARY_LENGTH", r"GL_NUM_PROGRAM_BINARY_FORMATS", r"GL_PROGRAM_BINARY_FORMATS"]),
+	("KHR_debug", (4,3),
+		["glDebugMessageControl", "glDebugMessageInsert", "glDebugMessageCallback", "glGetDebugMessageLog",
+		 "glPushDebugGroup", "glPopDebugGroup", "glObjectLabel", "glGetObjectLabel", "glObjectPtrLabel", "glGetObjectPtrLabel"],
+		[r"GL_DEBUG_\w+", r"GL_MAX_DEBUG_\w+", r"GL_MAX_LABEL_LENGTH", r"GL_CONTEXT_FLAG_DEBUG_BIT",
+		 r"GL_BUFFER", r"GL_SHADER", r"GL_PROGRAM", r"GL_QUERY", r"GL_PROGRAM_PIPELINE", r"GL_SAMPLER"]),
+	("ARB_multi_draw_indirect", (4,3),
+		["glMultiDrawArraysIndirect", "glMultiDrawElementsIndirect"],
+		[r"GL_DRAW_INDIRECT_BUFFER", r"GL_DRAW_INDIRECT_BUFFER_BINDING"]),
+	("KHR_parallel_shader_compile", None,
+		["glMaxShaderCompilerThreadsKHR"],
+		[r"GL_MAX_SHADER_COMPILER_THREADS_KHR", r"GL_COMPLETION_STATUS_KHR"]),
+]
+
 filtered = []
 lookups = []
 fps = []
@@ -103,6 +129,65 @@ with open('glcorearb.h', 'r') as f:
 			print("ignoring: " + line)
 
 
+#gather every enum/prototype in the header (first definition wins, so core names beat ARB-suffixed duplicates):
+all_defines = {}
+all_protos = {}
+debugproc_typedef = None
+with open('glcorearb.h', 'r') as f:
+	for line in f:
+		line = line.strip()
+		m = re.match(r"^#define (GL_\w+)\s+(0x[0-9A-Fa-f]+|\d+)$", line)
+		if m != None and m.group(1) not in all_defines:
+			all_defines[m.group(1)] = line
+		m = re.match(r"GLAPI(.*)APIENTRY ([^\s]+) (.*)$", line)
+		if m != None and m.group(2) not in all_protos:
+			all_protos[m.group(2)] = (m.group(1), m.group(3))
+		if re.match(r"^typedef .*\*GLDEBUGPROC\)", line):
+			debugproc_typedef = line
+
+already_defined = set()
+for line in filtered:
+	m = re.match(r"^#define (GL_\w+) ", line)
+	if m != None:
+		already_defined.add(m.group(1))
+
+ext_defines = []
+ext_decls = []
+ext_defs = []
+ext_caps = []
+ext_loads = []
+for (name, core, functions, enums) in extensions:
+	ext_defines.append("\n// from GL_" + name + ":")
+	if name == "KHR_debug":
+		assert(debugproc_typedef != None)
+		ext_defines.append(debugproc_typedef)
+	for pattern in enums:
+		#(skip ARB-suffixed aliases of core enums; all_defines is in header order)
+		matched = [ n for n in all_defines if re.fullmatch(pattern, n) and not n.endswith("_ARB") ]
+		assert len(matched) > 0, "no enums match " + pattern
+		for n in matched:
+			if n in already_defined: continue
+			already_defined.add(n)
+			ext_defines.append(all_defines[n])
+	ext_decls.append("\t//" + name + ":")
+	for fn in functions:
+		assert fn in all_protos, "no prototype for " + fn
+		(rt, ag) = all_protos[fn]
+		ext_decls.append("\textern" + rt + "(APIENTRY *" + fn + ") " + ag)
+		ext_defs.append("\t" + rt + "(APIENTRY *" + fn + ") " + ag[:-1] + " = nullptr;")
+	if core != None:
+		ext_caps.append("\tbool " + name + " = false; //core in " + str(core[0]) + "." + str(core[1]))
+		check = "version_at_least(" + str(core[0]) + ", " + str(core[1]) + ") || has_extension(extensions, \"GL_" + name + "\")"
+	else:
+		ext_caps.append("\tbool " + name + " = false;")
+		check = "has_extension(extensions, \"GL_" + name + "\")"
+	ext_loads.append("\tif (" + check + ") {")
+	ext_loads.append("\t\tbool ok = true;")
+	for fn in functions:
+		ext_loads.append("\t\tEXT(" + fn + ")")
+	ext_loads.append("\t\tgl_caps." + name + " = ok;")
+	ext_loads.append("\t}")
+
 
 with open("GL.hpp", "w") as f:
 	print("""#pragma once
@@ -120,6 +205,9 @@ with open("GL.hpp", "w") as f:
  *
  * On MacOS, all are prototypes.
  *
+ * A few optional extensions (see the end of this file) are function pointers
+ *  on every platform; check gl_caps before calling them.
+ *
  * This file has been automatically generated from glcorearb.h by make-GL.py
  *
  */
@@ -151,15 +239,38 @@ typedef signed   long  int     khronos_ssize_t;
 	print("\n".join(filtered), file=f)
 
 	print("""
-}""", file=f)
+}
+
+//------------ optional extensions ------------
+//init_GL() fills in gl_caps with the context version and which of these extensions are usable.
+// entry points of unavailable extensions are left null, so always check the flag first
+// and keep a fallback path that uses only 3.3 core.
+
+struct GLCaps {
+	GLint major = 0, minor = 0; //context version""", file=f)
+	print("\n".join(ext_caps), file=f)
+	print("""};
+extern GLCaps gl_caps;""", file=f)
+	print("\n".join(ext_defines), file=f)
+	print("""
+//(in a namespace so they don't collide with symbols exported by the system GL library)
+namespace GLext {""", file=f)
+	print("\n".join(ext_decls), file=f)
+	print("}", file=f)
+	for (name, core, functions, enums) in extensions:
+		for fn in functions:
+			print("using GLext::" + fn + ";", file=f)
 
 
 with open("GL.cpp", "w") as f:
 	print("""#include "GL.hpp"
 
 #include <SDL.h>
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 #ifdef _WIN32
 	#define DO(fn) \\
@@ -171,9 +282,44 @@ with open("GL.cpp", "w") as f:
 	#define DO(fn)
 #endif
 
+GLCaps gl_caps;
+
+namespace GLext {""", file=f)
+	print("\n".join(ext_defs), file=f)
+	print("""}
+
+static bool has_extension(std::vector< std::string > const &extensions, char const *name) {
+	return std::find(extensions.begin(), extensions.end(), name) != extensions.end();
+}
+
+static void init_GL_caps() {
+	glGetIntegerv(GL_MAJOR_VERSION, &gl_caps.major);
+	glGetIntegerv(GL_MINOR_VERSION, &gl_caps.minor);
+	auto version_at_least = [](GLint major, GLint minor) {
+		return gl_caps.major > major || (gl_caps.major == major && gl_caps.minor >= minor);
+	};
+
+	std::vector< std::string > extensions;
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; ++i) {
+		GLubyte const *name = glGetStringi(GL_EXTENSIONS, GLuint(i));
+		if (name) extensions.emplace_back(reinterpret_cast< char const * >(name));
+	}
+
+	#define EXT(fn) \\
+		GLext::fn = (decltype(GLext::fn))SDL_GL_GetProcAddress(#fn); \\
+		if (!GLext::fn) ok = false;
+""", file=f)
+	print("\n".join(ext_loads), file=f)
+	print("""	#undef EXT
+}
+
 void init_GL() {""", file=f)
 	print("\t" + "\n\t".join(lookups),file=f)
-	print("""}
+	print("""
+	init_GL_caps();
+}
 #ifdef _WIN32""", file=f)
 	print("\t" + "\n\t".join(fps),file=f)
 	print("""#endif""", file=f)
@@ -0,0 +1,71 @@
+//match-server: hosts many matches at once (see MatchServer.hpp); load it with 'pong-bot host:port --bots <n>'.
+// usage: match-server [--port <n>] [--matches <n>] [--workers <n>] [--io-threads <n>] [--scenario <file>]
+//                     [--tick <hz>] [--budget <bytes/s>] [--seconds <s>]
+// prints the matches' costs and the server's traffic once a second.
+
+#include "MatchServer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+int main(int argc, char **argv) {
+	MatchServer::Config config;
+	config.bind_to.port = 15213;
+	std::string scenario_file;
+	float seconds = 0.0f; //0 = forever
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		auto value = [&]() -> std::string {
+			if (i + 1 >= argc) {
+				std::cerr << "Missing value for '" << arg << "'." << std::endl;
+				std::exit(1);
+			}
+			return argv[++i];
+		};
+		if (arg == "--port") config.bind_to.port = uint16_t(std::atoi(value().c_str()));
+		else if (arg == "--matches") config.matches = uint32_t(std::max(1, std::atoi(value().c_str())));
+		else if (arg == "--workers") config.workers = uint32_t(std::max(0, std::atoi(value().c_str())));
+		else if (arg == "--io-threads") config.io_threads = uint32_t(std::max(1, std::atoi(value().c_str())));
+		else if (arg == "--scenario") scenario_file = value();
+		else if (arg == "--tick") config.tick_rate = std::max(1.0f, float(std::atof(value().c_str())));
+		else if (arg == "--budget") config.budget = uint32_t(std::max(0, std::atoi(value().c_str())));
+		else if (arg == "--seconds") seconds = float(std::atof(value().c_str()));
+		else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--port <n>] [--matches <n>] [--workers <n>] [--io-threads <n>] [--scenario <file>] [--tick <hz>] [--budget <bytes/s>] [--seconds <s>]" << std::endl;
+			return 1;
+		}
+	}
+
+	try {
+		if (!scenario_file.empty()) config.scenario.load(scenario_file);
+		MatchServer server(config);
+		std::cout << "Hosting " << server.matches.size() << " matches of '" << config.scenario.name << "' on port " << server.config.bind_to.port
+		          << " at " << config.tick_rate << " Hz, with " << server.workers.size() << " workers and " << server.io_threads.size() << " I/O threads." << std::endl;
+
+		auto const start = std::chrono::steady_clock::now();
+		server.report(); //(start the first period now)
+		while (seconds <= 0.0f || std::chrono::steady_clock::now() - start < std::chrono::duration< float >(seconds)) {
+			std::this_thread::sleep_for(std::chrono::seconds(1));
+			MatchServer::Report report = server.report();
+			std::cout << std::fixed << std::setprecision(1)
+			          << report.players << " players, " << report.ticks / report.seconds << " match ticks/s ("
+			          << report.late << " late), workers " << 100.0f * report.busy << "% busy\n"
+			          << "  per match tick: " << std::setprecision(2) << report.cost_mean_us << " us mean, " << report.cost_median_us << " median, "
+			          << report.cost_p99_us << " p99, " << report.cost_max_us << " worst (match " << report.costliest_match << ")\n"
+			          << "  in " << report.packets_in / report.seconds << " packets/s, " << std::setprecision(1) << report.bytes_in / 1024.0f / report.seconds << " kB/s;"
+			          << " out " << report.packets_out / report.seconds << " packets/s, " << report.bytes_out / 1024.0f / report.seconds << " kB/s";
+#ifdef ENABLE_ALLOC_TRACKING
+			std::cout << "; " << report.tick_allocations << " allocations while ticking";
+#endif
+			std::cout << std::defaultfloat << std::endl;
+		}
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,35 @@
+//pack-assets: build-time asset packer.
+// usage: pack-assets <out.pak> <file> [file ...]
+// each file is stored under the path given on the command line.
+
+#include "AssetArchive.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+int main(int argc, char **argv) {
+	if (argc < 3) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <out.pak> <file> [file ...]" << std::endl;
+		return 1;
+	}
+
+	try {
+		std::vector< std::pair< std::string, std::vector< uint8_t > > > assets;
+		uint64_t total = 0;
+		for (int i = 2; i < argc; ++i) {
+			std::ifstream in(argv[i], std::ios::binary);
+			if (!in) throw std::runtime_error("Failed to open '" + std::string(argv[i]) + "'.");
+			assets.emplace_back(argv[i], std::vector< uint8_t >(std::istreambuf_iterator< char >(in), std::istreambuf_iterator< char >()));
+			total += assets.back().second.size();
+		}
+		AssetArchive::write(argv[1], assets);
+		std::cout << "Packed " << assets.size() << " assets (" << total << " bytes) into '" << argv[1] << "'." << std::endl;
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,39 @@
+//pack-atlas: offline texture atlas packer.
+// usage: pack-atlas <out.png> <out.atlas> <width> <height> <sprite.png> [sprite.png ...]
+// sprites are named by their file name without directory or extension.
+
+#include "TextureAtlas.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+int main(int argc, char **argv) {
+	if (argc < 6) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <out.png> <out.atlas> <width> <height> <sprite.png> [sprite.png ...]" << std::endl;
+		return 1;
+	}
+
+	try {
+		TextureAtlas atlas(glm::uvec2(std::atoi(argv[3]), std::atoi(argv[4])));
+		for (int i = 5; i < argc; ++i) {
+			std::string filename = argv[i];
+			std::string name = filename;
+			size_t slash = name.find_last_of("/\\");
+			if (slash != std::string::npos) name = name.substr(slash + 1);
+			size_t dot = name.rfind('.');
+			if (dot != std::string::npos) name = name.substr(0, dot);
+
+			atlas.add_png(name, filename);
+			TextureAtlas::Sprite const &s = atlas.lookup(name);
+			std::cout << "  '" << name << "' " << s.size_px.x << "x" << s.size_px.y << " at " << s.min_px.x << "," << s.min_px.y << std::endl;
+		}
+		atlas.save(argv[1], argv[2]);
+		std::cout << "Packed " << atlas.sprites.size() << " sprites into '" << argv[1] << "'." << std::endl;
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
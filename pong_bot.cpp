@@ -0,0 +1,121 @@
+//pong-bot: headless network players, for trying out (and loading) a pong-server or match-server.
+// usage: pong-bot <host:port> [--seconds <s>] [--rate <hz>] [--bots <n>] [--match <first>]
+// each bot moves its paddle (if it gets one) up and down; with several, two play each match, starting at
+// match <first>. Prints what they receive once a second.
+
+#include "NetClient.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+int main(int argc, char **argv) {
+	std::string server;
+	float seconds = 10.0f;
+	float rate = 60.0f; //inputs sent per second
+	uint32_t count = 1;
+	uint32_t first_match = 0;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		auto value = [&]() -> std::string {
+			if (i + 1 >= argc) {
+				std::cerr << "Missing value for '" << arg << "'." << std::endl;
+				std::exit(1);
+			}
+			return argv[++i];
+		};
+		if (arg == "--seconds") seconds = float(std::atof(value().c_str()));
+		else if (arg == "--rate") rate = std::max(1.0f, float(std::atof(value().c_str())));
+		else if (arg == "--bots") count = uint32_t(std::max(1, std::atoi(value().c_str())));
+		else if (arg == "--match") first_match = uint32_t(std::max(0, std::atoi(value().c_str())));
+		else if (server.empty() && arg.substr(0, 2) != "--") server = arg;
+		else {
+			server.clear();
+			break;
+		}
+	}
+	if (server.empty()) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <host:port> [--seconds <s>] [--rate <hz>] [--bots <n>] [--match <first>]" << std::endl;
+		return 1;
+	}
+
+#ifndef _WIN32
+	//every bot has its own socket, so many bots need more files than the usual default allows:
+	rlimit files;
+	if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+		files.rlim_cur = files.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &files);
+	}
+#endif
+
+	try {
+		NetAddress address = NetAddress::parse(server);
+		std::vector< std::unique_ptr< NetClient > > bots;
+		for (uint32_t b = 0; b < count; ++b) {
+			bots.emplace_back(new NetClient(address));
+			bots.back()->match = first_match + b / 2;
+		}
+		if (count == 1) {
+			std::cout << "Connecting to " << address.to_string() << " from " << bots[0]->socket.local_address().to_string() << "." << std::endl;
+		} else {
+			std::cout << "Connecting " << count << " bots to " << address.to_string() << ", matches " << first_match << " to " << first_match + (count - 1) / 2 << "." << std::endl;
+		}
+
+		auto const frame_length = std::chrono::duration_cast< std::chrono::steady_clock::duration >(std::chrono::duration< double >(1.0 / rate));
+		auto const start = std::chrono::steady_clock::now();
+		auto next_frame = start;
+		auto next_report = start + std::chrono::seconds(1);
+		uint64_t total_bytes = 0;
+		while (std::chrono::steady_clock::now() - start < std::chrono::duration< float >(seconds)) {
+			std::this_thread::sleep_until(next_frame);
+			next_frame += frame_length;
+			float t = std::chrono::duration< float >(std::chrono::steady_clock::now() - start).count();
+			for (uint32_t b = 0; b < bots.size(); ++b) {
+				bots[b]->poll();
+				//(out of phase with each other, so the paddles aren't all in lockstep)
+				bots[b]->send_input(2.5f * std::sin(t * 1.7f + b));
+			}
+
+			if (std::chrono::steady_clock::now() >= next_report) {
+				next_report += std::chrono::seconds(1);
+				uint64_t bytes = 0;
+				uint32_t snapshots = 0, dropped = 0, playing = 0;
+				for (std::unique_ptr< NetClient > &bot : bots) {
+					bytes += bot->bytes;
+					snapshots += bot->snapshots;
+					dropped += bot->dropped;
+					playing += (bot->side != 0 ? 1 : 0);
+					bot->bytes = 0;
+					bot->snapshots = 0;
+					bot->dropped = 0;
+				}
+				NetClient const &bot = *bots[0];
+				if (count == 1) {
+					std::cout << (bot.side == 1 ? "left " : bot.side == 2 ? "right" : "watch");
+				} else {
+					std::cout << playing << "/" << count << " playing";
+				}
+				std::cout << "  " << bytes / 1024.0f << " kB/s  " << snapshots << " snapshots/s  " << dropped << " dropped";
+				if (count == 1) {
+					std::cout << "  tick " << bot.view.tick << "  " << bot.view.balls.size() << " balls  score " << bot.view.left_score << ":" << bot.view.right_score;
+				}
+				std::cout << std::endl;
+				total_bytes += bytes;
+			}
+		}
+		std::cout << "Received " << total_bytes / 1024.0f / seconds << " kB/s on average." << std::endl;
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,87 @@
+//pong-server: runs a game headless for network players (see NetServer.hpp); play with 'PONG_CONNECT=host:port pong'
+// or 'pong-bot host:port'.
+// usage: pong-server [--port <n>] [--scenario <file>] [--tick <hz>] [--budget <bytes/s>] [--seconds <s>]
+// prints each client's bandwidth once a second.
+
+#include "NetServer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+int main(int argc, char **argv) {
+	uint16_t port = 15213;
+	std::string scenario_file;
+	float tick_rate = 60.0f;
+	uint32_t budget = 16384;
+	float seconds = 0.0f; //0 = forever
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		auto value = [&]() -> std::string {
+			if (i + 1 >= argc) {
+				std::cerr << "Missing value for '" << arg << "'." << std::endl;
+				std::exit(1);
+			}
+			return argv[++i];
+		};
+		if (arg == "--port") port = uint16_t(std::atoi(value().c_str()));
+		else if (arg == "--scenario") scenario_file = value();
+		else if (arg == "--tick") tick_rate = std::max(1.0f, float(std::atof(value().c_str())));
+		else if (arg == "--budget") budget = uint32_t(std::max(0, std::atoi(value().c_str())));
+		else if (arg == "--seconds") seconds = float(std::atof(value().c_str()));
+		else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--port <n>] [--scenario <file>] [--tick <hz>] [--budget <bytes/s>] [--seconds <s>]" << std::endl;
+			return 1;
+		}
+	}
+
+	try {
+		Scenario scenario;
+		if (!scenario_file.empty()) scenario.load(scenario_file);
+		NetAddress bind_to;
+		bind_to.port = port;
+		NetServer server(scenario, bind_to, tick_rate);
+		server.budget = budget;
+		std::cout << "Serving '" << scenario.name << "' on " << server.socket.local_address().to_string()
+		          << " at " << tick_rate << " Hz, " << budget << " bytes/s per client." << std::endl;
+
+		//ticks are scheduled against the clock (not slept between), so the rate doesn't drift:
+		auto const tick_length = std::chrono::duration_cast< std::chrono::steady_clock::duration >(std::chrono::duration< double >(1.0 / tick_rate));
+		auto const start = std::chrono::steady_clock::now();
+		auto next_tick = start;
+		auto next_report = start + std::chrono::seconds(1);
+		while (seconds <= 0.0f || std::chrono::steady_clock::now() - start < std::chrono::duration< float >(seconds)) {
+			std::this_thread::sleep_until(next_tick);
+			server.poll();
+			server.tick();
+			next_tick += tick_length;
+			//(if the server falls far behind, skip ticks rather than running a burst of them)
+			auto now = std::chrono::steady_clock::now();
+			if (now - next_tick > 4 * tick_length) next_tick = now;
+
+			if (now >= next_report) {
+				next_report += std::chrono::seconds(1);
+				std::cout << "tick " << server.ticks << ", " << server.sim.balls.size() << " balls, "
+				          << server.clients.size() << " client(s)" << std::endl;
+				for (NetServer::Client &client : server.clients) {
+					std::cout << "  " << std::setw(21) << std::left << client.address.to_string() << std::right
+					          << (client.side == 1 ? " left " : client.side == 2 ? " right" : " watch")
+					          << std::setw(8) << client.bytes << " B/s" << std::setw(5) << client.snapshots << " snapshots"
+					          << std::setw(8) << client.balls_sent << " balls sent" << std::setw(7) << client.balls_left << " behind"
+					          << "  acked " << (client.acked == NetPacket::NoSeq ? std::string("-") : std::to_string(client.next_seq - 1 - client.acked) + " back")
+					          << std::endl;
+					client.bytes = 0;
+					client.snapshots = 0;
+					client.balls_sent = 0;
+				}
+			}
+		}
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,82 @@
+//replay-check: checks that replays reproduce, using the per-step state hashes they record.
+// usage: replay-check <replay>            play <replay> back with this build; report the first step whose state differs
+//        replay-check <replay> <other>    find the first step at which two recordings of the same scenario differ
+//                                          (e.g., from different builds), by bisecting their hashes
+// exits with status 1 if anything differs.
+
+#include "Replay.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+	void describe(std::string const &label, PongSim const &sim) {
+		std::cout << "  " << std::setw(10) << std::left << label << std::right
+		          << " hash " << std::hex << std::setw(16) << std::setfill('0') << sim.state_hash() << std::dec << std::setfill(' ')
+		          << "  time " << sim.time << "  balls " << sim.balls.size()
+		          << "  score " << sim.left_score << ":" << sim.right_score
+		          << "  paddles " << sim.left_paddle.y << " " << sim.right_paddle.y << "\n";
+		if (!sim.balls.empty()) {
+			std::cout << "             ball 0 at " << sim.balls[0].ball.x << " " << sim.balls[0].ball.y
+			          << " moving " << sim.balls[0].ball_velocity.x << " " << sim.balls[0].ball_velocity.y << "\n";
+		}
+	}
+}
+
+int main(int argc, char **argv) {
+	if (argc != 2 && argc != 3) {
+		std::cerr << "Usage:\n\t" << argv[0] << " <replay> [<other replay>]" << std::endl;
+		return 1;
+	}
+
+	try {
+		Replay replay(argv[1]);
+		if (replay.hashes.size() < replay.steps.size()) {
+			std::cout << "Note: '" << replay.filename << "' has hashes for only " << replay.hashes.size() << " of " << replay.steps.size() << " steps." << std::endl;
+		}
+
+		if (argc == 2) {
+			//play back, comparing every step:
+			PongSim sim(replay.scenario);
+			for (uint32_t i = 0; i < replay.steps.size(); ++i) {
+				replay.apply_input(i, sim);
+				if (i < replay.hashes.size() && sim.state_hash() != replay.hashes[i]) {
+					std::cout << "'" << replay.filename << "' diverges at step " << i << " of " << replay.steps.size()
+					          << " (recorded hash " << std::hex << std::setw(16) << std::setfill('0') << replay.hashes[i] << std::dec << std::setfill(' ') << "):\n";
+					describe("played", sim);
+					return 1;
+				}
+				sim.update(replay.steps[i].elapsed);
+			}
+			std::string diff = replay.check_end(sim);
+			if (!diff.empty()) {
+				std::cout << "'" << replay.filename << "' ends differently:" << diff << std::endl;
+				return 1;
+			}
+			std::cout << "'" << replay.filename << "' reproduces (" << replay.steps.size() << " steps)." << std::endl;
+		} else {
+			Replay other(argv[2]);
+			uint32_t step = replay.first_divergence(other);
+			uint32_t compared = uint32_t(std::min(replay.hashes.size(), other.hashes.size()));
+			if (step == UINT32_MAX) {
+				std::cout << "'" << replay.filename << "' and '" << other.filename << "' agree for all " << compared << " steps both have." << std::endl;
+				return 0;
+			}
+			std::cout << "'" << replay.filename << "' and '" << other.filename << "' diverge at step " << step << " of " << compared << ":\n";
+			//(show the recorded states at the keyframes before that; re-simulating from them with this build
+			// would only show what this build does)
+			PongSim a(replay.scenario), b(other.scenario);
+			uint32_t a_step = replay.restore(step, a);
+			uint32_t b_step = other.restore(step, b);
+			describe("first @" + std::to_string(a_step), a);
+			describe("second @" + std::to_string(b_step), b);
+			return 1;
+		}
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,147 @@
+//rollback-test: plays two RollbackSession peers against each other in one process, over a simulated network
+// (see NetLink.hpp), with inputs that keep changing (so predictions are often wrong), then checks that both
+// peers agree with each other -- and with a plain, non-networked run of the same inputs.
+// usage: rollback-test [--scenario <file>] [--seconds <s>] [--latency <ms>] [--jitter <ms>] [--loss <fraction>]
+//                      [--max-prediction <ticks>] [--seed <n>]
+// exits with status 1 if the peers desync.
+
+#include "Rollback.hpp"
+#include "NetSnapshot.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+int main(int argc, char **argv) {
+	std::string scenario_file;
+	float seconds = 20.0f;
+	Loopback::Conditions conditions;
+	conditions.latency = 0.06f;
+	conditions.jitter = 0.02f;
+	conditions.loss = 0.05f;
+	uint32_t max_prediction = 8;
+	uint64_t seed = 1;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		auto value = [&]() -> std::string {
+			if (i + 1 >= argc) {
+				std::cerr << "Missing value for '" << arg << "'." << std::endl;
+				std::exit(1);
+			}
+			return argv[++i];
+		};
+		if (arg == "--scenario") scenario_file = value();
+		else if (arg == "--seconds") seconds = float(std::atof(value().c_str()));
+		else if (arg == "--latency") conditions.latency = float(std::atof(value().c_str())) / 1000.0f;
+		else if (arg == "--jitter") conditions.jitter = float(std::atof(value().c_str())) / 1000.0f;
+		else if (arg == "--loss") conditions.loss = float(std::atof(value().c_str()));
+		else if (arg == "--max-prediction") max_prediction = uint32_t(std::max(1, std::atoi(value().c_str())));
+		else if (arg == "--seed") seed = std::strtoull(value().c_str(), nullptr, 10);
+		else {
+			std::cerr << "Usage:\n\t" << argv[0] << " [--scenario <file>] [--seconds <s>] [--latency <ms>] [--jitter <ms>] [--loss <fraction>] [--max-prediction <ticks>] [--seed <n>]" << std::endl;
+			return 1;
+		}
+	}
+
+	try {
+		Scenario scenario;
+		if (!scenario_file.empty()) scenario.load(scenario_file);
+
+		Loopback loopback(conditions, seed);
+		PongSim sims[2] = {PongSim(scenario), PongSim(scenario)};
+		RollbackSession left(sims[0], loopback.end(0), 1);
+		RollbackSession right(sims[1], loopback.end(1), 2);
+		RollbackSession *peers[2] = {&left, &right};
+		for (RollbackSession *peer : peers) {
+			peer->max_prediction = max_prediction;
+		}
+
+		//every tick's inputs, as each peer ran them (for the reference run):
+		std::vector< int16_t > inputs[2];
+
+		//the peers' frames don't line up (the right one runs a little slow, and both vary a bit),
+		// so the time sync and stalls get exercised too:
+		Rng rng(seed + 1);
+		double next_frame[2] = {0.0, 0.0};
+		float frame_time[2] = {1.0f / 60.0f, 1.0f / 59.0f};
+		float paddle[2] = {0.0f, 0.0f};
+		float target[2] = {0.0f, 0.0f};
+		double frame_ms_total = 0.0;
+		float frame_ms_worst = 0.0f;
+		uint32_t frames = 0;
+		while (loopback.time < seconds) {
+			uint32_t p = (next_frame[0] <= next_frame[1] ? 0 : 1);
+			loopback.time = next_frame[p];
+
+			//paddles chase targets that jump around every so often:
+			if (rng.next_float() < 0.03f) target[p] = (rng.next_float() * 2.0f - 1.0f) * sims[p].court_radius.y;
+			paddle[p] += (target[p] - paddle[p]) * 0.2f;
+
+			auto before = std::chrono::steady_clock::now();
+			uint32_t ran = peers[p]->advance(frame_time[p], paddle[p]);
+			float ms = std::chrono::duration< float, std::milli >(std::chrono::steady_clock::now() - before).count();
+			frame_ms_total += ms;
+			frame_ms_worst = std::max(frame_ms_worst, ms);
+			frames += 1;
+			inputs[p].insert(inputs[p].end(), ran, NetView::quantize(paddle[p]));
+
+			next_frame[p] += frame_time[p] * (0.9f + 0.2f * rng.next_float());
+		}
+
+		//let the last inputs arrive (frames with no time pass run no ticks), so both peers finalize as much as they can:
+		for (uint32_t i = 0; i < 20; ++i) {
+			loopback.advance(conditions.latency + conditions.jitter);
+			for (uint32_t p = 0; p < 2; ++p) {
+				uint32_t ran = peers[p]->advance(0.0f, paddle[p]);
+				inputs[p].insert(inputs[p].end(), ran, NetView::quantize(paddle[p]));
+			}
+		}
+
+		for (uint32_t p = 0; p < 2; ++p) {
+			RollbackSession::Stats const &s = peers[p]->stats;
+			std::cout << (p == 0 ? "left " : "right") << ": " << s.ticks << " ticks, " << s.rollbacks << " rollbacks re-simulating "
+			          << s.resimulated << " ticks (deepest " << s.deepest << ", "
+			          << std::fixed << std::setprecision(3) << (s.rollbacks ? s.rollback_ms / s.rollbacks : 0.0f) << " ms average, "
+			          << s.worst_rollback_ms << " ms worst), " << s.stalls << " stalls, " << s.waits << " waits" << std::defaultfloat << std::endl;
+		}
+		std::cout << "network: " << loopback.sent << " packets sent, " << loopback.dropped << " dropped; "
+		          << sims[0].balls.size() << " balls at the end" << std::endl;
+		std::cout << "frames: " << std::fixed << std::setprecision(3) << frame_ms_total / std::max(1U, frames) << " ms average, "
+		          << frame_ms_worst << " ms worst" << std::defaultfloat << std::endl;
+
+		if (left.desync_at != UINT32_MAX || right.desync_at != UINT32_MAX) {
+			std::cout << "FAILED: peers desynced at tick " << std::min(left.desync_at, right.desync_at) << "." << std::endl;
+			return 1;
+		}
+
+		//both peers' newest final tick should match a plain run with the same inputs:
+		uint32_t check = std::min(left.final_tick, right.final_tick);
+		if (check == UINT32_MAX) {
+			std::cout << "FAILED: no tick was finalized." << std::endl;
+			return 1;
+		}
+		PongSim reference(scenario);
+		reference.left_script = reference.right_script = PaddleScript(PaddleScript::Player);
+		for (uint32_t tick = 0; tick <= check; ++tick) {
+			reference.left_paddle.y = NetView::dequantize(inputs[0][tick]);
+			reference.right_paddle.y = NetView::dequantize(inputs[1][tick]);
+			if (tick == check) break;
+			reference.update(1.0f / left.tick_rate);
+		}
+		uint64_t expected = reference.state_hash();
+		for (RollbackSession *peer : peers) {
+			uint32_t slot = check % RollbackSession::Window;
+			if (peer->hash_ticks[slot] != check || peer->hashes[slot] != expected) {
+				std::cout << "FAILED: " << (peer == &left ? "left" : "right") << " peer's state at tick " << check << " differs from a plain run." << std::endl;
+				return 1;
+			}
+		}
+		std::cout << "Peers agree with each other and with a plain run through tick " << check << "." << std::endl;
+	} catch (std::exception const &e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}